@@ -3,6 +3,10 @@ import {
   NativeEventEmitter
 } from 'react-native';
 
+import {
+  COMMAND_TYPE
+} from '../constant/enum';
+
 /**
  * Native iOS bridge to an async TCP socket
  */
@@ -57,6 +61,11 @@ export class TCPSocket {
   }
 
   write = (data) => {
+    if (data.type === COMMAND_TYPE.node && data.payload.nonce === undefined) {
+      // resending the same command reuses its nonce, so the controller discards the duplicate
+      data.payload.nonce = Date.now().toString(36) + Math.random().toString(36).slice(2, 10);
+    }
+
     this.dispatchSocket.writeString(JSON.stringify(data), -1);
   }
 
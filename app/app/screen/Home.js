@@ -114,6 +114,9 @@ export default class Home extends React.Component {
             }
             
             break;
+
+          case COMMAND_TYPE.confirmation: // heartbeat, acknowledged below like any message
+            break;
           default:
             console.log('Received data without matching process block', data);
             break;
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "cJSON.h"
+
+#include "arena.h"
+
+static __thread struct Arena arena; // per thread, as the worker and reactor threads reach the cJSON hooks too
+
+static struct ArenaChunk *create_arena_chunk(size_t capacity)
+{
+	struct ArenaChunk *chunk = malloc(sizeof(struct ArenaChunk) + capacity);
+
+	if (chunk == NULL)
+	{
+		return NULL;
+	}
+
+	chunk->next = NULL;
+	chunk->capacity = capacity;
+	chunk->used = 0;
+	chunk->data = (uint8_t *)(chunk + 1);
+
+	return chunk;
+}
+
+static bool is_arena_allocation(void *ptr)
+{
+	for (struct ArenaChunk *chunk = arena.first_chunk; chunk != NULL; chunk = chunk == arena.current_chunk ? NULL : chunk->next)
+	{
+		if ((uint8_t *)ptr >= chunk->data && (uint8_t *)ptr < chunk->data + chunk->capacity)
+		{
+			return true;
+		}
+	}
+
+	for (struct ArenaChunk *chunk = arena.oversized_chunks; chunk != NULL; chunk = chunk->next)
+	{
+		if ((uint8_t *)ptr >= chunk->data && (uint8_t *)ptr < chunk->data + chunk->capacity)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void *allocate_from_arena(size_t size)
+{
+	if (arena.depth == 0)
+	{
+		arena.heap_allocations++;
+
+		return malloc(size);
+	}
+
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	arena.arena_allocations++;
+
+	if (size > ARENA_CHUNK_SIZE)
+	{
+		struct ArenaChunk *chunk = create_arena_chunk(size);
+
+		if (chunk == NULL)
+		{
+			return NULL;
+		}
+
+		chunk->next = arena.oversized_chunks;
+		arena.oversized_chunks = chunk;
+
+		return chunk->data;
+	}
+
+	while (arena.current_chunk->used + size > arena.current_chunk->capacity) // move on to a retained chunk, or chain a new one
+	{
+		if (arena.current_chunk->next == NULL && (arena.current_chunk->next = create_arena_chunk(ARENA_CHUNK_SIZE)) == NULL)
+		{
+			return NULL;
+		}
+
+		arena.current_chunk = arena.current_chunk->next;
+		arena.current_chunk->used = 0;
+	}
+
+	void *ptr = arena.current_chunk->data + arena.current_chunk->used;
+	arena.current_chunk->used += size;
+
+	return ptr;
+}
+
+static void deallocate_from_arena(void *ptr)
+{
+	if (ptr != NULL && (arena.depth == 0 || !is_arena_allocation(ptr))) // arena allocations are only reclaimed on reset
+	{
+		free(ptr);
+	}
+}
+
+void install_arena_hooks(void)
+{
+	cJSON_Hooks hooks = { allocate_from_arena, deallocate_from_arena };
+
+	cJSON_InitHooks(&hooks);
+}
+
+void open_arena_scope(void)
+{
+	if (arena.first_chunk == NULL)
+	{
+		arena.first_chunk = arena.current_chunk = create_arena_chunk(ARENA_CHUNK_SIZE);
+	}
+
+	if (arena.first_chunk != NULL)
+	{
+		arena.depth++;
+	}
+}
+
+void close_arena_scope(void)
+{
+	if (arena.depth == 0 || --arena.depth > 0)
+	{
+		return;
+	}
+
+	arena.first_chunk->used = 0; // chained chunks are reset as they are reached again
+	arena.current_chunk = arena.first_chunk;
+
+	while (arena.oversized_chunks != NULL)
+	{
+		struct ArenaChunk *next = arena.oversized_chunks->next;
+
+		free(arena.oversized_chunks);
+		arena.oversized_chunks = next;
+	}
+}
+
+void print_arena_statistics(void)
+{
+	printf("[~] %llu arena allocations, %llu heap allocations\n",
+		(unsigned long long)arena.arena_allocations, (unsigned long long)arena.heap_allocations);
+}
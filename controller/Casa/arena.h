@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define ARENA_CHUNK_SIZE 65536 // covers a room structure or ledger dump without chaining
+#define ARENA_ALIGNMENT 16
+
+/// <summary>
+/// struct of a contiguous arena region, chained once the previous region is exhausted.
+/// </summary>
+struct ArenaChunk
+{
+	struct ArenaChunk *next;
+
+	size_t capacity;
+	size_t used;
+
+	uint8_t *data;
+};
+
+/// <summary>
+/// struct of a per-thread bump allocator, active for the duration of a message dispatch.
+/// </summary>
+struct Arena
+{
+	struct ArenaChunk *first_chunk;
+	struct ArenaChunk *current_chunk;
+	struct ArenaChunk *oversized_chunks; // larger than ARENA_CHUNK_SIZE, released on reset
+
+	uint32_t depth; // nested scopes share the outermost
+
+	uint64_t arena_allocations; // served by bumping, since startup
+	uint64_t heap_allocations; // served by malloc outside any scope, since startup
+};
+
+/// <summary>
+/// Routes cJSON allocations through the calling thread's arena while a scope is open, and the heap otherwise.
+/// </summary>
+void install_arena_hooks(void);
+
+/// <summary>
+/// Opens an arena scope on the calling thread. Every cJSON allocation until the matching close is reclaimed at once.
+/// </summary>
+void open_arena_scope(void);
+
+/// <summary>
+/// Closes an arena scope, resetting the arena in constant time once the outermost scope is closed.
+/// </summary>
+void close_arena_scope(void);
+
+/// <summary>
+/// Prints the calling thread's arena and heap allocation counts.
+/// </summary>
+void print_arena_statistics(void);
@@ -13,7 +13,7 @@
 /// </summary>
 struct Block
 {
-	uint8_t index;
+	uint32_t index;
 	uint8_t occupied_capacity;
 
 	int timestamp;
@@ -22,6 +22,10 @@ struct Block
 	struct Transaction *transactions[BLOCK_SIZE];
 
 	uint8_t hash[SHA256_BYTES];
+	uint8_t prev_hash[SHA256_BYTES]; // hash of the ancestor, survives eviction of prev_block
+
+	uint32_t nonce; // proof-of-work, 0 when mining is disabled
+	uint32_t extra_nonce; // advanced each time every nonce misses the difficulty, hashed only once nonzero
 };
 
 /// <summary>
@@ -29,12 +33,13 @@ struct Block
 /// </summary>
 struct Transaction
 {
-	char *node[32];
-	char *room[32];
-	char *profile_identifier[32];
+	char node[32];
+	char room[32];
+	char profile_identifier[32];
 
 	uint8_t value;
 	bool authorized;
+	uint16_t coalesced_count; // updates settled into this one from a client's rapid stream, 0 if proposed alone
 
 	int timestamp;
 };
\ No newline at end of file
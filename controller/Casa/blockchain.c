@@ -9,11 +9,18 @@
 #include "cJSON.h"
 
 #include "block.h"
+#include "blockchain.h"
+#include "checkpoint.h"
 #include "profile.h"
+#include "replication.h"
+#include "mining.h"
 
 struct Block *lead_block;
 
-void compute_block_hash(struct Block *block, uint8_t *hash_dest)
+uint32_t genesis_index = 0; // first resident block index, beyond any restored checkpoint
+uint8_t genesis_prev_hash[SHA256_BYTES] = { 0 };
+
+void prepare_block_hash(struct Block *block, sha256_context *context)
 {
 	char hash_buffer[SHA256_BYTES * 2];
 
@@ -29,10 +36,52 @@ void compute_block_hash(struct Block *block, uint8_t *hash_dest)
 		}
 	}
 
-	snprintf(hash_buffer, sizeof(hash_buffer), "%d.ca.%d.sa.%d", block->index, transaction_count, 
+	snprintf(hash_buffer, sizeof(hash_buffer), "%u.ca.%d.sa.%d", block->index, transaction_count, 
 		timestamp_sum / block->timestamp ); // concatenate block data, index and transaction cumulitive timestamp / block timestamp  
 
-	sha256(hash_buffer, strlen(hash_buffer), hash_dest);
+	sha256_init(context);
+	sha256_hash(context, hash_buffer, strlen(hash_buffer));
+	sha256_hash(context, block->prev_hash, SHA256_BYTES); // chain to the ancestor so peers can verify linkage
+
+	for (uint8_t i = 0; i < block->occupied_capacity; i++) // bind transaction contents, not only their timing
+	{
+		struct Transaction *transaction = block->transactions[i];
+
+		sha256_hash(context, transaction->node, strlen(transaction->node));
+		sha256_hash(context, transaction->room, strlen(transaction->room));
+		sha256_hash(context, transaction->profile_identifier, strlen(transaction->profile_identifier));
+		sha256_hash(context, &transaction->value, sizeof(transaction->value));
+		sha256_hash(context, &transaction->authorized, sizeof(transaction->authorized));
+
+		if (transaction->coalesced_count != 0) // bound only when present, so other transactions hash as they always have
+		{
+			sha256_hash(context, &transaction->coalesced_count, sizeof(transaction->coalesced_count));
+		}
+	}
+
+	if (block->extra_nonce != 0) // likewise, so blocks whose nonce space sufficed hash as they always have
+	{
+		const uint8_t extra_nonce_bytes[4] = { block->extra_nonce & 0xff, (block->extra_nonce >> 8) & 0xff, (block->extra_nonce >> 16) & 0xff, block->extra_nonce >> 24 };
+
+		sha256_hash(context, extra_nonce_bytes, sizeof(extra_nonce_bytes));
+	}
+}
+
+void compute_block_hash(struct Block *block, uint8_t *hash_dest)
+{
+	const uint8_t nonce_bytes[4] = { block->nonce & 0xff, (block->nonce >> 8) & 0xff, (block->nonce >> 16) & 0xff, block->nonce >> 24 };
+
+	sha256_context context;
+
+	prepare_block_hash(block, &context);
+
+	sha256_hash(&context, nonce_bytes, sizeof(nonce_bytes)); // last, so miners can resume from the prepared context
+	sha256_done(&context, hash_dest);
+}
+
+struct Block *first_unsealed_block(void)
+{
+	return mining_block != NULL ? mining_block : lead_block;
 }
 
 struct Block *build_new_block(void)
@@ -41,17 +90,21 @@ struct Block *build_new_block(void)
 
 	block->timestamp = time(NULL);
 
-	block->index = lead_block == NULL ? 0 : lead_block->index + 1;
+	block->index = lead_block == NULL ? genesis_index : lead_block->index + 1;
 	block->prev_block = lead_block;
 	block->occupied_capacity = 0;
+	block->nonce = 0;
+	block->extra_nonce = 0;
+
+	memcpy(block->prev_hash, lead_block == NULL ? genesis_prev_hash : lead_block->hash, SHA256_BYTES);
 
 	return block;
 }
 
 void handle_proposed_block(struct Block *new_block)
 {
-	if ((lead_block == NULL && new_block->index == 0 && new_block->prev_block == NULL) || // appending genesis block
-		(new_block->index == lead_block->index + 1 && new_block->prev_block->hash == lead_block->hash)) // append more recent block
+	if ((lead_block == NULL && new_block->index == genesis_index && new_block->prev_block == NULL) || // appending genesis block
+		(lead_block != NULL && new_block->index == lead_block->index + 1 && memcmp(new_block->prev_hash, lead_block->hash, SHA256_BYTES) == 0)) // append more recent block
 	{
 		lead_block = new_block;
 	}
@@ -69,10 +122,12 @@ void destroy_blockchain(struct Block *starting_block)
 	{
 		next = current->prev_block;
 
-		if (current != NULL)
+		for (uint8_t i = 0; i < current->occupied_capacity; i++)
 		{
-			free(current);
+			free(current->transactions[i]);
 		}
+
+		free(current);
 	}
 
 	starting_block = NULL;
@@ -85,25 +140,106 @@ int formulate_blockchain(void)
 		return -1;
 	}
 
+	struct Checkpoint checkpoint;
+
+	if (restore_latest_checkpoint(&checkpoint) == 0) // resume from the persisted ledger
+	{
+		genesis_index = checkpoint.end_index + 1;
+		memcpy(genesis_prev_hash, checkpoint.hash, SHA256_BYTES);
+
+		printf("[~] Resuming from checkpoint #%u-#%u\n", checkpoint.start_index, checkpoint.end_index);
+	}
+
 	handle_proposed_block(build_new_block());
 
 	return 0;
 }
 
-bool record_proposed_transaction(const char *profile_identifier, const char *node_name, const char *room_name, uint8_t value, bool force_wrap)
+void seal_lead_block(void)
 {
-	if (force_wrap || lead_block->occupied_capacity == BLOCK_SIZE)
+	if (mining_difficulty > 0)
 	{
-		compute_block_hash(lead_block, lead_block->hash);
+		struct Block *full_block = lead_block;
+
+		lead_block = build_new_block(); // prev_hash is assigned once the full block's nonce is found
+
+		if (mining_block == NULL) // otherwise queued behind the block being mined, a single block being mined at a time
+		{
+			start_mining(full_block);
+		}
+
+		return;
+	}
+
+	struct Block *sealed_block = lead_block;
+
+	compute_block_hash(sealed_block, sealed_block->hash);
+
+	printf("[~] Sealing block #%u at %d%% capacity\n", sealed_block->index, (sealed_block->occupied_capacity * 100) / BLOCK_SIZE);
+
+	struct Block *new_block = build_new_block();
+
+	handle_proposed_block(new_block);
+	replicate_sealed_block(sealed_block);
+
+	compact_blockchain();
+}
+
+void complete_mined_block(void)
+{
+	struct Block *mined_block = mining_block;
+	struct Block *sealed_block = await_mining();
+
+	if (sealed_block == NULL && mined_block != NULL) // no nonce met the difficulty - search them all again under a new extra nonce
+	{
+		mined_block->extra_nonce++;
+
+		printf("[~] Nonces exhausted for block #%u, retrying with extra nonce %u\n", mined_block->index, mined_block->extra_nonce);
+		start_mining(mined_block);
+	}
+
+	if (sealed_block == NULL)
+	{
+		return;
+	}
+
+	struct Block *successor_block = lead_block;
+
+	while (successor_block->prev_block != sealed_block)
+	{
+		successor_block = successor_block->prev_block;
+	}
+
+	memcpy(successor_block->prev_hash, sealed_block->hash, SHA256_BYTES);
+
+	printf("[~] Sealing block #%u at %d%% capacity, nonce %u\n", sealed_block->index, (sealed_block->occupied_capacity * 100) / BLOCK_SIZE, sealed_block->nonce);
+
+	if (successor_block != lead_block) // the next full block queued behind is now hashable
+	{
+		start_mining(successor_block);
+	}
 
-		printf("[~] Sealing block #%d at %d%% capacity\n", lead_block->index, (lead_block->occupied_capacity * 100) / BLOCK_SIZE);
+	replicate_sealed_block(sealed_block);
 
-		struct Block *new_block = build_new_block();
+	compact_blockchain();
+}
 
-		handle_proposed_block(new_block);
+void append_transaction(struct Transaction *transaction)
+{
+	if (lead_block->occupied_capacity == BLOCK_SIZE)
+	{
+		seal_lead_block();
 	}
 
-	struct Transaction *transaction = malloc(sizeof(struct Transaction));
+	lead_block->transactions[lead_block->occupied_capacity++] = transaction;
+}
+
+/// <summary>
+/// Builds a transaction proposed by a profile.
+/// </summary>
+static struct Transaction *build_proposed_transaction(const char *profile_identifier, const char *node_name, const char *room_name, uint8_t value, bool authorized)
+{
+	struct Transaction *transaction = calloc(1, sizeof(struct Transaction)); // persisted whole by checkpoints, unused bytes included
 
 	strcpy(transaction->room, node_name);
 	strcpy(transaction->node, room_name);
@@ -111,13 +247,257 @@ bool record_proposed_transaction(const char *profile_identifier, const char *nod
 	
 	transaction->value = value;
 	transaction->timestamp = time(NULL);
-	transaction->authorized = is_transaction_permissible(profile_identifier, room_name, node_name);
+	transaction->authorized = authorized;
 
-	lead_block->transactions[lead_block->occupied_capacity++] = transaction;
+	return transaction;
+}
+
+bool record_proposed_transaction(const char *profile_identifier, const char *node_name, const char *room_name, uint8_t value, bool force_wrap)
+{
+	if (force_wrap || lead_block->occupied_capacity == BLOCK_SIZE)
+	{
+		seal_lead_block();
+	}
+
+	struct Profile *profile;
+	HASH_FIND_STR(profiles, profile_identifier, profile);
+
+	struct Transaction *transaction = build_proposed_transaction(profile_identifier, node_name, room_name, value, is_transaction_permissible(profile, room_name, node_name));
+
+	append_transaction(transaction);
+
+	return transaction->authorized;
+}
+
+bool record_coalesced_transaction(const char *profile_identifier, const char *node_name, const char *room_name, uint8_t value, uint16_t coalesced_count)
+{
+	struct Profile *profile;
+	HASH_FIND_STR(profiles, profile_identifier, profile);
+
+	struct Transaction *transaction = build_proposed_transaction(profile_identifier, node_name, room_name, value, is_transaction_permissible(profile, room_name, node_name));
+	transaction->coalesced_count = coalesced_count > 1 ? coalesced_count : 0;
+
+	append_transaction(transaction);
 
 	return transaction->authorized;
 }
 
+void record_authorized_transaction_group(const char *profile_identifier, const struct NodeAssignment *assignments, uint8_t count, const bool *authorized)
+{
+	if (count <= BLOCK_SIZE && BLOCK_SIZE - lead_block->occupied_capacity < count) // sealed at most once, keeping the group within a block
+	{
+		seal_lead_block();
+	}
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		append_transaction(build_proposed_transaction(profile_identifier, assignments[i].node, assignments[i].room, assignments[i].value, authorized[i])); // larger groups span consecutive blocks
+	}
+}
+
+uint8_t record_proposed_transaction_group(struct Profile *profile, const struct NodeAssignment *assignments, uint8_t count, bool *authorized)
+{
+	uint8_t authorized_count = 0;
+
+	for (uint8_t i = 0; i < count; i++) // authorized in one pass, against the profile resolved once
+	{
+		authorized[i] = is_transaction_permissible(profile, assignments[i].room, assignments[i].node);
+		authorized_count += authorized[i];
+	}
+
+	record_authorized_transaction_group(profile->identifier, assignments, count, authorized);
+
+	return authorized_count;
+}
+
+void compact_blockchain(void)
+{
+	struct Block *unsealed_block = first_unsealed_block(); // full blocks awaiting their nonce are not yet part of the sealed chain
+	uint32_t sealed_count = 0;
+
+	for (struct Block *block = unsealed_block->prev_block; block != NULL; block = block->prev_block)
+	{
+		sealed_count++;
+	}
+
+	if (sealed_count < CHECKPOINT_INTERVAL)
+	{
+		return;
+	}
+
+	struct Block *successor_block = unsealed_block; // the eldest full range is persisted, regardless of prior failures
+
+	for (uint32_t i = 0; i < sealed_count - CHECKPOINT_INTERVAL; i++)
+	{
+		successor_block = successor_block->prev_block;
+	}
+
+	struct Checkpoint checkpoint;
+
+	if (persist_checkpoint(successor_block->prev_block, &checkpoint) != 0) // retain in memory until the next attempt
+	{
+		perror("[x] Checkpoint failure");
+		return;
+	}
+
+	destroy_blockchain(successor_block->prev_block);
+	successor_block->prev_block = NULL;
+
+	printf("[~] Checkpointed blocks #%u-#%u\n", checkpoint.start_index, checkpoint.end_index);
+}
+
+struct Block *find_block(struct Block *starting_block, uint32_t index)
+{
+	for (struct Block *block = starting_block; block != NULL && block->index >= index; block = block->prev_block)
+	{
+		if (block->index == index)
+		{
+			return block;
+		}
+	}
+
+	return NULL;
+}
+
+/// <summary>
+/// Re-records the transactions of an orphaned chain into the lead block, eldest first.
+/// </summary>
+/// <param name="orphaned_block">Most recent block of the orphaned chain.</param>
+void reclaim_orphaned_transactions(struct Block *orphaned_block)
+{
+	if (orphaned_block == NULL)
+	{
+		return;
+	}
+
+	reclaim_orphaned_transactions(orphaned_block->prev_block);
+
+	for (uint8_t i = 0; i < orphaned_block->occupied_capacity; i++)
+	{
+		append_transaction(orphaned_block->transactions[i]);
+	}
+
+	orphaned_block->occupied_capacity = 0; // ownership moved to the lead block
+}
+
+/// <summary>
+/// Links a verified replicated block into the resident chain, while no block is being mined.
+/// </summary>
+/// <param name="new_block">The replicated block.</param>
+/// <returns>Outcome of the proposal.</returns>
+static ProposalResult link_replicated_block(struct Block *new_block)
+{
+	if (new_block->index >= lead_block->index) // extends the sealed chain
+	{
+		if (new_block->index > lead_block->index || memcmp(new_block->prev_hash, lead_block->prev_hash, SHA256_BYTES) != 0)
+		{
+			return PROPDETACHED;
+		}
+
+		new_block->prev_block = lead_block->prev_block;
+		lead_block->prev_block = new_block;
+
+		lead_block->index = new_block->index + 1; // the open block is yet to be hashed, so it can simply move up
+		memcpy(lead_block->prev_hash, new_block->hash, SHA256_BYTES);
+
+		compact_blockchain();
+
+		return PROPADOPTED;
+	}
+
+	struct Block *rival_block = find_block(lead_block->prev_block, new_block->index);
+
+	if (rival_block == NULL) // checkpointed blocks are final
+	{
+		return PROPDISCARDED;
+	}
+
+	if (memcmp(rival_block->hash, new_block->hash, SHA256_BYTES) == 0)
+	{
+		return PROPDUPLICATE;
+	}
+
+	if (memcmp(rival_block->prev_hash, new_block->prev_hash, SHA256_BYTES) != 0 ||
+		memcmp(new_block->hash, rival_block->hash, SHA256_BYTES) > 0) // fork resolution - the lowest hash wins on every controller
+	{
+		return PROPDISCARDED;
+	}
+
+	struct Block *orphaned_block = lead_block->prev_block;
+
+	new_block->prev_block = rival_block->prev_block;
+	rival_block->prev_block = NULL;
+	lead_block->prev_block = new_block;
+
+	lead_block->index = new_block->index + 1;
+	memcpy(lead_block->prev_hash, new_block->hash, SHA256_BYTES);
+
+	printf("[~] Fork at block #%u resolved in favour of peer\n", new_block->index);
+
+	reclaim_orphaned_transactions(orphaned_block);
+	destroy_blockchain(orphaned_block);
+
+	compact_blockchain();
+
+	return PROPADOPTED;
+}
+
+ProposalResult handle_replicated_block(struct Block *new_block)
+{
+	uint8_t hash_digest[SHA256_BYTES];
+	compute_block_hash(new_block, hash_digest);
+
+	if (memcmp(hash_digest, new_block->hash, SHA256_BYTES) != 0 || // tampered or malformed
+		!meets_mining_difficulty(new_block->hash, mining_difficulty))
+	{
+		return PROPDISCARDED;
+	}
+
+	if (mining_block == NULL)
+	{
+		return link_replicated_block(new_block);
+	}
+
+	struct Block *sealed_block = find_block(mining_block->prev_block, new_block->index);
+
+	if (new_block->index > mining_block->index ||
+		(sealed_block != NULL && memcmp(sealed_block->hash, new_block->hash, SHA256_BYTES) == 0)) // cannot affect the block being mined
+	{
+		return new_block->index > mining_block->index ? PROPDETACHED : PROPDUPLICATE;
+	}
+
+	struct Block *mined_block = mining_block;
+	struct Block *deferred_block = lead_block; // unwound along with any full blocks queued behind, so the abandoned block is open again
+	struct Block *eldest_deferred_block = lead_block;
+
+	while (eldest_deferred_block->prev_block != mined_block)
+	{
+		eldest_deferred_block = eldest_deferred_block->prev_block;
+	}
+
+	abandon_mining();
+
+	lead_block = mined_block;
+	eldest_deferred_block->prev_block = NULL;
+
+	ProposalResult result = link_replicated_block(new_block);
+
+	if (result != PROPADOPTED) // resume the search from scratch
+	{
+		eldest_deferred_block->prev_block = lead_block;
+		lead_block = deferred_block;
+
+		start_mining(mined_block);
+
+		return result;
+	}
+
+	reclaim_orphaned_transactions(deferred_block);
+	destroy_blockchain(deferred_block);
+
+	return result;
+}
+
 bool record_proposed_transaction_from_client(int client_socket_identifier, const char *node_name, const char *room_name, uint8_t value, bool force_wrap)
 {
 	struct Profile *profile, *tmpProfile;
@@ -153,6 +533,11 @@ cJSON *build_block_transactions_json(struct Block *block)
 		cJSON_AddNumberToObject(transaction_object, "timestamp", block->transactions[i]->timestamp);
 		cJSON_AddBoolToObject(transaction_object, "authorized", block->transactions[i]->authorized);
 
+		if (block->transactions[i]->coalesced_count != 0)
+		{
+			cJSON_AddNumberToObject(transaction_object, "coalesced", block->transactions[i]->coalesced_count);
+		}
+
 		cJSON_AddStringToObject(transaction_object, "profile", block->transactions[i]->profile_identifier);
 
 		cJSON_AddItemToArray(transaction_array, transaction_object);
@@ -161,52 +546,132 @@ cJSON *build_block_transactions_json(struct Block *block)
 	return transaction_array;
 }
 
-cJSON *build_block_json(cJSON *successor_block_json, struct Block *block, bool entire_chain, bool include_transactions)
+/// <summary>
+/// Builds the JSON of a chain as build_block_json does, the first block of the walk being written into the successor object itself.
+/// Checkpointed ancestors are paged in a range at a time, each range destroyed before the one preceding it is paged in.
+/// </summary>
+static cJSON *build_chain_json(cJSON *successor_block_json, struct Block *block, bool is_first, bool entire_chain, bool include_transactions)
 {
-	cJSON *child_block_object = cJSON_CreateObject();
-	cJSON *subject_block_object = block == lead_block ? successor_block_json : child_block_object; // lead block will be a blank cJSON object
+	struct Block *paged_block = NULL; // range being walked, if checkpointed
 
-	cJSON_AddNumberToObject(subject_block_object, "index", block->index);
-	cJSON_AddNumberToObject(subject_block_object, "timestamp", block->timestamp);
+	while (true)
+	{
+		cJSON *child_block_object = cJSON_CreateObject();
+		cJSON *subject_block_object = is_first ? successor_block_json : child_block_object; // lead block will be a blank cJSON object
 
-	char hash_digest_buffer[SHA256_BYTES * 2];
+		cJSON_AddNumberToObject(subject_block_object, "index", block->index);
+		cJSON_AddNumberToObject(subject_block_object, "timestamp", block->timestamp);
+		cJSON_AddNumberToObject(subject_block_object, "nonce", block->nonce);
 
-	for (size_t i = 0; i < SHA256_BYTES - 1; i++) // compute hash string
-	{
-		snprintf(hash_digest_buffer + (i == 0 ? 0 : strlen(hash_digest_buffer)),
-			sizeof(hash_digest_buffer) - strlen(hash_digest_buffer), "%02x", block->hash[i]);
-	}
+		if (block->extra_nonce != 0)
+		{
+			cJSON_AddNumberToObject(subject_block_object, "extraNonce", block->extra_nonce);
+		}
 
-	cJSON_AddStringToObject(subject_block_object, "hash", hash_digest_buffer);
-	cJSON_AddItemToObject(successor_block_json, "prevBlock", child_block_object);
+		char hash_digest_buffer[SHA256_BYTES * 2];
 
-	if (include_transactions)
-	{
-		cJSON_AddItemToObject(subject_block_object, "transactions", build_block_transactions_json(block));
-	}
+		for (size_t i = 0; i < SHA256_BYTES - 1; i++) // compute hash string
+		{
+			snprintf(hash_digest_buffer + (i == 0 ? 0 : strlen(hash_digest_buffer)),
+				sizeof(hash_digest_buffer) - strlen(hash_digest_buffer), "%02x", block->hash[i]);
+		}
 
-	if (entire_chain && block->prev_block != NULL)
-	{
-		return build_block_json(child_block_object, block->prev_block, entire_chain, include_transactions);
+		cJSON_AddStringToObject(subject_block_object, "hash", hash_digest_buffer);
+		cJSON_AddItemToObject(successor_block_json, "prevBlock", child_block_object);
+
+		if (include_transactions)
+		{
+			cJSON_AddItemToObject(subject_block_object, "transactions", build_block_transactions_json(block));
+		}
+
+		struct Block *prev_block = entire_chain ? block->prev_block : NULL;
+
+		if (entire_chain && prev_block == NULL && block->index > 0) // ancestors were checkpointed - page them back in
+		{
+			const uint32_t prev_index = block->index - 1;
+
+			destroy_blockchain(paged_block); // walked through, block included
+			paged_block = prev_block = page_in_checkpoint(prev_index);
+		}
+
+		if (prev_block == NULL)
+		{
+			break;
+		}
+
+		successor_block_json = child_block_object;
+		block = prev_block;
+		is_first = false;
 	}
-	else
+
+	destroy_blockchain(paged_block);
+
+	return successor_block_json;
+}
+
+cJSON *build_block_json(cJSON *successor_block_json, struct Block *block, bool entire_chain, bool include_transactions)
+{
+	return build_chain_json(successor_block_json, block, block == lead_block, entire_chain, include_transactions);
+}
+
+struct Block *copy_resident_blockchain(void)
+{
+	struct Block *copied_lead_block = NULL;
+	struct Block *successor_block = NULL;
+
+	for (struct Block *block = lead_block; block != NULL; block = block->prev_block)
 	{
-		return successor_block_json;
+		struct Block *copied_block = malloc(sizeof(struct Block));
+
+		if (copied_block == NULL)
+		{
+			break;
+		}
+
+		memcpy(copied_block, block, sizeof(struct Block));
+		copied_block->prev_block = NULL;
+
+		for (uint8_t i = 0; i < block->occupied_capacity; i++)
+		{
+			copied_block->transactions[i] = block->transactions[i] != NULL ? malloc(sizeof(struct Transaction)) : NULL;
+
+			if (copied_block->transactions[i] != NULL)
+			{
+				memcpy(copied_block->transactions[i], block->transactions[i], sizeof(struct Transaction));
+			}
+		}
+
+		if (successor_block == NULL)
+		{
+			copied_lead_block = copied_block;
+		}
+		else
+		{
+			successor_block->prev_block = copied_block;
+		}
+
+		successor_block = copied_block;
 	}
+
+	return copied_lead_block;
 }
 
-void emit_block_json(bool entire_chain, bool include_transactions)
+void emit_block_json(struct Block *starting_block, bool entire_chain, bool include_transactions)
 {
 	cJSON *root_block = cJSON_CreateObject();
 	cJSON *root_object = cJSON_CreateObject();
 	cJSON *payload_object = cJSON_CreateObject();
 
-	build_block_json(root_block, lead_block, entire_chain, include_transactions);
+	build_chain_json(root_block, starting_block, true, entire_chain, include_transactions);
 	cJSON_AddItemToObject(payload_object, "leadBlock", root_block);
 
 	cJSON_AddNumberToObject(root_object, "type", 3);
 	cJSON_AddItemToObject(root_object, "payload", payload_object);
 
-	puts(cJSON_Print(root_object));
-	cJSON_free(root_object);
+	char *printed_chain = cJSON_Print(root_object);
+
+	puts(printed_chain);
+
+	cJSON_free(printed_chain);
+	cJSON_Delete(root_object); // freed as it goes, off the event loop there is no arena to reclaim it
 }
\ No newline at end of file
@@ -4,7 +4,37 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "sha256.h"
 #include "cJSON.h"
+#include "node.h"
+
+struct Profile;
+struct Transaction;
+
+/// <summary>
+/// Outcome of evaluating a block proposed by a peer controller.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// The block was linked into the chain.
+	/// </summary>
+	PROPADOPTED = 0,
+	/// <summary>
+	/// The block is already present in the chain.
+	/// </summary>
+	PROPDUPLICATE,
+	/// <summary>
+	/// The block was invalid, lost a fork or targets a checkpointed range.
+	/// </summary>
+	PROPDISCARDED,
+	/// <summary>
+	/// The block's ancestors are missing and must be pulled first.
+	/// </summary>
+	PROPDETACHED
+} ProposalResult;
+
+struct Block *lead_block; // current, unsealed block
 
 /// <summary>
 /// Computes the block hash using a combination of properties as the seed.
@@ -13,6 +43,19 @@
 /// <param name="hash_dest">Destination for computed hash.</param>
 void compute_block_hash(struct Block *block, uint8_t *hash_dest);
 
+/// <summary>
+/// Hashes every block property preceding the nonce, leaving the context open for the nonce to be appended.
+/// </summary>
+/// <param name="block">Subject block.</param>
+/// <param name="context">Context to initialise.</param>
+void prepare_block_hash(struct Block *block, sha256_context *context);
+
+/// <summary>
+/// Gets the eldest block yet to be sealed, which is the block being mined if any.
+/// </summary>
+/// <returns>The block being mined, otherwise the lead block.</returns>
+struct Block *first_unsealed_block(void);
+
 /// <summary>
 /// Builds a new block from the lead block
 /// </summary>
@@ -24,6 +67,40 @@ struct Block *build_new_block(void);
 /// <param name="new_block">The candidate block.</param>
 void handle_proposed_block(struct Block *new_block);
 
+/// <summary>
+/// Evaluates a sealed block received from a peer controller. Forks within the resident chain are resolved in favour of the lowest hash,
+/// re-recording the transactions of the losing branch into the lead block.
+/// </summary>
+/// <param name="new_block">The sealed candidate block, owned by the chain only if adopted.</param>
+/// <returns>Outcome of the proposal.</returns>
+ProposalResult handle_replicated_block(struct Block *new_block);
+
+/// <summary>
+/// Finds a block by index, searching from a block down through its ancestors.
+/// </summary>
+/// <param name="starting_block">The most recent block to search from.</param>
+/// <param name="index">Index of the block.</param>
+/// <returns>The block, or NULL if not resident.</returns>
+struct Block *find_block(struct Block *starting_block, uint32_t index);
+
+/// <summary>
+/// Seals the lead block and succeeds it with a new block, replicating the sealed block to peers.
+/// With proof-of-work enabled, the lead block is handed to the miners, or queued behind the block they are mining, and sealed once a nonce is found.
+/// </summary>
+void seal_lead_block(void);
+
+/// <summary>
+/// Seals the block being mined once the miners have signalled its nonce found, then starts mining the next queued full block, if any.
+/// If every nonce missed the difficulty, the search restarts under the block's next extra nonce instead.
+/// </summary>
+void complete_mined_block(void);
+
+/// <summary>
+/// Appends a transaction to the lead block, sealing it first if at capacity.
+/// </summary>
+/// <param name="transaction">The transaction, owned by the chain thereafter.</param>
+void append_transaction(struct Transaction *transaction);
+
 /// <summary>
 /// Builds a JSON representation of the blockchain to a socket.
 /// </summary>
@@ -45,6 +122,45 @@ bool record_proposed_transaction_from_client(int client_socket_identifier, const
 /// </returns>
 bool record_proposed_transaction(const char *profile_identifier, const char *node_name, const char *room_name, uint8_t value, bool force_wrap);
 
+/// <summary>
+/// Evaluates the settled value of a client's rapid updates to a node against the ruleset and records it as one transaction.
+/// </summary>
+/// <param name="profile_identifier">The profile identifier.</param>
+/// <param name="node_name">Name of the node.</param>
+/// <param name="room_name">Name of the room.</param>
+/// <param name="value">The settled value.</param>
+/// <param name="coalesced_count">Number of updates settled into the value.</param>
+/// <returns>
+///		<c>true</c> if authorized.
+/// </returns>
+bool record_coalesced_transaction(const char *profile_identifier, const char *node_name, const char *room_name, uint8_t value, uint16_t coalesced_count);
+
+/// <summary>
+/// Records a group of transactions already evaluated against the ruleset contiguously,
+/// sealing the current block first if the group would not otherwise fit within one.
+/// </summary>
+/// <param name="profile_identifier">The proposing profile identifier.</param>
+/// <param name="assignments">Node values proposed.</param>
+/// <param name="count">Number of node values.</param>
+/// <param name="authorized">Whether each transaction is authorized.</param>
+void record_authorized_transaction_group(const char *profile_identifier, const struct NodeAssignment *assignments, uint8_t count, const bool *authorized);
+
+/// <summary>
+/// Evaluates a group of transactions proposed together against the ruleset and records them contiguously,
+/// sealing the current block first if the group would not otherwise fit within one.
+/// </summary>
+/// <param name="profile">The proposing profile.</param>
+/// <param name="assignments">Node values proposed.</param>
+/// <param name="count">Number of node values.</param>
+/// <param name="authorized">Output array of whether each transaction was authorized.</param>
+/// <returns>Number of transactions authorized.</returns>
+uint8_t record_proposed_transaction_group(struct Profile *profile, const struct NodeAssignment *assignments, uint8_t count, bool *authorized);
+
+/// <summary>
+/// Persists sealed blocks to a checkpoint once a full range is resident, then evicts them from memory.
+/// </summary>
+void compact_blockchain(void);
+
 /// <summary>
 /// Destroys a block and its ancestores.
 /// </summary>
@@ -75,8 +191,15 @@ cJSON *build_block_transactions_json(struct Block *block);
 cJSON *build_block_json(cJSON *successor_block_json, struct Block *block, bool entire_chain, bool include_transactions);
 
 /// <summary>
-/// Builds and emits a JSON representation of the room structure to a socket.
+/// Copies the resident chain, from the lead block down to the eldest block yet to be checkpointed, to be read off the event loop.
+/// </summary>
+/// <returns>The copied lead block, to be destroyed with destroy_blockchain.</returns>
+struct Block *copy_resident_blockchain(void);
+
+/// <summary>
+/// Builds and prints a JSON representation of the chain from a block, paging in checkpointed ancestors.
 /// </summary>
+/// <param name="starting_block">The block reported as the lead block, or a copy of it.</param>
 /// <param name="entire_chain">if set to <c>true</c> [entire chain] cascades through all ancestor blocks.</param>
 /// <param name="include_transactions">if set to <c>true</c>, serialises all transactions in the block.</param>
-void emit_block_json(bool entire_chain, bool include_transactions);
+void emit_block_json(struct Block *starting_block, bool entire_chain, bool include_transactions);
@@ -56,6 +56,8 @@
 #endif
 
 #include "cJSON.h"
+#include "structural.h"
+#include "numeric.h"
 
 /* define our own boolean type */
 #define true ((cJSON_bool)1)
@@ -210,6 +212,31 @@ static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
 	return node;
 }
 
+/* open addressed table of an object's members, probed linearly from the hash of the case folded name */
+typedef struct cJSON_KeyIndexEntry
+{
+	unsigned int hash;
+	cJSON *item; /* NULL if the slot is empty */
+} cJSON_KeyIndexEntry;
+
+struct cJSON_KeyIndex
+{
+	size_t mask; /* slot count - 1, slot count being a power of two at least twice the member count */
+	cJSON_KeyIndexEntry entries[1];
+};
+
+/* objects with fewer members are searched linearly */
+#define CJSON_KEY_INDEX_THRESHOLD 16
+
+static void invalidate_key_index(cJSON * const object)
+{
+	if ((object != NULL) && (object->key_index != NULL))
+	{
+		global_hooks.deallocate(object->key_index);
+		object->key_index = NULL;
+	}
+}
+
 /* Delete a cJSON structure. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 {
@@ -217,6 +244,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 	while (item != NULL)
 	{
 		next = item->next;
+		invalidate_key_index(item);
 		if (!(item->type & cJSON_IsReference) && (item->child != NULL))
 		{
 			cJSON_Delete(item->child);
@@ -225,7 +253,7 @@ CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
 		{
 			global_hooks.deallocate(item->valuestring);
 		}
-		if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
+		if (!(item->type & (cJSON_StringIsConst | cJSON_StringIsBorrowed)) && (item->string != NULL))
 		{
 			global_hooks.deallocate(item->string);
 		}
@@ -252,6 +280,8 @@ typedef struct
 	size_t offset;
 	size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
 	internal_hooks hooks;
+	struct StructuralIndex *structurals; /* structural index of large inputs, NULL otherwise */
+	cJSON_bool in_situ; /* unescape strings within content, which is then mutable */
 } parse_buffer;
 
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
@@ -475,11 +505,8 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
 {
 	unsigned char *output_pointer = NULL;
 	double d = item->valuedouble;
-	int length = 0;
-	size_t i = 0;
-	unsigned char number_buffer[26]; /* temporary buffer to print the number into */
-	unsigned char decimal_point = get_decimal_point();
-	double test;
+	size_t length = 0;
+	char number_buffer[MAX_NUMBER_LENGTH + 1]; /* temporary buffer to print the number into */
 
 	if (output_buffer == NULL)
 	{
@@ -489,49 +516,24 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
 	/* This checks for NaN and Infinity */
 	if ((d * 0) != 0)
 	{
-		length = sprintf((char*)number_buffer, "null");
+		length = sizeof("null") - sizeof("");
+		memcpy(number_buffer, "null", sizeof("null"));
 	}
 	else
 	{
-		/* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
-		length = sprintf((char*)number_buffer, "%1.15g", d);
-
-		/* Check whether the original double can be recovered */
-		if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || ((double)test != d))
-		{
-			/* If not, print with 17 decimal places of precision */
-			length = sprintf((char*)number_buffer, "%1.17g", d);
-		}
-	}
-
-	/* sprintf failed or buffer overrun occured */
-	if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1)))
-	{
-		return false;
+		/* shortest representation that parses back to the same double, with '.' whatever the locale */
+		length = format_number(d, number_buffer);
 	}
 
 	/* reserve appropriate space in the output */
-	output_pointer = ensure(output_buffer, (size_t)length + sizeof(""));
+	output_pointer = ensure(output_buffer, length + sizeof(""));
 	if (output_pointer == NULL)
 	{
 		return false;
 	}
 
-	/* copy the printed number to the output and replace locale
-	 * dependent decimal point with '.' */
-	for (i = 0; i < ((size_t)length); i++)
-	{
-		if (number_buffer[i] == decimal_point)
-		{
-			output_pointer[i] = '.';
-			continue;
-		}
-
-		output_pointer[i] = number_buffer[i];
-	}
-	output_pointer[i] = '\0';
-
-	output_buffer->offset += (size_t)length;
+	memcpy(output_pointer, number_buffer, length + sizeof(""));
+	output_buffer->offset += length;
 
 	return true;
 }
@@ -708,6 +710,16 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 		goto fail;
 	}
 
+	if (input_buffer->structurals != NULL)
+	{
+		/* only unescaped quotes are indexed within a string, so the next position is the closing quote */
+		size_t closing = next_structural_position(input_buffer->structurals, input_buffer->offset + 1);
+		if ((closing < input_buffer->length) && (input_buffer->content[closing] == '\"'))
+		{
+			input_end = input_buffer->content + closing;
+		}
+	}
+
 	{
 		/* calculate approximate size of the output (overestimate) */
 		size_t allocation_length = 0;
@@ -732,12 +744,20 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 			goto fail; /* string ended unexpectedly */
 		}
 
-		/* This is at most how much we need for the output */
-		allocation_length = (size_t)(input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-		output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
-		if (output == NULL)
+		if (input_buffer->in_situ)
 		{
-			goto fail; /* allocation failure */
+			/* unescaping never lengthens a string, so it is written over itself and terminated at the latest on the closing quote */
+			output = (unsigned char*)input_pointer;
+		}
+		else
+		{
+			/* This is at most how much we need for the output */
+			allocation_length = (size_t)(input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+			output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+			if (output == NULL)
+			{
+				goto fail; /* allocation failure */
+			}
 		}
 	}
 
@@ -747,7 +767,15 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 	{
 		if (*input_pointer != '\\')
 		{
-			*output_pointer++ = *input_pointer++;
+			/* copy the run up to the next escape sequence at once */
+			const unsigned char *escape = (const unsigned char*)memchr(input_pointer, '\\', (size_t)(input_end - input_pointer));
+			size_t run_length = (size_t)(((escape != NULL) ? escape : input_end) - input_pointer);
+			if (output_pointer != input_pointer)
+			{
+				memmove(output_pointer, input_pointer, run_length);
+			}
+			output_pointer += run_length;
+			input_pointer += run_length;
 		}
 		/* escape sequence */
 		else
@@ -801,7 +829,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 	/* zero terminate the output */
 	*output_pointer = '\0';
 
-	item->type = cJSON_String;
+	item->type = input_buffer->in_situ ? (cJSON_String | cJSON_IsReference) : cJSON_String;
 	item->valuestring = (char*)output;
 
 	input_buffer->offset = (size_t)(input_end - input_buffer->content);
@@ -810,7 +838,7 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
 	return true;
 
 fail:
-	if (output != NULL)
+	if ((output != NULL) && !input_buffer->in_situ)
 	{
 		input_buffer->hooks.deallocate(output);
 	}
@@ -967,6 +995,12 @@ static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
 		return NULL;
 	}
 
+	/* outside of strings, everything between indexed positions is whitespace */
+	if ((buffer->structurals != NULL) && can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+	{
+		buffer->offset = next_structural_position(buffer->structurals, buffer->offset);
+	}
+
 	while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
 	{
 		buffer->offset++;
@@ -997,9 +1031,10 @@ static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
 }
 
 /* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+static cJSON *parse_with_opts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated, cJSON_bool in_situ)
 {
-	parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+	parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0, 0 };
+	struct StructuralIndex structurals;
 	cJSON *item = NULL;
 
 	/* reset error position */
@@ -1015,6 +1050,14 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
 	buffer.length = strlen((const char*)value) + sizeof("");
 	buffer.offset = 0;
 	buffer.hooks = global_hooks;
+	buffer.in_situ = in_situ;
+
+	/* index large inputs up front, so whitespace and string contents can be jumped over */
+	if (STRUCTURAL_INDEX_VECTORIZED && (buffer.length >= STRUCTURAL_INDEX_THRESHOLD) && (buffer.length <= UINT32_MAX))
+	{
+		init_structural_index(&structurals, buffer.content, buffer.length);
+		buffer.structurals = &structurals;
+	}
 
 	item = cJSON_New_Item(&global_hooks);
 	if (item == NULL) /* memory fail */
@@ -1076,6 +1119,16 @@ fail:
 	return NULL;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+	return parse_with_opts(value, return_parse_end, require_null_terminated, false);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value)
+{
+	return parse_with_opts(value, 0, 0, true);
+}
+
 /* Default options for cJSON_Parse */
 CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
 {
@@ -1497,6 +1550,7 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
 {
 	cJSON *head = NULL; /* linked list head */
 	cJSON *current_item = NULL;
+	cJSON_bool value_parsed = false;
 
 	if (input_buffer->depth >= CJSON_NESTING_LIMIT)
 	{
@@ -1561,6 +1615,10 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
 		/* swap valuestring and string, because we parsed the name */
 		current_item->string = current_item->valuestring;
 		current_item->valuestring = NULL;
+		if (input_buffer->in_situ)
+		{
+			current_item->type = cJSON_StringIsBorrowed;
+		}
 
 		if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
 		{
@@ -1570,7 +1628,13 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
 		/* parse the value */
 		input_buffer->offset++;
 		buffer_skip_whitespace(input_buffer);
-		if (!parse_value(current_item, input_buffer))
+		value_parsed = parse_value(current_item, input_buffer);
+		if (input_buffer->in_situ)
+		{
+			/* parsing the value sets the type, so the borrowed name is flagged again (even on failure, for cJSON_Delete) */
+			current_item->type |= cJSON_StringIsBorrowed;
+		}
+		if (!value_parsed)
 		{
 			goto fail; /* failed to parse value */
 		}
@@ -1767,15 +1831,122 @@ CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
 	return get_array_item(array, (size_t)index);
 }
 
+/* FNV-1a over the case folded name, so both kinds of lookup share an index */
+static unsigned int hash_key(const unsigned char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	for (; *name != '\0'; name++)
+	{
+		hash = (hash ^ (unsigned int)tolower(*name)) * 16777619U;
+	}
+
+	return hash;
+}
+
+static struct cJSON_KeyIndex *build_key_index(cJSON * const object, size_t member_count)
+{
+	struct cJSON_KeyIndex *key_index = NULL;
+	cJSON *current_element = NULL;
+	size_t slot_count = 2;
+
+	while (slot_count < (member_count * 2))
+	{
+		slot_count *= 2;
+	}
+
+	key_index = (struct cJSON_KeyIndex*)global_hooks.allocate(sizeof(struct cJSON_KeyIndex) + ((slot_count - 1) * sizeof(cJSON_KeyIndexEntry)));
+	if (key_index == NULL)
+	{
+		return NULL;
+	}
+
+	memset(key_index->entries, '\0', slot_count * sizeof(cJSON_KeyIndexEntry));
+	key_index->mask = slot_count - 1;
+
+	/* inserted in list order, so a probe meets duplicate names in list order too */
+	for (current_element = object->child; current_element != NULL; current_element = current_element->next)
+	{
+		unsigned int hash = 0;
+		size_t slot = 0;
+
+		if (current_element->string == NULL)
+		{
+			continue;
+		}
+
+		hash = hash_key((const unsigned char*)current_element->string);
+		slot = hash & key_index->mask;
+		while (key_index->entries[slot].item != NULL)
+		{
+			slot = (slot + 1) & key_index->mask;
+		}
+
+		key_index->entries[slot].hash = hash;
+		key_index->entries[slot].item = current_element;
+	}
+
+	object->key_index = key_index;
+
+	return key_index;
+}
+
+static cJSON *get_indexed_object_item(const struct cJSON_KeyIndex * const key_index, const char * const name, const cJSON_bool case_sensitive)
+{
+	const unsigned int hash = hash_key((const unsigned char*)name);
+	size_t slot = hash & key_index->mask;
+
+	for (; key_index->entries[slot].item != NULL; slot = (slot + 1) & key_index->mask)
+	{
+		const cJSON_KeyIndexEntry *entry = &key_index->entries[slot];
+
+		if ((entry->hash == hash) && ((case_sensitive ? strcmp(name, entry->item->string) : case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)entry->item->string)) == 0))
+		{
+			return entry->item;
+		}
+	}
+
+	return NULL;
+}
+
 static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
 {
 	cJSON *current_element = NULL;
+	size_t member_count = 0;
 
 	if ((object == NULL) || (name == NULL))
 	{
 		return NULL;
 	}
 
+	if (object->key_index != NULL)
+	{
+		return get_indexed_object_item(object->key_index, name, case_sensitive);
+	}
+
+	/* a reference shares its members with the original, so only the original may index them */
+	if (!(object->type & cJSON_IsReference) && cJSON_IsObject(object))
+	{
+		for (current_element = object->child; (current_element != NULL) && (member_count < CJSON_KEY_INDEX_THRESHOLD); current_element = current_element->next)
+		{
+			member_count++;
+		}
+
+		if (current_element != NULL)
+		{
+			/* large object, the index pays off from the next lookup on */
+			for (; current_element != NULL; current_element = current_element->next)
+			{
+				member_count++;
+			}
+
+			if (build_key_index((cJSON*)object, member_count) != NULL)
+			{
+				return get_indexed_object_item(object->key_index, name, case_sensitive);
+			}
+		}
+	}
+
 	current_element = object->child;
 	if (case_sensitive)
 	{
@@ -1834,6 +2005,7 @@ static cJSON *create_reference(const cJSON *item, const internal_hooks * const h
 
 	memcpy(reference, item, sizeof(cJSON));
 	reference->string = NULL;
+	reference->key_index = NULL;
 	reference->type |= cJSON_IsReference;
 	reference->next = reference->prev = NULL;
 	return reference;
@@ -1848,6 +2020,7 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
 		return false;
 	}
 
+	invalidate_key_index(array);
 	child = array->child;
 
 	if (child == NULL)
@@ -1915,8 +2088,9 @@ static cJSON_bool add_item_to_object(cJSON * const object, const char * const st
 
 		new_type = item->type & ~cJSON_StringIsConst;
 	}
+	new_type &= ~cJSON_StringIsBorrowed;
 
-	if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
+	if (!(item->type & (cJSON_StringIsConst | cJSON_StringIsBorrowed)) && (item->string != NULL))
 	{
 		hooks->deallocate(item->string);
 	}
@@ -2073,6 +2247,8 @@ CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const it
 		return NULL;
 	}
 
+	invalidate_key_index(parent);
+
 	if (item->prev != NULL)
 	{
 		/* not the first element */
@@ -2152,6 +2328,7 @@ CJSON_PUBLIC(void) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newit
 		return;
 	}
 
+	invalidate_key_index(array);
 	newitem->next = after_inserted;
 	newitem->prev = after_inserted->prev;
 	after_inserted->prev = newitem;
@@ -2177,6 +2354,7 @@ CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON
 		return true;
 	}
 
+	invalidate_key_index(parent);
 	replacement->next = item->next;
 	replacement->prev = item->prev;
 
@@ -2218,12 +2396,12 @@ static cJSON_bool replace_item_in_object(cJSON *object, const char *string, cJSO
 	}
 
 	/* replace the name in the replacement */
-	if (!(replacement->type & cJSON_StringIsConst) && (replacement->string != NULL))
+	if (!(replacement->type & (cJSON_StringIsConst | cJSON_StringIsBorrowed)) && (replacement->string != NULL))
 	{
 		cJSON_free(replacement->string);
 	}
 	replacement->string = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
-	replacement->type &= ~cJSON_StringIsConst;
+	replacement->type &= ~(cJSON_StringIsConst | cJSON_StringIsBorrowed);
 
 	cJSON_ReplaceItemViaPointer(object, get_object_item(object, string, case_sensitive), replacement);
 
@@ -2564,7 +2742,7 @@ CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
 		goto fail;
 	}
 	/* Copy over all vars */
-	newitem->type = item->type & (~cJSON_IsReference);
+	newitem->type = item->type & (~(cJSON_IsReference | cJSON_StringIsBorrowed));
 	newitem->valueint = item->valueint;
 	newitem->valuedouble = item->valuedouble;
 	if (item->valuestring)
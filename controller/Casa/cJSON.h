@@ -98,6 +98,7 @@ extern "C"
 
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
+#define cJSON_StringIsBorrowed 1024 /* string points into the buffer given to cJSON_ParseInSitu */
 
 /* The cJSON structure: */
 	typedef struct cJSON
@@ -120,6 +121,9 @@ extern "C"
 
 		/* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
 		char *string;
+
+		/* Hash index of an object's member names, built on lookup once the object is large and dropped when its members change. Internal to cJSON. */
+		struct cJSON_KeyIndex *key_index;
 	} cJSON;
 
 	typedef struct cJSON_Hooks
@@ -149,6 +153,9 @@ extern "C"
 	/* ParseWithOpts allows you to require (and check) that the JSON is null terminated, and to retrieve the pointer to the final byte parsed. */
 	/* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
 	CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
+	/* ParseInSitu unescapes strings in place within the supplied buffer, and points valuestring and string into it instead of allocating them. */
+	/* Borrowed strings are flagged (cJSON_IsReference, cJSON_StringIsBorrowed) so cJSON_Delete leaves them be; the buffer must outlive the result, and is left modified even if parsing fails. */
+	CJSON_PUBLIC(cJSON *) cJSON_ParseInSitu(char *value);
 
 	/* Render a cJSON entity to text for transfer/storage. */
 	CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
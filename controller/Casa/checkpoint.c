@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+
+#include "block.h"
+#include "blockchain.h"
+
+/// <summary>
+/// Builds the path of the checkpoint file beginning at a block index.
+/// </summary>
+/// <param name="path">Destination buffer.</param>
+/// <param name="path_size">Size of the destination buffer.</param>
+/// <param name="start_index">Index of the first block in the range.</param>
+static void build_checkpoint_path(char *path, size_t path_size, uint32_t start_index)
+{
+	snprintf(path, path_size, "%s%010u%s", LEDGER_DIRECTORY, start_index, LEDGER_EXTENSION);
+}
+
+uint32_t checkpoint_start_index(uint32_t block_index)
+{
+	return block_index - (block_index % CHECKPOINT_INTERVAL);
+}
+
+int persist_checkpoint(struct Block *end_block, struct Checkpoint *checkpoint)
+{
+	struct Block *range[CHECKPOINT_INTERVAL];
+	uint8_t range_size = 0;
+
+	for (struct Block *block = end_block; block != NULL && range_size < CHECKPOINT_INTERVAL; block = block->prev_block)
+	{
+		range[range_size++] = block;
+	}
+
+	if (range_size == 0)
+	{
+		return -1;
+	}
+
+	checkpoint->start_index = range[range_size - 1]->index;
+	checkpoint->end_index = end_block->index;
+
+	memcpy(checkpoint->hash, end_block->hash, SHA256_BYTES);
+
+	mkdir(LEDGER_DIRECTORY, S_IRWXU);
+
+	char checkpoint_path[64];
+	build_checkpoint_path(checkpoint_path, sizeof(checkpoint_path), checkpoint->start_index);
+
+	FILE *checkpoint_file = fopen(checkpoint_path, "wb");
+
+	if (checkpoint_file == NULL)
+	{
+		return -1;
+	}
+
+	bool written = fwrite(checkpoint, sizeof(struct Checkpoint), 1, checkpoint_file) == 1;
+
+	for (int8_t i = range_size - 1; i >= 0 && written; i--) // eldest first
+	{
+		struct Block *block = range[i];
+
+		written = fwrite(&block->index, sizeof(block->index), 1, checkpoint_file) == 1 &&
+			fwrite(&block->timestamp, sizeof(block->timestamp), 1, checkpoint_file) == 1 &&
+			fwrite(&block->occupied_capacity, sizeof(block->occupied_capacity), 1, checkpoint_file) == 1 &&
+			fwrite(block->hash, SHA256_BYTES, 1, checkpoint_file) == 1 &&
+			fwrite(block->prev_hash, SHA256_BYTES, 1, checkpoint_file) == 1 &&
+			fwrite(&block->nonce, sizeof(block->nonce), 1, checkpoint_file) == 1 &&
+			fwrite(&block->extra_nonce, sizeof(block->extra_nonce), 1, checkpoint_file) == 1;
+
+		for (uint8_t j = 0; j < block->occupied_capacity && written; j++)
+		{
+			written = fwrite(block->transactions[j], sizeof(struct Transaction), 1, checkpoint_file) == 1;
+		}
+	}
+
+	if (fclose(checkpoint_file) != 0 || !written)
+	{
+		remove(checkpoint_path); // never leave a partial range behind
+
+		return -1;
+	}
+
+	return 0;
+}
+
+struct Block *page_in_checkpoint(uint32_t block_index)
+{
+	char checkpoint_path[64];
+	build_checkpoint_path(checkpoint_path, sizeof(checkpoint_path), checkpoint_start_index(block_index));
+
+	FILE *checkpoint_file = fopen(checkpoint_path, "rb");
+
+	if (checkpoint_file == NULL)
+	{
+		return NULL;
+	}
+
+	struct Checkpoint checkpoint;
+	struct Block *end_block = NULL;
+
+	if (fread(&checkpoint, sizeof(struct Checkpoint), 1, checkpoint_file) != 1)
+	{
+		fclose(checkpoint_file);
+
+		return NULL;
+	}
+
+	for (uint32_t i = checkpoint.start_index; i <= checkpoint.end_index; i++)
+	{
+		struct Block *block = calloc(1, sizeof(struct Block));
+
+		if (block == NULL)
+		{
+			destroy_blockchain(end_block);
+			end_block = NULL;
+
+			break;
+		}
+
+		bool read = fread(&block->index, sizeof(block->index), 1, checkpoint_file) == 1 &&
+			fread(&block->timestamp, sizeof(block->timestamp), 1, checkpoint_file) == 1 &&
+			fread(&block->occupied_capacity, sizeof(block->occupied_capacity), 1, checkpoint_file) == 1 &&
+			fread(block->hash, SHA256_BYTES, 1, checkpoint_file) == 1 &&
+			fread(block->prev_hash, SHA256_BYTES, 1, checkpoint_file) == 1 &&
+			fread(&block->nonce, sizeof(block->nonce), 1, checkpoint_file) == 1 &&
+			fread(&block->extra_nonce, sizeof(block->extra_nonce), 1, checkpoint_file) == 1 &&
+			block->occupied_capacity <= BLOCK_SIZE;
+
+		for (uint8_t j = 0; j < block->occupied_capacity && read; j++)
+		{
+			block->transactions[j] = malloc(sizeof(struct Transaction));
+			read = block->transactions[j] != NULL && fread(block->transactions[j], sizeof(struct Transaction), 1, checkpoint_file) == 1;
+		}
+
+		block->prev_block = end_block;
+		end_block = block;
+
+		if (!read) // corrupt range
+		{
+			destroy_blockchain(end_block);
+			end_block = NULL;
+
+			break;
+		}
+	}
+
+	fclose(checkpoint_file);
+
+	return end_block;
+}
+
+int restore_latest_checkpoint(struct Checkpoint *checkpoint)
+{
+	DIR *directory;
+
+	if (!(directory = opendir(LEDGER_DIRECTORY)))
+	{
+		return -1;
+	}
+
+	struct dirent *dir;
+
+	bool found = false;
+	uint32_t latest_start_index = 0;
+
+	const size_t ext_len = strlen(LEDGER_EXTENSION);
+
+	while ((dir = readdir(directory)) != NULL)
+	{
+		const size_t str_len = strlen(dir->d_name);
+
+		if (str_len <= ext_len || strcmp(dir->d_name + (str_len - ext_len), LEDGER_EXTENSION) != 0)
+		{
+			continue;
+		}
+
+		uint32_t start_index = (uint32_t)strtoul(dir->d_name, NULL, 10);
+
+		if (!found || start_index > latest_start_index)
+		{
+			latest_start_index = start_index;
+			found = true;
+		}
+	}
+
+	closedir(directory);
+
+	if (!found)
+	{
+		return -1;
+	}
+
+	char checkpoint_path[64];
+	build_checkpoint_path(checkpoint_path, sizeof(checkpoint_path), latest_start_index);
+
+	FILE *checkpoint_file = fopen(checkpoint_path, "rb");
+
+	if (checkpoint_file == NULL)
+	{
+		return -1;
+	}
+
+	bool read = fread(checkpoint, sizeof(struct Checkpoint), 1, checkpoint_file) == 1;
+	fclose(checkpoint_file);
+
+	return read ? 0 : -1;
+}
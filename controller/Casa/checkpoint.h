@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "block.h"
+
+#define LEDGER_DIRECTORY "./ledger/"
+#define LEDGER_EXTENSION ".casal"
+
+#define CHECKPOINT_INTERVAL 16 // sealed blocks held in memory before being persisted
+
+/// <summary>
+/// struct of a checkpoint header, describing a persisted block range.
+/// </summary>
+struct Checkpoint
+{
+	uint32_t start_index;
+	uint32_t end_index;
+
+	uint8_t hash[SHA256_BYTES]; // hash of the final block in the range
+};
+
+/// <summary>
+/// Resolves the index of the first block within the checkpoint range holding a block.
+/// </summary>
+/// <param name="block_index">Index of the subject block.</param>
+/// <returns>Index of the first block in the range.</returns>
+uint32_t checkpoint_start_index(uint32_t block_index);
+
+/// <summary>
+/// Persists a range of sealed blocks to disk, from the passed block down to its eldest resident ancestor.
+/// Ranges are persisted whole, so blocks sealed since the last range live only in memory,
+/// and are lost if the controller stops unless a peer still holds them to be pulled back.
+/// </summary>
+/// <param name="end_block">Most recent block of the range.</param>
+/// <param name="checkpoint">Output reference to the written checkpoint header.</param>
+/// <returns>0 if successful, -1 on failure.</returns>
+int persist_checkpoint(struct Block *end_block, struct Checkpoint *checkpoint);
+
+/// <summary>
+/// Pages a persisted block range back into memory.
+/// </summary>
+/// <param name="block_index">Index of any block within the range.</param>
+/// <returns>Most recent block of the range, linked to its ancestors - must be destroyed by the caller. NULL if not found.</returns>
+struct Block *page_in_checkpoint(uint32_t block_index);
+
+/// <summary>
+/// Reads the header of the most recent checkpoint on disk.
+/// </summary>
+/// <param name="checkpoint">Output reference to the checkpoint header.</param>
+/// <returns>0 if a checkpoint was found, -1 otherwise.</returns>
+int restore_latest_checkpoint(struct Checkpoint *checkpoint);
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "uthash.h"
+
+#include "coalesce.h"
+#include "controller.h"
+#include "blockchain.h"
+
+uint64_t monotonic_milliseconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void apply_coalesced_write(struct CoalescedWrite *write, uint64_t now)
+{
+	apply_value_to_resolved_node(write->room, write->node, write->value);
+
+	write->is_applied = true;
+	write->applied_at = now;
+}
+
+/// <summary>
+/// Applies a node's settled value if still pending and records it, vacating its place.
+/// </summary>
+static void settle_coalesced_write(struct WriteCoalescer *coalescer, uint8_t index, uint64_t now)
+{
+	struct CoalescedWrite *write = &coalescer->writes[index];
+
+	if (!write->is_applied)
+	{
+		apply_coalesced_write(write, now);
+	}
+
+	record_coalesced_transaction(write->profile_identifier, write->node->name, write->room->name, write->value, write->update_count);
+
+	if (write->update_count > 1)
+	{
+		printf("[<] Set %s (%s) to %d, coalesced %u updates\n", write->node->name, write->room->name, write->value, write->update_count);
+	}
+	else
+	{
+		printf("[<] Set %s (%s) to %d\n", write->node->name, write->room->name, write->value);
+	}
+
+	coalescer->writes[index] = coalescer->writes[--coalescer->write_count];
+}
+
+bool coalesce_node_write(struct WriteCoalescer *coalescer, const struct Profile *profile, const char *room_name, const char *node_name, int value, uint64_t now)
+{
+	struct Room *room;
+	struct Node *node = NULL;
+
+	HASH_FIND_STR(rooms, room_name, room);
+
+	if (room != NULL)
+	{
+		HASH_FIND_STR(room->nodes, node_name, node);
+	}
+
+	if (node == NULL)
+	{
+		return false;
+	}
+
+	uint8_t eldest = 0;
+
+	for (uint8_t i = 0; i < coalescer->write_count; i++)
+	{
+		struct CoalescedWrite *write = &coalescer->writes[i];
+
+		if (write->node == node && strcmp(write->profile_identifier, profile->identifier) == 0)
+		{
+			write->value = value;
+			write->updated_at = now;
+			write->is_applied = false;
+
+			if (write->update_count < UINT16_MAX)
+			{
+				write->update_count++;
+			}
+
+			if (now - write->applied_at >= COALESCE_APPLY_INTERVAL)
+			{
+				apply_coalesced_write(write, now);
+			}
+
+			settle_coalesced_writes(coalescer, now, false); // reschedules for this window
+
+			return true;
+		}
+
+		if (write->updated_at < coalescer->writes[eldest].updated_at)
+		{
+			eldest = i;
+		}
+	}
+
+	if (coalescer->write_count == MAX_COALESCED_NODES) // make room
+	{
+		settle_coalesced_write(coalescer, eldest, now);
+	}
+
+	struct CoalescedWrite *write = &coalescer->writes[coalescer->write_count++];
+
+	write->room = room;
+	write->node = node;
+	strcpy(write->profile_identifier, profile->identifier);
+
+	write->value = value;
+	write->update_count = 1;
+	write->updated_at = now;
+
+	apply_coalesced_write(write, now); // the first update of a window is never delayed
+
+	settle_coalesced_writes(coalescer, now, false); // reschedules for this window
+
+	return true;
+}
+
+static void settle_due_writes(struct Timer *timer, void *context)
+{
+	(void)timer; // the coalescer's own, reached through the context
+
+	settle_coalesced_writes(context, monotonic_milliseconds(), false);
+}
+
+uint64_t settle_coalesced_writes(struct WriteCoalescer *coalescer, uint64_t now, bool is_final)
+{
+	uint64_t next_deadline = NO_COALESCING_DEADLINE;
+
+	for (uint8_t i = 0; i < coalescer->write_count;)
+	{
+		struct CoalescedWrite *write = &coalescer->writes[i];
+
+		if (is_final || now - write->updated_at >= COALESCE_SETTLE_WINDOW)
+		{
+			settle_coalesced_write(coalescer, i, now); // the last write takes this place, so i is not advanced
+			continue;
+		}
+
+		uint64_t deadline = write->updated_at + COALESCE_SETTLE_WINDOW;
+
+		if (!write->is_applied)
+		{
+			if (now - write->applied_at >= COALESCE_APPLY_INTERVAL)
+			{
+				apply_coalesced_write(write, now);
+			}
+			else if (write->applied_at + COALESCE_APPLY_INTERVAL < deadline)
+			{
+				deadline = write->applied_at + COALESCE_APPLY_INTERVAL;
+			}
+		}
+
+		if (deadline < next_deadline)
+		{
+			next_deadline = deadline;
+		}
+
+		i++;
+	}
+
+	if (next_deadline != NO_COALESCING_DEADLINE)
+	{
+		schedule_timer(&coalescer->timer, next_deadline - now, settle_due_writes, coalescer);
+	}
+	else
+	{
+		cancel_timer(&coalescer->timer);
+	}
+
+	return next_deadline;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "node.h"
+#include "room.h"
+#include "profile.h"
+#include "timer.h"
+
+#define COALESCE_APPLY_INTERVAL 50 // milliseconds between pin writes of a node receiving a stream of updates
+#define COALESCE_SETTLE_WINDOW 300 // milliseconds without updates before a node's value is recorded
+#define MAX_COALESCED_NODES 8 // nodes a client may have unsettled at once, the eldest settles early beyond
+#define NO_COALESCING_DEADLINE UINT64_MAX
+
+/// <summary>
+/// struct of a node a client is updating in quick succession, such as by dragging a slider.
+/// </summary>
+struct CoalescedWrite
+{
+	struct Room *room;
+	struct Node *node;
+	char profile_identifier[MAX_SET_SIZE];
+
+	int value; // latest received
+	uint16_t update_count;
+	bool is_applied; // the latest value is on the pins
+
+	uint64_t applied_at;
+	uint64_t updated_at;
+};
+
+/// <summary>
+/// struct of a client's unsettled node writes, by node.
+/// </summary>
+struct WriteCoalescer
+{
+	struct CoalescedWrite writes[MAX_COALESCED_NODES];
+	uint8_t write_count;
+
+	struct Timer timer; // due at the next deadline of any write
+};
+
+/// <summary>
+/// Reads a monotonic clock.
+/// </summary>
+/// <returns>Milliseconds since an arbitrary epoch.</returns>
+uint64_t monotonic_milliseconds(void);
+
+/// <summary>
+/// Takes an authorized update to a node into its coalescing window. The first value of a window is applied at once,
+/// later ones at most every COALESCE_APPLY_INTERVAL, and the settled value is recorded to the ledger once.
+/// </summary>
+/// <param name="coalescer">Coalescer of the issuing client.</param>
+/// <param name="profile">Profile of the issuing client, permitted the node.</param>
+/// <param name="room_name">Name of the room.</param>
+/// <param name="node_name">Name of the node.</param>
+/// <param name="value">New value.</param>
+/// <param name="now">Current time, from monotonic_milliseconds.</param>
+/// <returns>
+///   <c>true</c> if taken; <c>false</c> if the node does not exist.
+/// </returns>
+bool coalesce_node_write(struct WriteCoalescer *coalescer, const struct Profile *profile, const char *room_name, const char *node_name, int value, uint64_t now);
+
+/// <summary>
+/// Applies values whose rate limit has passed and records nodes whose window has elapsed, then schedules the coalescer's timer for the next deadline.
+/// </summary>
+/// <param name="coalescer">Coalescer of a client.</param>
+/// <param name="now">Current time, from monotonic_milliseconds.</param>
+/// <param name="is_final">if set to <c>true</c>, settles every node regardless, as the client is leaving.</param>
+/// <returns>Time of the next deadline, or NO_COALESCING_DEADLINE if none remains.</returns>
+uint64_t settle_coalesced_writes(struct WriteCoalescer *coalescer, uint64_t now, bool is_final);
@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "codec.h"
+
+#include "uthash.h"
+
+#include "command.h"
+#include "controller.h"
+#include "room.h"
+#include "parser.h"
+#include "writer.h"
+
+static uint8_t client_encodings[MAX_CLIENT_SOCKETS]; // zeroed, so JSON
+
+static const char *wire_encoding_names[WIRE_ENCODING_COUNT] =
+{
+	"json",
+	"msgpack"
+};
+
+WireEncoding resolve_wire_encoding(const char *name)
+{
+	for (uint8_t i = 0; i < WIRE_ENCODING_COUNT; i++)
+	{
+		if (strcmp(wire_encoding_names[i], name) == 0)
+		{
+			return (WireEncoding)i;
+		}
+	}
+
+	return ENCODINGJSON;
+}
+
+WireEncoding find_client_encoding(int client_socket)
+{
+	if (client_socket < 0 || client_socket >= MAX_CLIENT_SOCKETS)
+	{
+		return ENCODINGJSON;
+	}
+
+	return (WireEncoding)client_encodings[client_socket];
+}
+
+void set_client_encoding(int client_socket, WireEncoding encoding)
+{
+	if (client_socket >= 0 && client_socket < MAX_CLIENT_SOCKETS)
+	{
+		client_encodings[client_socket] = encoding;
+	}
+}
+
+bool decode_command(const char *message, size_t length, struct CommandMessage *command)
+{
+	if (is_packed_command(message, length))
+	{
+		return parse_packed_command(message, length, command);
+	}
+
+	return parse_command(message, length, command);
+}
+
+/// <summary>
+/// struct of a client command in the benchmark mix.
+/// </summary>
+struct SampleCommand
+{
+	Command type;
+	const char *subtype;
+
+	const char *room;
+	const char *node;
+	int value;
+	const char *nonce;
+};
+
+static const struct SampleCommand sample_commands[] = // weighted as clients issue them - mostly node changes
+{
+	{ CMDNODE, NULL, "home", "porch_light", 40, "kz3f9q1x0a7c" },
+	{ CMDNODE, NULL, "lounge", "fireplace", 1, "kz3f9r2d8m4p" },
+	{ CMDNODE, NULL, "home", "side_lighting", 16762880, "kz3f9s0b1w6e" },
+	{ CMDNODE, NULL, "garage", "entrance_light", 60, NULL },
+	{ .type = CMDREPORT, .subtype = "system" },
+	{ .type = CMDCONFIRMATION }
+};
+
+/// <summary>
+/// Writes a sample command as a client would send it.
+/// </summary>
+static void write_sample_command(struct DocumentWriter *writer, const struct SampleCommand *sample)
+{
+	begin_document_object(writer);
+	write_document_key(writer, "type");
+	write_document_integer(writer, sample->type);
+
+	if (sample->type == CMDNODE)
+	{
+		write_document_key(writer, "payload");
+		begin_document_object(writer);
+		write_document_key(writer, "room");
+		write_document_string(writer, sample->room);
+		write_document_key(writer, "node");
+		write_document_string(writer, sample->node);
+		write_document_key(writer, "value");
+		write_document_integer(writer, sample->value);
+
+		if (sample->nonce != NULL)
+		{
+			write_document_key(writer, "nonce");
+			write_document_string(writer, sample->nonce);
+		}
+
+		end_document_object(writer);
+	}
+	else if (sample->type == CMDREPORT)
+	{
+		write_document_key(writer, "payload");
+		begin_document_object(writer);
+		write_document_key(writer, "type");
+		write_document_string(writer, sample->subtype);
+		end_document_object(writer);
+	}
+
+	end_document_object(writer);
+}
+
+/// <summary>
+/// Writes every room and node, as the structure report does for a profile permitted all of them.
+/// </summary>
+static void write_sample_structure(struct DocumentWriter *writer)
+{
+	struct Room *room, *tmpRoom;
+	struct Node *node, *tmpNode;
+
+	begin_document_object(writer);
+	write_document_key(writer, "type");
+	write_document_integer(writer, CMDREPORT);
+	write_document_key(writer, "payload");
+	begin_document_object(writer);
+	write_document_key(writer, "type");
+	write_document_string(writer, "rooms");
+	write_document_key(writer, "value");
+	begin_document_array(writer);
+
+	HASH_ITER(hh, rooms, room, tmpRoom)
+	{
+		begin_document_object(writer);
+		write_document_key(writer, "nodes");
+		begin_document_array(writer);
+
+		HASH_ITER(hh, room->nodes, node, tmpNode)
+		{
+			begin_document_object(writer);
+			write_document_key(writer, "name");
+			write_document_string(writer, node->name);
+			write_document_key(writer, "type");
+			write_document_string(writer, node_type_ref[node->type]);
+			write_document_key(writer, "value");
+			write_document_integer(writer, node->value);
+			end_document_object(writer);
+		}
+
+		end_document_array(writer);
+		write_document_key(writer, "name");
+		write_document_string(writer, room->name);
+		write_document_key(writer, "temperature");
+		write_document_number(writer, 22.5);
+		end_document_object(writer);
+	}
+
+	end_document_array(writer);
+	end_document_object(writer);
+	end_document_object(writer);
+}
+
+static double elapsed_nanoseconds(struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+void benchmark_wire_encodings(unsigned int iterations)
+{
+	const size_t command_count = sizeof(sample_commands) / sizeof(sample_commands[0]);
+
+	char commands[WIRE_ENCODING_COUNT][sizeof(sample_commands) / sizeof(sample_commands[0])][MAX_COMMAND_LENGTH];
+	size_t command_lengths[WIRE_ENCODING_COUNT][sizeof(sample_commands) / sizeof(sample_commands[0])];
+
+	for (uint8_t encoding = 0; encoding < WIRE_ENCODING_COUNT; encoding++)
+	{
+		for (size_t i = 0; i < command_count; i++)
+		{
+			struct DocumentWriter writer;
+
+			init_document_writer(&writer, (WireEncoding)encoding, commands[encoding][i], MAX_COMMAND_LENGTH);
+			write_sample_command(&writer, &sample_commands[i]);
+
+			if (finish_document_writer(&writer, &command_lengths[encoding][i]) == NULL)
+			{
+				release_document_writer(&writer);
+				return;
+			}
+		}
+	}
+
+	const double message_count = (double)iterations * command_count;
+
+	struct CommandMessage command;
+	struct timespec start;
+
+	for (uint8_t encoding = 0; encoding < WIRE_ENCODING_COUNT; encoding++)
+	{
+		size_t command_bytes = 0;
+		unsigned int decoded_count = 0;
+
+		for (size_t i = 0; i < command_count; i++)
+		{
+			command_bytes += command_lengths[encoding][i];
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			for (size_t j = 0; j < command_count; j++)
+			{
+				decoded_count += decode_command(commands[encoding][j], command_lengths[encoding][j], &command);
+			}
+		}
+
+		const double decode_time = elapsed_nanoseconds(&start) / message_count;
+
+		char reply[REPLY_BUFFER_SIZE];
+		size_t reply_length = 0;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			struct DocumentWriter writer;
+
+			init_document_writer(&writer, (WireEncoding)encoding, reply, sizeof(reply));
+			write_sample_structure(&writer);
+			finish_document_writer(&writer, &reply_length);
+			release_document_writer(&writer);
+		}
+
+		const double encode_time = elapsed_nanoseconds(&start) / iterations;
+
+		printf("[~] %s: commands %.1f bytes, %.0f ns/message decoded (%u of %.0f); room structure %zu bytes, %.0f ns encoded\n",
+			wire_encoding_names[encoding], (double)command_bytes / command_count, decode_time, decoded_count, message_count, reply_length, encode_time);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define WIRE_ENCODING_COUNT 2
+#define MAX_CLIENT_SOCKETS 1024 // FD_SETSIZE, as select() bounds every client socket by it
+
+struct CommandMessage;
+
+/// <summary>
+/// Encodings of the messages exchanged with a client, negotiated by its identification.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// JSON text, the default.
+	/// </summary>
+	ENCODINGJSON = 0,
+	/// <summary>
+	/// MessagePack, with the same keys and values as the JSON form.
+	/// </summary>
+	ENCODINGMSGPACK = 1
+} WireEncoding;
+
+/// <summary>
+/// Resolves the encoding named by an identification, as in <c>"encoding": "msgpack"</c>.
+/// </summary>
+/// <param name="name">Encoding name, empty if absent.</param>
+/// <returns>The named encoding, or JSON if unknown.</returns>
+WireEncoding resolve_wire_encoding(const char *name);
+
+/// <summary>
+/// Finds the encoding replies to a client socket are written in.
+/// </summary>
+/// <param name="client_socket">Client socket.</param>
+/// <returns>The negotiated encoding, JSON unless the client asked otherwise.</returns>
+WireEncoding find_client_encoding(int client_socket);
+
+/// <summary>
+/// Records the encoding a client socket negotiated, reset to JSON when the socket closes.
+/// </summary>
+/// <param name="client_socket">Client socket.</param>
+/// <param name="encoding">Encoding of its replies.</param>
+void set_client_encoding(int client_socket, WireEncoding encoding);
+
+/// <summary>
+/// Decodes a client command in either encoding, told apart by its first byte.
+/// </summary>
+/// <param name="message">Message to decode, not necessarily null terminated.</param>
+/// <param name="length">Length of the message.</param>
+/// <param name="command">Output reference to the decoded command.</param>
+/// <returns>
+///   <c>true</c> if the message is a well formed command in either encoding.
+/// </returns>
+bool decode_command(const char *message, size_t length, struct CommandMessage *command);
+
+/// <summary>
+/// Measures bytes on the wire and time per message of both encodings, decoding client commands and encoding replies.
+/// </summary>
+/// <param name="iterations">Passes over the message mix.</param>
+void benchmark_wire_encodings(unsigned int iterations);
@@ -1,5 +1,7 @@
 #pragma once
 
+#define NO_REQUEST_ID -1 // a command without a correlation ID, whose replies carry none
+
 /// <summary>
 /// Messages classifications.
 /// </summary>
@@ -28,5 +30,21 @@ typedef enum
 	/// <summary>
 	/// An action for demonstration purposes.
 	/// </summary>
-	CMDDEMO = 5
+	CMDDEMO = 5,
+	/// <summary>
+	/// A ledger exchange between peer controllers.
+	/// </summary>
+	CMDLEDGER = 6,
+	/// <summary>
+	/// Several node updates, authorized, recorded and applied together.
+	/// </summary>
+	CMDBATCH = 7,
+	/// <summary>
+	/// A named scene to apply, defined on the controller.
+	/// </summary>
+	CMDSCENE = 8,
+	/// <summary>
+	/// A node transition to a value over time.
+	/// </summary>
+	CMDFADE = 9
 } Command;
\ No newline at end of file
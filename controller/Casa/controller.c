@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include <wiringPi.h>
 #include <softPwm.h>
@@ -11,13 +12,19 @@
 #include "cJSON.h"
 
 #include "command.h"
-#include "socket.h"
+#include "outbox.h"
 #include "room.h"
 #include "profile.h"
 #include "temperature.h"
+#include "writer.h"
+#include "numeric.h"
+#include "parser.h"
+#include "fade.h"
 
 struct Room *rooms = NULL;
 
+static pthread_mutex_t sensor_lock = PTHREAD_MUTEX_INITIALIZER; // a sensor's wire is bit-banged, so one is read at a time across workers
+
 /// <summary>
 /// String represetnations of the NodeType enum.
 /// </summary>
@@ -37,6 +44,7 @@ void add_room(const char* name, uint8_t thermalGPIO)
 
 	room->thermalGPIO = thermalGPIO; // GPIO of a shared temperature sensor
 	room->nodes = NULL;
+	room->version = 0;
 
 	strcpy(room->name, name);
 
@@ -62,6 +70,8 @@ struct Node *add_node_to_room(const char *room_name, const char *name, NodeType
 
 	node->gpio[0] = gpio;
 	node->value = 0;
+	node->color = 0;
+	node->fade = NULL;
 	node->type = type;
 
 	strcpy(node->name, name);
@@ -69,6 +79,8 @@ struct Node *add_node_to_room(const char *room_name, const char *name, NodeType
 	HASH_FIND_STR(rooms, room_name, room);
 	HASH_ADD_STR(room->nodes, name, node);
 
+	room->version++;
+
 	switch (type)
 	{
 	case NODELIGHT:
@@ -93,6 +105,8 @@ struct Node *add_node_to_room_rgb(const char *room_name, const char *name, uint8
 	struct Node *node = malloc(sizeof(struct Node));
 
 	node->value = 0;
+	node->color = 0;
+	node->fade = NULL;
 	node->type = NODERGB;
 
 	for (int i = 0; i < sizeof node->gpio; i++)
@@ -108,6 +122,8 @@ struct Node *add_node_to_room_rgb(const char *room_name, const char *name, uint8
 	HASH_FIND_STR(rooms, room_name, room);
 	HASH_ADD_STR(room->nodes, name, node);
 
+	room->version++;
+
 	return node;
 }
 
@@ -122,29 +138,27 @@ struct Node *find_node_from_room(const char *room_name, const char *name)
 	}
 
 	HASH_FIND_STR(rooms, room_name, room);
+
+	if (room == NULL)
+	{
+		return NULL;
+	}
+
 	HASH_FIND_STR(room->nodes, name, node);
 
 	return node;
 }
 
-void apply_value_to_node(const char *room_name, const char *name, int new_value)
+/// <summary>
+/// Drives the GPIO pins of a node to a value, which for RGB nodes packs a channel per byte.
+/// </summary>
+static void write_node_outputs(struct Node *node, int new_value)
 {
-	struct Node *node = find_node_from_room(room_name, name);
-
-	if (node == NULL)
-	{
-		return;
-	}
-
-	node->value = new_value;
-
 	switch (node->type)
 	{
 	case NODELIGHT:
 	case NODEFIREPLACE:
 	{
-		node->value = new_value;
-
 		for (uint8_t i = 0; i < sizeof(node->gpio); i++)
 		{
 			if (node->gpio[0] != NULL)
@@ -158,6 +172,8 @@ void apply_value_to_node(const char *room_name, const char *name, int new_value)
 
 	case NODERGB:
 	{
+		node->color = new_value & 0xffffff;
+
 		for (uint8_t i = 0; i < sizeof(node->gpio); i++)
 		{
 			softPwmWrite(node->gpio[i], new_value >> 16 - (i * 8) & 0xff);
@@ -177,16 +193,125 @@ void apply_value_to_node(const char *room_name, const char *name, int new_value)
 	}
 }
 
+void apply_value_to_node(const char *room_name, const char *name, int new_value)
+{
+	struct Node *node = find_node_from_room(room_name, name);
+
+	if (node == NULL)
+	{
+		return;
+	}
+
+	struct Room *room;
+
+	HASH_FIND_STR(rooms, room_name, room);
+	apply_value_to_resolved_node(room, node, new_value);
+}
+
+void apply_value_to_resolved_node(struct Room *room, struct Node *node, int new_value)
+{
+	cancel_fade(node); // set directly, so any transition stops
+
+	drive_node_value(room, node, new_value);
+}
+
+void drive_node_value(struct Room *room, struct Node *node, int new_value)
+{
+	if (node->value != (uint8_t)new_value) // stale cached fragments of the room
+	{
+		room->version++;
+	}
+
+	node->value = new_value;
+
+	write_node_outputs(node, new_value);
+}
+
+uint8_t apply_values_to_nodes(const struct NodeAssignment *assignments, const bool *applicable, uint8_t count)
+{
+	struct Node *written_nodes[MAX_BATCH_SIZE];
+	int written_values[MAX_BATCH_SIZE];
+	uint8_t written_count = 0;
+
+	for (uint8_t i = 0; i < count && i < MAX_BATCH_SIZE; i++)
+	{
+		struct Room *room;
+		struct Node *node;
+
+		if (!applicable[i])
+		{
+			continue;
+		}
+
+		HASH_FIND_STR(rooms, assignments[i].room, room);
+
+		if (room == NULL)
+		{
+			continue;
+		}
+
+		HASH_FIND_STR(room->nodes, assignments[i].node, node);
+
+		if (node == NULL)
+		{
+			continue;
+		}
+
+		if (node->value != (uint8_t)assignments[i].value) // stale cached fragments of the room
+		{
+			room->version++;
+		}
+
+		cancel_fade(node);
+
+		node->value = assignments[i].value;
+
+		uint8_t j = 0;
+
+		while (j < written_count && written_nodes[j] != node) // a node assigned twice is written once, with its last value
+		{
+			j++;
+		}
+
+		written_nodes[j] = node;
+		written_values[j] = assignments[i].value;
+		written_count += j == written_count;
+	}
+
+	for (uint8_t i = 0; i < written_count; i++) // pins are driven once every value is settled
+	{
+		write_node_outputs(written_nodes[i], written_values[i]);
+	}
+
+	return written_count;
+}
+
 float probe_temperature_from_gpio(int gpio)
 {
+	pthread_mutex_lock(&sensor_lock);
 	struct DHT22 *reading = read_temperature_celsius(gpio);
+	pthread_mutex_unlock(&sensor_lock);
+
+	float temperature = 22.5; // retain for demo
 
 	if (reading != NULL)
 	{
-		return reading->temperature;
+		temperature = reading->temperature;
+		free(reading);
 	}
 
-	return 22.5; // retain for demo
+	return temperature;
+}
+
+void probe_room_temperatures(float *temperatures)
+{
+	struct Room *room, *tmpRoom;
+	unsigned int index = 0;
+
+	HASH_ITER(hh, rooms, room, tmpRoom)
+	{
+		temperatures[index++] = probe_temperature_from_gpio(room->thermalGPIO);
+	}
 }
 
 void adjust_all_lighting(int brightness)
@@ -200,6 +325,13 @@ void adjust_all_lighting(int brightness)
 		{
 			if (node->type == NODELIGHT)
 			{
+				cancel_fade(node);
+
+				if (node->value != (uint8_t)brightness)
+				{
+					room->version++;
+				}
+
 				node->value = brightness;
 				softPwmWrite(node->gpio[0], node->value);
 			}
@@ -209,17 +341,94 @@ void adjust_all_lighting(int brightness)
 	printf("[!] Lighting set to %d%%\n", brightness);
 }
 
-void emit_room_structure_json(int dispatch_socket)
+/// <summary>
+/// Renders a room as a profile sees it, from its start up to the value of its temperature, which is read afresh for every reply.
+/// </summary>
+static void render_structure_fragment(struct StructureFragment *fragment, struct Profile *profile, WireEncoding encoding)
 {
-	cJSON *root_object = cJSON_CreateObject();
-	cJSON *payload_object = cJSON_CreateObject();
-	cJSON *rooms_array = cJSON_AddArrayToObject(payload_object, "value");
+	const struct Room *room = fragment->room;
+	struct Node *node, *tmpNode;
 
-	cJSON_AddNumberToObject(root_object, "type", CMDREPORT);
-	cJSON_AddStringToObject(payload_object, "type", "rooms");
+	free(fragment->bytes);
+
+	fragment->bytes = NULL;
+	fragment->length = 0;
+	fragment->version = room->version;
+
+	if (!is_room_accessible(profile, room->name))
+	{
+		return;
+	}
+
+	char buffer[REPLY_BUFFER_SIZE];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, encoding, buffer, sizeof(buffer));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "nodes");
+	begin_document_array(&writer);
+
+	HASH_ITER(hh, room->nodes, node, tmpNode)
+	{
+		if (!is_transaction_permissible(profile, room->name, node->name))
+		{
+			continue;
+		}
+
+		begin_document_object(&writer);
+		write_document_key(&writer, "name");
+		write_document_string(&writer, node->name);
+		write_document_key(&writer, "type");
+		write_document_string(&writer, node_type_ref[node->type]);
+		write_document_key(&writer, "value");
+		write_document_integer(&writer, node->value);
+		end_document_object(&writer);
+	}
+
+	end_document_array(&writer);
+	write_document_key(&writer, "name");
+	write_document_string(&writer, room->name);
+	write_document_key(&writer, "temperature");
+
+	fragment->bytes = detach_document_writer(&writer, &fragment->length);
+
+	release_document_writer(&writer);
+}
+
+/// <summary>
+/// Finds the fragment of a room cached for a profile in an encoding, rendering it if absent or stale.
+/// </summary>
+static struct StructureFragment *find_structure_fragment(struct Profile *profile, const struct Room *room, WireEncoding encoding)
+{
+	struct StructureFragment *fragment;
+
+	HASH_FIND_PTR(profile->fragments[encoding], &room, fragment);
+
+	if (fragment == NULL)
+	{
+		fragment = malloc(sizeof(struct StructureFragment));
+
+		fragment->room = room;
+		fragment->bytes = NULL;
+
+		HASH_ADD_PTR(profile->fragments[encoding], room, fragment);
+		render_structure_fragment(fragment, profile, encoding);
+	}
+	else if (fragment->version != room->version)
+	{
+		render_structure_fragment(fragment, profile, encoding);
+	}
+
+	return fragment;
+}
+
+void emit_room_structure_json(int dispatch_socket, int64_t request_id, const float *temperatures)
+{
+	static const struct iovec json_delimiters[] = { { ",", 1 }, { "}", 1 }, { "]}}", 3 } }; // between rooms, closing a room, closing the reply
+	static const struct iovec packed_delimiters[] = { { NULL, 0 }, { NULL, 0 }, { NULL, 0 } }; // sized headers, nothing to close
 
 	struct Room *room, *tmpRoom;
-	struct Node *node, *tmpNode;
 
 	struct Profile *profile = find_profile_from_client_socket(dispatch_socket);
 
@@ -228,41 +437,84 @@ void emit_room_structure_json(int dispatch_socket)
 		return;
 	}
 
+	const WireEncoding encoding = find_client_encoding(dispatch_socket);
+	const struct iovec *delimiters = encoding == ENCODINGJSON ? json_delimiters : packed_delimiters;
+
+	const unsigned int room_count = HASH_COUNT(rooms);
+
+	struct iovec segments[2 + room_count * 4]; // envelope, and a separator, fragment, temperature and closing per room
+	char temperature_text[room_count][MAX_NUMBER_LENGTH + 1];
+
+	int count = 1; // the envelope is written last, once the rooms are counted
+	unsigned int accessible = 0;
+	unsigned int index = 0;
+
 	HASH_ITER(hh, rooms, room, tmpRoom)
 	{
-		if (!is_room_accessible(profile, room->name))
+		const float temperature = temperatures[index++];
+		const struct StructureFragment *fragment = find_structure_fragment(profile, room, encoding);
+
+		if (fragment->bytes == NULL)
 		{
 			continue;
 		}
 
-		cJSON *room_object = cJSON_CreateObject();
-		cJSON *node_array = cJSON_AddArrayToObject(room_object, "nodes");
+		struct DocumentWriter writer;
 
-		cJSON_AddStringToObject(room_object, "name", room->name);
-		cJSON_AddNumberToObject(room_object, "temperature",
-			probe_temperature_from_gpio(room->thermalGPIO));
+		init_document_writer(&writer, encoding, temperature_text[accessible], sizeof(temperature_text[accessible]));
+		write_document_number(&writer, temperature);
 
-		HASH_ITER(hh, room->nodes, node, tmpNode)
+		if (accessible > 0)
 		{
-			if (!is_transaction_permissible(profile, room->name, node->name))
-			{
-				continue;
-			}
+			segments[count++] = delimiters[0];
+		}
 
-			cJSON *node_object = cJSON_CreateObject();
+		segments[count++] = (struct iovec) { fragment->bytes, fragment->length };
+		segments[count++] = (struct iovec) { writer.buffer, writer.length };
+		segments[count++] = delimiters[1];
 
-			cJSON_AddStringToObject(node_object, "name", node->name);
-			cJSON_AddStringToObject(node_object, "type", node_type_ref[node->type]);
-			cJSON_AddNumberToObject(node_object, "value", node->value);
+		accessible++;
+	}
 
-			cJSON_AddItemToArray(node_array, node_object);
-		}
+	segments[count++] = delimiters[2];
+
+	char envelope[64];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, encoding, envelope, sizeof(envelope));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDREPORT);
 
-		cJSON_AddItemToArray(rooms_array, room_object);
+	if (request_id != NO_REQUEST_ID)
+	{
+		write_document_key(&writer, "id");
+		write_document_integer(&writer, request_id);
 	}
-	cJSON_AddItemToObject(root_object, "payload", payload_object);
 
-	handle_write_descriptor(cJSON_PrintUnformatted(root_object), dispatch_socket);
+	write_document_key(&writer, "payload");
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_string(&writer, "rooms");
+	write_document_key(&writer, "value");
+	begin_document_array(&writer);
+	count_document_values(&writer, accessible);
+
+	size_t envelope_length;
+	char *envelope_head = detach_document_writer(&writer, &envelope_length);
+
+	release_document_writer(&writer);
 
+	if (envelope_head == NULL)
+	{
+		return;
+	}
+
+	segments[0] = (struct iovec) { envelope_head, envelope_length };
+
+	queue_outbound_frame_vector(dispatch_socket, PRIORITYBULK, segments, count);
 	puts("[>] Room structure");
+
+	free(envelope_head);
 }
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <wiringPi.h>
 
 #include "node.h"
 
 struct Room *rooms; // all rooms in the smart home
+const char *node_type_ref[NODETEMPERATURE + 1]; // names of the NodeType enum
 
 /// <summary>
 /// Adds a room to the home controller.
@@ -60,6 +62,31 @@ struct Node *find_node_from_room(const char *room_name, const char *name);
 /// <param name="new_value">New value to apply.</param>
 void apply_value_to_node(const char *room_name, const char *name, int value);
 
+/// <summary>
+/// Applies a value to a node already resolved within its room, as precompiled scenes hold them, stopping any transition.
+/// </summary>
+/// <param name="room">Room of the node.</param>
+/// <param name="node">The node.</param>
+/// <param name="new_value">New value to apply.</param>
+void apply_value_to_resolved_node(struct Room *room, struct Node *node, int new_value);
+
+/// <summary>
+/// Drives a node to a value without stopping its transition, as each step of the transition does.
+/// </summary>
+/// <param name="room">Room of the node.</param>
+/// <param name="node">The node.</param>
+/// <param name="new_value">New value to apply.</param>
+void drive_node_value(struct Room *room, struct Node *node, int new_value);
+
+/// <summary>
+/// Applies the values of a batch to their nodes, then drives the pins of each node written once, with its final value.
+/// </summary>
+/// <param name="assignments">Node values, at most MAX_BATCH_SIZE.</param>
+/// <param name="applicable">Whether each value may be applied.</param>
+/// <param name="count">Number of node values.</param>
+/// <returns>Number of distinct nodes written.</returns>
+uint8_t apply_values_to_nodes(const struct NodeAssignment *assignments, const bool *applicable, uint8_t count);
+
 /// <summary>
 /// Probes the temperature from gpio.
 /// </summary>
@@ -67,6 +94,12 @@ void apply_value_to_node(const char *room_name, const char *name, int value);
 /// <returns>Temperature reading as float</returns>
 float probe_temperature_from_gpio(int gpio);
 
+/// <summary>
+/// Probes the temperature of every room, which may take milliseconds each, so is done off the event loop.
+/// </summary>
+/// <param name="temperatures">Destination for a reading per room, in the order rooms are iterated.</param>
+void probe_room_temperatures(float *temperatures);
+
 /// <summary>
 /// Adjusts all lighting within the house to a given brightness.
 /// </summary>
@@ -74,7 +107,9 @@ float probe_temperature_from_gpio(int gpio);
 void adjust_all_lighting(int brightness);
 
 /// <summary>
-/// Builds and emits a JSON representation of the room structure to a socket.
+/// Builds and emits the room structure to a socket, in the encoding the client negotiated.
 /// </summary>
 /// <param name="dispatch_socket">Client socket to dispatch.</param>
-void emit_room_structure_json(int dispatch_socket);
\ No newline at end of file
+/// <param name="request_id">ID of the request answered, or NO_REQUEST_ID.</param>
+/// <param name="temperatures">Readings from probe_room_temperatures.</param>
+void emit_room_structure_json(int dispatch_socket, int64_t request_id, const float *temperatures);
\ No newline at end of file
@@ -10,6 +10,11 @@
 #include "demo.h"
 
 #include "command.h"
+#include "mining.h"
+#include "parser.h"
+#include "numeric.h"
+#include "codec.h"
+#include "timer.h"
 
 int run_interactive_demo(void)
 {
@@ -54,6 +59,51 @@ int run_interactive_demo(void)
 			sprintf(payload, DUMMY_REQUEST_BODY_DEMO, token);
 			sprintf(message, DUMMY_REQUEST_BODY_CORE, CMDDEMO, payload);
 		}
+		else if (strcmp(token, "mining") == 0) // measure proof-of-work throughput
+		{
+			char *arg = strtok(NULL, delimiter);
+
+			benchmark_mining(arg != NULL && atoi(arg) > 0 ? atoi(arg) : MINING_BENCHMARK_DURATION);
+			printf("> (or type \"help\") ");
+
+			continue;
+		}
+		else if (strcmp(token, "parser") == 0) // compare command parsing throughput
+		{
+			char *arg = strtok(NULL, delimiter);
+
+			benchmark_command_parser(arg != NULL && atoi(arg) > 0 ? atoi(arg) : PARSER_BENCHMARK_ITERATIONS);
+			printf("> (or type \"help\") ");
+
+			continue;
+		}
+		else if (strcmp(token, "numbers") == 0) // compare number formatting throughput
+		{
+			char *arg = strtok(NULL, delimiter);
+
+			benchmark_number_formatting(arg != NULL && atoi(arg) > 0 ? atoi(arg) : NUMBER_BENCHMARK_ITERATIONS);
+			printf("> (or type \"help\") ");
+
+			continue;
+		}
+		else if (strcmp(token, "codec") == 0) // compare wire encodings in size and speed
+		{
+			char *arg = strtok(NULL, delimiter);
+
+			benchmark_wire_encodings(arg != NULL && atoi(arg) > 0 ? atoi(arg) : CODEC_BENCHMARK_ITERATIONS);
+			printf("> (or type \"help\") ");
+
+			continue;
+		}
+		else if (strcmp(token, "timers") == 0) // measure timer wheel operations
+		{
+			char *arg = strtok(NULL, delimiter);
+
+			benchmark_timer_wheel(arg != NULL && atoi(arg) > 0 ? atoi(arg) : TIMER_BENCHMARK_COUNT);
+			printf("> (or type \"help\") ");
+
+			continue;
+		}
 		else if (strcmp(token, "reject") == 0) // print blockchain
 		{
 			sprintf(payload, DUMMY_REQUEST_BODY_NODE, "kitchen", "stove", 1);
@@ -4,11 +4,22 @@
 #define DUMMY_REQUEST_BODY_NODE "\"room\": \"%s\", \"node\": \"%s\", \"value\": %d"
 #define DUMMY_REQUEST_BODY_DEMO "\"type\": \"%s\""
 
+#define MINING_BENCHMARK_DURATION 5 // seconds
+#define PARSER_BENCHMARK_ITERATIONS 100000
+#define NUMBER_BENCHMARK_ITERATIONS 10000
+#define CODEC_BENCHMARK_ITERATIONS 100000
+#define TIMER_BENCHMARK_COUNT 100000
+
 #define INTERACTIVE_HELP_TABLE "\nCasa 1.0 Interactive Demo\n\nAvailable commands:\n\
 -help\t\tDisplays table of information\n\
 -rgb\t\tToggles home RGB lighting to a random colour\n\
 -blockchain\tSerialises and prints the blockchain ledger\n\
 -reject\t\tSimulates a rejected transaction request\n\
+-mining\t\tMeasures proof-of-work hash rate per core, over an optional number of seconds\n\
+-parser\t\tCompares command parsing against cJSON, over an optional number of iterations\n\
+-numbers\tCompares number formatting against printf on structure and ledger dumps, over an optional number of iterations\n\
+-codec\t\tCompares JSON and MessagePack in bytes and time per message, over an optional number of iterations\n\
+-timers\t\tMeasures timer wheel insertion, cancellation, lookup and expiry, over an optional number of active timers\n\
 -any of the following, with a value:\n\
 \t-porch\t\tLight next to the front door\n\
 \t-garage\t\tLight above the garage door\n\
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "uthash.h"
+
+#include "export.h"
+
+#include "block.h"
+#include "blockchain.h"
+#include "checkpoint.h"
+
+#define NAME_SIZE sizeof(((struct Transaction *)0)->node)
+
+const size_t column_widths[COLCOUNT] = { sizeof(uint32_t), sizeof(int32_t), sizeof(uint16_t), sizeof(uint16_t), sizeof(uint8_t), sizeof(uint8_t) };
+
+/// <summary>
+/// struct of a column's pending rows, flushed to its region of the export file.
+/// </summary>
+struct ExportColumnBuffer
+{
+	uint8_t rows[EXPORT_BUFFER_ROWS * sizeof(uint32_t)];
+	uint32_t row_count;
+
+	uint64_t file_offset; // where the pending rows belong
+};
+
+static uint64_t align_export_offset(uint64_t offset)
+{
+	return (offset + EXPORT_ALIGNMENT - 1) & ~(uint64_t)(EXPORT_ALIGNMENT - 1);
+}
+
+/// <summary>
+/// Resolves the dictionary identifier of a name, assigning the next identifier if unseen.
+/// </summary>
+/// <returns>The identifier, or -1 if the dictionary is full.</returns>
+static int32_t resolve_export_name(struct ExportName **dictionary, const char *first_name, const char *second_name)
+{
+	char key[sizeof(((struct ExportName *)0)->key)] = { 0 }; // null padded, so it doubles as the dictionary entry
+
+	strncpy(key, first_name, NAME_SIZE - 1);
+
+	if (second_name != NULL)
+	{
+		strncpy(key + NAME_SIZE, second_name, NAME_SIZE - 1);
+	}
+
+	struct ExportName *name;
+	HASH_FIND(hh, *dictionary, key, sizeof(key), name);
+
+	if (name != NULL)
+	{
+		return name->identifier;
+	}
+
+	if (HASH_COUNT(*dictionary) > UINT16_MAX)
+	{
+		return -1;
+	}
+
+	name = malloc(sizeof(struct ExportName));
+
+	memcpy(name->key, key, sizeof(key));
+	name->identifier = HASH_COUNT(*dictionary);
+
+	HASH_ADD(hh, *dictionary, key, sizeof(key), name);
+
+	return name->identifier;
+}
+
+static void destroy_export_dictionary(struct ExportName **dictionary)
+{
+	struct ExportName *name, *tmpName;
+
+	HASH_ITER(hh, *dictionary, name, tmpName)
+	{
+		HASH_DEL(*dictionary, name);
+		free(name);
+	}
+}
+
+static bool flush_export_column(FILE *export_file, struct ExportColumnBuffer *buffer, size_t width)
+{
+	if (buffer->row_count == 0)
+	{
+		return true;
+	}
+
+	if (fseek(export_file, buffer->file_offset, SEEK_SET) != 0 || fwrite(buffer->rows, width, buffer->row_count, export_file) != buffer->row_count)
+	{
+		return false;
+	}
+
+	buffer->file_offset += (uint64_t)buffer->row_count * width;
+	buffer->row_count = 0;
+
+	return true;
+}
+
+/// <summary>
+/// Walks every transaction of the checkpointed ledger eldest first, paging in one segment at a time.
+/// </summary>
+/// <param name="last_block_index">Final block to walk, fixed up front so concurrent checkpoints are excluded.</param>
+/// <param name="visit">Called per transaction, returning false to stop.</param>
+/// <param name="context">Passed through to the visitor.</param>
+/// <returns><c>true</c> if every segment was walked.</returns>
+static bool walk_checkpointed_transactions(uint32_t last_block_index, bool (*visit)(struct Block *, struct Transaction *, void *), void *context)
+{
+	for (uint32_t start_index = 0; start_index <= last_block_index; start_index += CHECKPOINT_INTERVAL)
+	{
+		struct Block *end_block = page_in_checkpoint(start_index);
+
+		if (end_block == NULL)
+		{
+			return false;
+		}
+
+		struct Block *segment[CHECKPOINT_INTERVAL];
+		uint8_t segment_size = 0;
+
+		for (struct Block *block = end_block; block != NULL && segment_size < CHECKPOINT_INTERVAL; block = block->prev_block)
+		{
+			segment[segment_size++] = block;
+		}
+
+		bool walked = true;
+
+		for (int8_t i = segment_size - 1; i >= 0 && walked; i--)
+		{
+			for (uint8_t j = 0; j < segment[i]->occupied_capacity && walked; j++)
+			{
+				walked = visit(segment[i], segment[i]->transactions[j], context);
+			}
+		}
+
+		destroy_blockchain(end_block);
+
+		if (!walked)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// struct of the state shared between both export passes.
+/// </summary>
+struct ExportState
+{
+	FILE *export_file;
+
+	struct ExportName *nodes;
+	struct ExportName *profiles;
+
+	uint64_t transaction_count;
+
+	struct ExportColumnBuffer columns[COLCOUNT];
+};
+
+static bool count_export_transaction(struct Block *block, struct Transaction *transaction, void *context)
+{
+	(void)block; // a walker callback, only the transaction is counted
+
+	struct ExportState *state = context;
+
+	state->transaction_count++;
+
+	return resolve_export_name(&state->nodes, transaction->node, transaction->room) != -1 &&
+		resolve_export_name(&state->profiles, transaction->profile_identifier, NULL) != -1;
+}
+
+static bool write_export_transaction(struct Block *block, struct Transaction *transaction, void *context)
+{
+	struct ExportState *state = context;
+
+	const uint32_t block_index = block->index;
+	const int32_t timestamp = transaction->timestamp;
+	const uint16_t node_identifier = resolve_export_name(&state->nodes, transaction->node, transaction->room);
+	const uint16_t profile_identifier = resolve_export_name(&state->profiles, transaction->profile_identifier, NULL);
+	const uint8_t authorized = transaction->authorized ? 1 : 0;
+
+	const void *fields[COLCOUNT] = { &block_index, &timestamp, &node_identifier, &profile_identifier, &transaction->value, &authorized };
+
+	for (uint8_t i = 0; i < COLCOUNT; i++)
+	{
+		struct ExportColumnBuffer *buffer = &state->columns[i];
+
+		memcpy(buffer->rows + buffer->row_count * column_widths[i], fields[i], column_widths[i]);
+
+		if (++buffer->row_count == EXPORT_BUFFER_ROWS && !flush_export_column(state->export_file, buffer, column_widths[i]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool write_export_dictionary(FILE *export_file, struct ExportName *dictionary, uint64_t offset, size_t entry_size)
+{
+	if (fseek(export_file, offset, SEEK_SET) != 0)
+	{
+		return false;
+	}
+
+	for (struct ExportName *name = dictionary; name != NULL; name = name->hh.next) // insertion order matches identifiers
+	{
+		if (fwrite(name->key, entry_size, 1, export_file) != 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int export_ledger(const char *export_path)
+{
+	struct Checkpoint checkpoint;
+
+	if (restore_latest_checkpoint(&checkpoint) != 0)
+	{
+		puts("[x] No checkpointed ledger to export");
+		return -1;
+	}
+
+	struct ExportState *state = calloc(1, sizeof(struct ExportState));
+
+	bool exported = walk_checkpointed_transactions(checkpoint.end_index, count_export_transaction, state); // sizes every column and dictionary
+
+	struct ExportHeader header = { .version = EXPORT_VERSION };
+
+	memcpy(header.magic, EXPORT_MAGIC, sizeof(header.magic));
+
+	header.transaction_count = state->transaction_count;
+	header.first_block_index = 0;
+	header.last_block_index = checkpoint.end_index;
+	header.node_count = HASH_COUNT(state->nodes);
+	header.profile_count = HASH_COUNT(state->profiles);
+
+	uint64_t offset = sizeof(struct ExportHeader);
+
+	for (uint8_t i = 0; i < COLCOUNT; i++)
+	{
+		header.column_offsets[i] = offset = align_export_offset(offset);
+		state->columns[i].file_offset = offset;
+
+		offset += header.transaction_count * column_widths[i];
+	}
+
+	header.node_dictionary_offset = offset = align_export_offset(offset);
+	header.profile_dictionary_offset = offset = align_export_offset(offset + (uint64_t)header.node_count * NAME_SIZE * 2);
+
+	state->export_file = exported ? fopen(export_path, "wb") : NULL;
+
+	if (state->export_file != NULL)
+	{
+		exported = fwrite(&header, sizeof(header), 1, state->export_file) == 1 &&
+			walk_checkpointed_transactions(checkpoint.end_index, write_export_transaction, state); // dictionaries are already complete
+
+		for (uint8_t i = 0; i < COLCOUNT && exported; i++)
+		{
+			exported = flush_export_column(state->export_file, &state->columns[i], column_widths[i]);
+		}
+
+		exported = exported &&
+			write_export_dictionary(state->export_file, state->nodes, header.node_dictionary_offset, NAME_SIZE * 2) &&
+			write_export_dictionary(state->export_file, state->profiles, header.profile_dictionary_offset, NAME_SIZE);
+
+		if (fclose(state->export_file) != 0 || !exported)
+		{
+			exported = false;
+			remove(export_path);
+		}
+	}
+	else
+	{
+		exported = false;
+	}
+
+	if (exported)
+	{
+		printf("[~] Exported %llu transactions from blocks #0-#%u to %s\n", (unsigned long long)header.transaction_count, header.last_block_index, export_path);
+	}
+	else
+	{
+		perror("[x] Export failure");
+	}
+
+	destroy_export_dictionary(&state->nodes);
+	destroy_export_dictionary(&state->profiles);
+	free(state);
+
+	return exported ? 0 : -1;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uthash.h"
+
+#include "block.h"
+
+#define EXPORT_MAGIC "CASX"
+#define EXPORT_VERSION 1
+
+#define EXPORT_ALIGNMENT 64 // columns start on cache line boundaries, for aligned vector loads once mapped
+#define EXPORT_BUFFER_ROWS 4096 // rows buffered per column between writes
+
+/// <summary>
+/// Columns of the ledger export, one array entry per transaction, eldest first.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// uint32_t index of the enclosing block.
+	/// </summary>
+	COLBLOCK = 0,
+	/// <summary>
+	/// int32_t transaction timestamp.
+	/// </summary>
+	COLTIMESTAMP,
+	/// <summary>
+	/// uint16_t index into the node dictionary.
+	/// </summary>
+	COLNODE,
+	/// <summary>
+	/// uint16_t index into the profile dictionary.
+	/// </summary>
+	COLPROFILE,
+	/// <summary>
+	/// uint8_t value applied to the node.
+	/// </summary>
+	COLVALUE,
+	/// <summary>
+	/// uint8_t 1 if the transaction was authorized, else 0.
+	/// </summary>
+	COLAUTHORIZED,
+	COLCOUNT
+} ExportColumn;
+
+/// <summary>
+/// struct of the export file header. Offsets are absolute and EXPORT_ALIGNMENT aligned; all fields are little-endian.
+/// The node dictionary holds node_count entries of two 32 byte names (as recorded in the transaction's node and room fields),
+/// and the profile dictionary holds profile_count 32 byte identifiers, both null padded.
+/// </summary>
+struct ExportHeader
+{
+	char magic[4];
+	uint32_t version;
+
+	uint64_t transaction_count;
+
+	uint32_t first_block_index;
+	uint32_t last_block_index;
+
+	uint32_t node_count;
+	uint32_t profile_count;
+
+	uint64_t column_offsets[COLCOUNT];
+
+	uint64_t node_dictionary_offset;
+	uint64_t profile_dictionary_offset;
+};
+
+/// <summary>
+/// struct of a dictionary name and the identifier assigned to it.
+/// </summary>
+struct ExportName
+{
+	char key[sizeof(((struct Transaction *)0)->node) + sizeof(((struct Transaction *)0)->room)];
+	uint16_t identifier;
+
+	UT_hash_handle hh;
+};
+
+/// <summary>
+/// Exports every checkpointed transaction to a columnar binary file, streaming one ledger segment at a time.
+/// Blocks yet to be checkpointed are not included.
+/// </summary>
+/// <param name="export_path">Path of the export file.</param>
+/// <returns>0 if successful, -1 on failure.</returns>
+int export_ledger(const char *export_path);
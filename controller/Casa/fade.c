@@ -0,0 +1,181 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "fade.h"
+#include "controller.h"
+#include "coalesce.h"
+
+static struct Fade *active_fades = NULL;
+static uint32_t active_fade_count = 0;
+
+static struct Timer fade_timer; // a single task steps every fade
+
+static const char *easing_names[] =
+{
+	"linear",
+	"in",
+	"out",
+	"in-out"
+};
+
+Easing resolve_easing(const char *name)
+{
+	for (uint8_t i = 0; i < sizeof(easing_names) / sizeof(easing_names[0]); i++)
+	{
+		if (strcmp(easing_names[i], name) == 0)
+		{
+			return (Easing)i;
+		}
+	}
+
+	return EASELINEAR;
+}
+
+static double ease(Easing easing, double progress)
+{
+	switch (easing)
+	{
+	case EASEIN:
+		return progress * progress;
+	case EASEOUT:
+		return progress * (2 - progress);
+	case EASEINOUT:
+		return progress * progress * (3 - 2 * progress);
+	default:
+		return progress;
+	}
+}
+
+/// <summary>
+/// Interpolates a fade's value, channel by channel for RGB nodes.
+/// </summary>
+static int interpolate_fade(const struct Fade *fade, double eased)
+{
+	if (fade->node->type != NODERGB)
+	{
+		return fade->from_value + (int)((fade->to_value - fade->from_value) * eased + (fade->to_value > fade->from_value ? 0.5 : -0.5));
+	}
+
+	int value = 0;
+
+	for (uint8_t shift = 0; shift < 24; shift += 8)
+	{
+		const int from_channel = fade->from_value >> shift & 0xff;
+		const int to_channel = fade->to_value >> shift & 0xff;
+
+		value |= (from_channel + (int)((to_channel - from_channel) * eased + (to_channel > from_channel ? 0.5 : -0.5))) << shift;
+	}
+
+	return value;
+}
+
+static void unlink_fade(struct Fade *fade)
+{
+	if (fade->prev != NULL)
+	{
+		fade->prev->next = fade->next;
+	}
+	else
+	{
+		active_fades = fade->next;
+	}
+
+	if (fade->next != NULL)
+	{
+		fade->next->prev = fade->prev;
+	}
+
+	fade->node->fade = NULL;
+	active_fade_count--;
+
+	free(fade);
+}
+
+static void step_fades(struct Timer *timer, void *context)
+{
+	(void)context; // fades are global, scheduled without one
+
+	const uint64_t now = monotonic_milliseconds();
+
+	for (struct Fade *fade = active_fades, *next; fade != NULL; fade = next)
+	{
+		next = fade->next;
+
+		const uint64_t elapsed = now - fade->started_at;
+
+		if (elapsed >= fade->duration)
+		{
+			drive_node_value(fade->room, fade->node, fade->to_value);
+			unlink_fade(fade);
+		}
+		else
+		{
+			drive_node_value(fade->room, fade->node, interpolate_fade(fade, ease(fade->easing, (double)elapsed / fade->duration)));
+		}
+	}
+
+	if (active_fades == NULL)
+	{
+		cancel_timer(timer);
+	}
+}
+
+void start_fade(struct Room *room, struct Node *node, int to_value, uint32_t duration, Easing easing)
+{
+	cancel_fade(node);
+
+	if (duration == 0)
+	{
+		drive_node_value(room, node, to_value);
+		return;
+	}
+
+	struct Fade *fade = malloc(sizeof(struct Fade));
+
+	if (fade == NULL)
+	{
+		drive_node_value(room, node, to_value);
+		return;
+	}
+
+	fade->room = room;
+	fade->node = node;
+	fade->from_value = node->type == NODERGB ? (int)node->color : node->value;
+	fade->to_value = to_value;
+	fade->started_at = monotonic_milliseconds();
+	fade->duration = duration < MAX_FADE_DURATION ? duration : MAX_FADE_DURATION;
+	fade->easing = easing;
+
+	fade->prev = NULL;
+	fade->next = active_fades;
+
+	if (active_fades != NULL)
+	{
+		active_fades->prev = fade;
+	}
+
+	active_fades = fade;
+	active_fade_count++;
+
+	node->fade = fade;
+
+	if (!fade_timer.is_scheduled)
+	{
+		schedule_periodic_timer(&fade_timer, FADE_TICK, step_fades, NULL);
+	}
+}
+
+void cancel_fade(struct Node *node)
+{
+	if (node->fade != NULL)
+	{
+		unlink_fade(node->fade);
+	}
+}
+
+uint32_t count_active_fades(void)
+{
+	return active_fade_count;
+}
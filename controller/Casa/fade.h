@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "node.h"
+#include "room.h"
+#include "timer.h"
+
+#define FADE_TICK 20 // milliseconds between steps of every active fade
+#define MAX_FADE_DURATION 600000 // ten minutes
+
+/// <summary>
+/// Easing curves of a transition, mapping elapsed time to progress.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// Constant rate.
+	/// </summary>
+	EASELINEAR = 0,
+	/// <summary>
+	/// Slow start, quadratic.
+	/// </summary>
+	EASEIN,
+	/// <summary>
+	/// Slow finish, quadratic.
+	/// </summary>
+	EASEOUT,
+	/// <summary>
+	/// Slow start and finish, smoothstep.
+	/// </summary>
+	EASEINOUT
+} Easing;
+
+/// <summary>
+/// struct of a node transitioning from one value to another over time.
+/// </summary>
+struct Fade
+{
+	struct Room *room;
+	struct Node *node;
+
+	int from_value; // 24 bit colours for RGB nodes, interpolated per channel
+	int to_value;
+
+	uint64_t started_at;
+	uint32_t duration;
+	Easing easing;
+
+	struct Fade *prev;
+	struct Fade *next;
+};
+
+/// <summary>
+/// Resolves an easing curve by name, as in <c>"easing": "in-out"</c>.
+/// </summary>
+/// <param name="name">Curve name, empty if absent.</param>
+/// <returns>The named curve, or linear if unknown.</returns>
+Easing resolve_easing(const char *name);
+
+/// <summary>
+/// Starts a transition of a node to a value, replacing any transition in progress on it.
+/// Every active fade is stepped by one timer every FADE_TICK.
+/// </summary>
+/// <param name="room">Room of the node.</param>
+/// <param name="node">The node.</param>
+/// <param name="to_value">Target value, a 24 bit colour for RGB nodes.</param>
+/// <param name="duration">Milliseconds, at most MAX_FADE_DURATION; 0 applies the value at once.</param>
+/// <param name="easing">Easing curve.</param>
+void start_fade(struct Room *room, struct Node *node, int to_value, uint32_t duration, Easing easing);
+
+/// <summary>
+/// Stops a node's transition where it stands, as when the node is set directly.
+/// </summary>
+/// <param name="node">The node.</param>
+void cancel_fade(struct Node *node);
+
+/// <summary>
+/// Counts the transitions in progress.
+/// </summary>
+/// <returns>Number of active fades.</returns>
+uint32_t count_active_fades(void);
@@ -2,12 +2,14 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <time.h>
 
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <signal.h>
+#include <unistd.h>
 
 #include <wiringPi.h>
 
@@ -25,49 +27,389 @@
 #include "command.h"
 #include "blockchain.h"
 #include "profile.h"
+#include "replication.h"
+#include "mining.h"
+#include "replay.h"
+#include "export.h"
+#include "arena.h"
+#include "parser.h"
+#include "writer.h"
+#include "codec.h"
+#include "session.h"
+#include "scene.h"
+#include "coalesce.h"
+#include "timer.h"
+#include "fade.h"
+#include "outbox.h"
+#include "workers.h"
+#include "reactor.h"
+#include "room.h"
+
+static int sensor_notify_fds[2] = { -1, -1 }; // interrupts write a SensorEvent, the event loop reads it
+
+static uint32_t loop_latencies[LOOP_LATENCY_SAMPLES]; // microseconds from select() returning to its next call, by iteration
+static uint64_t loop_iteration_count;
+static uint8_t worker_count;
 
 void did_detect_motion_signal(void)
 {
-	puts("motion detected");
+	const char event = SENSORMOTION;
+
+	write(sensor_notify_fds[1], &event, 1); // interrupts run on a thread of their own, the event loop takes it from here
 }
 
 void did_detect_daylight_change(void)
 {
-	int result = digitalRead(DAYLIGHT_PIN);
+	const char event = SENSORDAYLIGHT;
 
-	if (result != is_night_time)
+	write(sensor_notify_fds[1], &event, 1);
+}
+
+/// <summary>
+/// Emits an alarm notification, ahead of anything else queued to the client.
+/// </summary>
+static void emit_alarm_notification(int dispatch_socket)
+{
+	char notification[REPLY_BUFFER_SIZE];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, find_client_encoding(dispatch_socket), notification, sizeof(notification));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDNOTIFICATION);
+
+	write_document_key(&writer, "payload");
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_string(&writer, "alarm");
+	write_document_key(&writer, "value");
+	write_document_string(&writer, "main_alarm");
+	end_document_object(&writer);
+	end_document_object(&writer);
+
+	size_t document_length;
+	const char *document = finish_document_writer(&writer, &document_length);
+
+	if (document != NULL)
 	{
-		is_night_time = result;
+		queue_outbound_frame(dispatch_socket, PRIORITYALARM, document, document_length);
+	}
 
-		cJSON *root_object = cJSON_CreateObject();
-		cJSON *payload_object = cJSON_CreateObject();
+	release_document_writer(&writer);
+}
 
-		cJSON_AddNumberToObject(root_object, "type", CMDNOTIFICATION);
+/// <summary>
+/// struct of a report whose sensors are read off the event loop, sent once read if its client remains.
+/// </summary>
+struct ReportTask
+{
+	struct WorkTask task;
 
-		cJSON_AddStringToObject(payload_object, "type", "daylight");
-		cJSON_AddBoolToObject(payload_object, "value", is_night_time);
+	int client_socket;
+	uint64_t session_serial; // of the session requesting it, 0 if sessionless
+	int64_t request_id;
 
-		cJSON_AddItemToObject(root_object, "payload", payload_object);
+	bool has_structure;
+	bool has_system;
 
-		handle_write_descriptor(cJSON_PrintUnformatted(root_object), active_socket);
-		printf("[>] Daylight shift (%s)\n", is_night_time ? "night" : "day");
+	struct SystemStats stats;
+	float temperatures[]; // a reading per room, if the structure is reported
+};
 
-		if (is_night_time) // bring exterior lights to 40%
-		{
-			apply_value_to_node("home", "porch_light", 40);
-			apply_value_to_node("garage", "entrance_light", 40);
+/// <summary>
+/// struct of a ledger dump, rendered off the event loop from a copy of the resident chain.
+/// </summary>
+struct LedgerDumpTask
+{
+	struct WorkTask task;
+
+	int client_socket;
+	uint64_t session_serial;
+	int64_t request_id;
+
+	struct Block *copied_lead_block;
+};
+
+/// <summary>
+/// Determines whether a client is still connected through the session that submitted a task.
+/// </summary>
+static bool is_submitting_session(int client_socket, uint64_t session_serial)
+{
+	struct ClientSession *session = find_client_session(client_socket);
+
+	return (session != NULL ? session->serial : 0) == session_serial;
+}
+
+/// <summary>
+/// Counts a task against the in-flight limit of the session submitting it.
+/// </summary>
+static uint64_t begin_session_task(struct ClientSession *session)
+{
+	if (session == NULL)
+	{
+		return 0;
+	}
+
+	session->task_count++;
+
+	return session->serial;
+}
+
+/// <summary>
+/// Releases a completed task from the in-flight limit of its session, unless the session has since closed.
+/// </summary>
+static void end_session_task(int client_socket, uint64_t session_serial)
+{
+	struct ClientSession *session = find_client_session(client_socket);
+
+	if (session != NULL && session->serial == session_serial && session->task_count > 0)
+	{
+		session->task_count--;
+	}
+}
+
+/// <summary>
+/// Reads the sensors of a report, on a worker.
+/// </summary>
+static void run_report_task(struct WorkTask *task)
+{
+	struct ReportTask *report = (struct ReportTask *)task;
 
-			puts("[~] Set exterior lighting to 40%");
+	if (report->has_structure)
+	{
+		probe_room_temperatures(report->temperatures);
+	}
+
+	if (report->has_system)
+	{
+		probe_system_stats(&report->stats);
+	}
+}
+
+/// <summary>
+/// Sends a report once its sensors are read.
+/// </summary>
+static void complete_report_task(struct WorkTask *task)
+{
+	struct ReportTask *report = (struct ReportTask *)task;
+
+	end_session_task(report->client_socket, report->session_serial);
+
+	if (is_submitting_session(report->client_socket, report->session_serial))
+	{
+		if (report->has_structure)
+		{
+			emit_room_structure_json(report->client_socket, report->request_id, report->temperatures);
 		}
-		else // dawn - zero all lights
+
+		if (report->has_system)
 		{
-			adjust_all_lighting(0);
-			puts("[~] Dim all lighting to 0%");
+			emit_system_report_json(report->client_socket, report->request_id, &report->stats);
 		}
+	}
 
-		emit_room_structure_json(active_socket); // alert client
+	free(report);
+}
 
-		cJSON_Delete(root_object);
+/// <summary>
+/// Hands the sensor reads of a room structure or system report, or both in that order, to the worker pool.
+/// </summary>
+static void request_report(int client_socket, int64_t request_id, bool has_structure, bool has_system)
+{
+	struct ClientSession *session = find_client_session(client_socket);
+	const unsigned int room_count = has_structure ? HASH_COUNT(rooms) : 0;
+
+	struct ReportTask *report = malloc(sizeof(struct ReportTask) + room_count * sizeof(float));
+
+	if (report == NULL)
+	{
+		return;
+	}
+
+	report->task.run = run_report_task;
+	report->task.complete = complete_report_task;
+	report->client_socket = client_socket;
+	report->session_serial = begin_session_task(session);
+	report->request_id = request_id;
+	report->has_structure = has_structure;
+	report->has_system = has_system;
+
+	submit_work_task(&report->task);
+}
+
+/// <summary>
+/// Renders and prints a copied chain, paging in its checkpointed ancestors, on a worker.
+/// </summary>
+static void run_ledger_dump_task(struct WorkTask *task)
+{
+	struct LedgerDumpTask *dump = (struct LedgerDumpTask *)task;
+
+	emit_block_json(dump->copied_lead_block, true, true);
+	destroy_blockchain(dump->copied_lead_block);
+}
+
+/// <summary>
+/// Confirms a ledger dump once printed.
+/// </summary>
+static void complete_ledger_dump_task(struct WorkTask *task)
+{
+	struct LedgerDumpTask *dump = (struct LedgerDumpTask *)task;
+
+	end_session_task(dump->client_socket, dump->session_serial);
+
+	if (dump->request_id != NO_REQUEST_ID && is_submitting_session(dump->client_socket, dump->session_serial))
+	{
+		emit_confirmation(dump->client_socket, dump->request_id, CMDDEMO, true);
+	}
+
+	free(dump);
+}
+
+/// <summary>
+/// Hands a dump of the ledger to the worker pool, copying the resident chain the event loop goes on changing.
+/// </summary>
+static void request_ledger_dump(int client_socket, int64_t request_id)
+{
+	struct ClientSession *session = find_client_session(client_socket);
+	struct LedgerDumpTask *dump = malloc(sizeof(struct LedgerDumpTask));
+
+	if (dump == NULL)
+	{
+		return;
+	}
+
+	dump->task.run = run_ledger_dump_task;
+	dump->task.complete = complete_ledger_dump_task;
+	dump->client_socket = client_socket;
+	dump->session_serial = begin_session_task(session);
+	dump->request_id = request_id;
+	dump->copied_lead_block = copy_resident_blockchain();
+
+	submit_work_task(&dump->task);
+}
+
+/// <summary>
+/// Emits a daylight notification, followed by the room structure its lighting changes.
+/// </summary>
+static void emit_daylight_notification(int dispatch_socket)
+{
+	char notification[REPLY_BUFFER_SIZE];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, find_client_encoding(dispatch_socket), notification, sizeof(notification));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDNOTIFICATION);
+
+	write_document_key(&writer, "payload");
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_string(&writer, "daylight");
+	write_document_key(&writer, "value");
+	write_document_bool(&writer, is_night_time);
+	end_document_object(&writer);
+	end_document_object(&writer);
+
+	size_t document_length;
+	const char *document = finish_document_writer(&writer, &document_length);
+
+	if (document != NULL)
+	{
+		queue_outbound_frame(dispatch_socket, PRIORITYNOTIFICATION, document, document_length);
+	}
+
+	release_document_writer(&writer);
+
+	request_report(dispatch_socket, NO_REQUEST_ID, true, false); // alert client
+}
+
+/// <summary>
+/// Adjusts lighting to a change of daylight.
+/// </summary>
+/// <returns>
+///   <c>true</c> if daylight changed; <c>false</c> if the sensor settled back.
+/// </returns>
+static bool evaluate_daylight_change(void)
+{
+	int result = digitalRead(DAYLIGHT_PIN);
+
+	if (result == is_night_time)
+	{
+		return false;
+	}
+
+	is_night_time = result;
+	printf("[>] Daylight shift (%s)\n", is_night_time ? "night" : "day");
+
+	if (is_night_time) // bring exterior lights to 40%
+	{
+		apply_value_to_node("home", "porch_light", 40);
+		apply_value_to_node("garage", "entrance_light", 40);
+
+		puts("[~] Set exterior lighting to 40%");
+	}
+	else // dawn - zero all lights
+	{
+		adjust_all_lighting(0);
+		puts("[~] Dim all lighting to 0%");
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Adds the sensor event pipe to a descriptor set.
+/// </summary>
+static int fill_sensor_descriptor(fd_set *read_fds, int fdmax)
+{
+	FD_SET(sensor_notify_fds[0], read_fds);
+
+	return sensor_notify_fds[0] > fdmax ? sensor_notify_fds[0] : fdmax;
+}
+
+/// <summary>
+/// Evaluates the sensor events interrupts have handed over, notifying every client.
+/// </summary>
+static void handle_sensor_descriptor(fd_set *read_fds, fd_set *active_fds, int fdmax)
+{
+	char events[64];
+	ssize_t event_count;
+
+	if (!FD_ISSET(sensor_notify_fds[0], read_fds))
+	{
+		return;
+	}
+
+	while ((event_count = read(sensor_notify_fds[0], events, sizeof(events))) > 0)
+	{
+		for (ssize_t i = 0; i < event_count; i++)
+		{
+			if (events[i] == SENSORMOTION)
+			{
+				puts("[!] Motion detected - raising alarm");
+			}
+			else if (events[i] != SENSORDAYLIGHT || !evaluate_daylight_change())
+			{
+				continue;
+			}
+
+			for (int client_socket = 0; client_socket <= fdmax; client_socket++)
+			{
+				if (FD_ISSET(client_socket, active_fds) && find_client_session(client_socket) != NULL)
+				{
+					if (events[i] == SENSORMOTION)
+					{
+						emit_alarm_notification(client_socket);
+					}
+					else
+					{
+						emit_daylight_notification(client_socket);
+					}
+				}
+			}
+		}
 	}
 }
 
@@ -75,6 +417,14 @@ int arm_sensors(void)
 {
 	pinMode(DAYLIGHT_PIN, INPUT);
 
+	if (pipe(sensor_notify_fds) != 0)
+	{
+		return -1;
+	}
+
+	fcntl(sensor_notify_fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(sensor_notify_fds[1], F_SETFL, O_NONBLOCK); // an interrupt never waits on a busy loop, the event is dropped instead
+
 	return wiringPiISR(DAYLIGHT_PIN, INT_EDGE_BOTH, &did_detect_daylight_change);
 }
 
@@ -105,63 +455,288 @@ void populate_rooms(void)
 	add_node_to_room("garage", "door", NODEDOOR, 1);
 }
 
-void evaluate_message(const int client_socket, const char *message)
+void emit_confirmation(int dispatch_socket, int64_t request_id, Command type, bool is_accepted)
+{
+	char confirmation[REPLY_BUFFER_SIZE];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, find_client_encoding(dispatch_socket), confirmation, sizeof(confirmation));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDCONFIRMATION);
+
+	if (request_id != NO_REQUEST_ID)
+	{
+		write_document_key(&writer, "id");
+		write_document_integer(&writer, request_id);
+	}
+
+	write_document_key(&writer, "payload");
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, type);
+	write_document_key(&writer, "value");
+	write_document_bool(&writer, is_accepted);
+	end_document_object(&writer);
+	end_document_object(&writer);
+
+	size_t document_length;
+	const char *document = finish_document_writer(&writer, &document_length);
+
+	if (document != NULL)
+	{
+		queue_outbound_frame(dispatch_socket, PRIORITYDELTA, document, document_length);
+	}
+
+	release_document_writer(&writer);
+}
+
+void emit_batch_confirmation(int dispatch_socket, int64_t request_id, const bool *applied, uint8_t count)
 {
-	cJSON *root_object = cJSON_Parse(message);
-	cJSON *payload_object = cJSON_GetObjectItem(root_object, "payload");
+	char confirmation[REPLY_BUFFER_SIZE];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, find_client_encoding(dispatch_socket), confirmation, sizeof(confirmation));
 
-	switch ((Command)(cJSON_GetObjectItem(root_object, "type")->valueint))
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDCONFIRMATION);
+
+	if (request_id != NO_REQUEST_ID)
+	{
+		write_document_key(&writer, "id");
+		write_document_integer(&writer, request_id);
+	}
+
+	write_document_key(&writer, "payload");
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDBATCH);
+	write_document_key(&writer, "value");
+	begin_document_array(&writer);
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		write_document_bool(&writer, applied[i]);
+	}
+
+	end_document_array(&writer);
+	end_document_object(&writer);
+	end_document_object(&writer);
+
+	size_t document_length;
+	const char *document = finish_document_writer(&writer, &document_length);
+
+	if (document != NULL)
+	{
+		queue_outbound_frame(dispatch_socket, PRIORITYDELTA, document, document_length);
+	}
+
+	release_document_writer(&writer);
+}
+
+void evaluate_message(const int client_socket, const struct CommandMessage *command)
+{
+	if (command->id != NO_REQUEST_ID && (command->type == CMDREPORT || command->type == CMDDEMO)) // slow commands, completed after the node writes pipelined with them
+	{
+		struct ClientSession *session = find_client_session(client_socket);
+
+		if (session != NULL && defer_command(session, command))
+		{
+			return;
+		}
+	}
+
+	evaluate_command(client_socket, command);
+}
+
+void evaluate_command(const int client_socket, const struct CommandMessage *command)
+{
+	switch (command->type)
 	{
 	case CMDNODE:
 	{
-		const char *room = cJSON_GetObjectItem(payload_object, "room")->valuestring;
-		const char *node = cJSON_GetObjectItem(payload_object, "node")->valuestring;
-		const int value = cJSON_GetObjectItem(payload_object, "value")->valueint;
+		struct Profile *profile = find_profile_from_client_socket(client_socket);
+		struct ClientSession *session = find_client_session(client_socket);
+		bool is_applied = false;
 
-		if (record_proposed_transaction_from_client(client_socket, node, room, value, false))
+		if (command->nonce[0] != '\0' && profile != NULL && is_replayed_command(profile->identifier, command->nonce)) // nonce is optional, identifies resends
+		{
+			printf("[!] Discarded replayed %s, %s from Client %d\n", command->node, command->room, client_socket);
+		}
+		else if (session != NULL && is_transaction_permissible(profile, command->room, command->node) &&
+			coalesce_node_write(&session->coalescer, profile, command->room, command->node, command->value, monotonic_milliseconds())) // recorded once settled
 		{
-			apply_value_to_node(room, node, value);
-			printf("[<] Set %s (%s) to %d\n", node, room, value);
+			is_applied = true;
+		}
+		else if (record_proposed_transaction_from_client(client_socket, command->node, command->room, command->value, false))
+		{
+			apply_value_to_node(command->room, command->node, command->value);
+			printf("[<] Set %s (%s) to %d\n", command->node, command->room, command->value);
+
+			is_applied = true;
 		}
 		else
 		{
-			printf("[!] Rejected %s, %s from Client %d - insufficient permissions\n", node, room, active_socket);
+			printf("[!] Rejected %s, %s from Client %d - insufficient permissions\n", command->node, command->room, client_socket);
+		}
+
+		if (command->id != NO_REQUEST_ID)
+		{
+			emit_confirmation(client_socket, command->id, CMDNODE, is_applied);
 		}
 
 		break;
 	}
-	case CMDREPORT:
+	case CMDBATCH:
 	{
-		const char *report_type = cJSON_GetObjectItem(payload_object, "type")->valuestring;
+		struct Profile *profile = find_profile_from_client_socket(client_socket);
+		bool applied[MAX_BATCH_SIZE] = { false };
 
-		if (strcmp(report_type, "structure") == 0)
+		if (profile == NULL)
+		{
+			printf("[!] Rejected batch of %u from Client %d - no profile\n", command->assignment_count, client_socket);
+		}
+		else if (command->nonce[0] != '\0' && is_replayed_command(profile->identifier, command->nonce))
 		{
-			emit_room_structure_json(active_socket);
+			printf("[!] Discarded replayed batch of %u from Client %d\n", command->assignment_count, client_socket);
 		}
-		else if (strcmp(report_type, "system") == 0)
+		else
 		{
-			emit_system_report_json(active_socket);
+			uint8_t authorized_count = record_proposed_transaction_group(profile, command->assignments, command->assignment_count, applied);
+			uint8_t written_count = apply_values_to_nodes(command->assignments, applied, command->assignment_count);
+
+			printf("[<] Set %u of %u nodes in a batch from Client %d (%u written)\n", authorized_count, command->assignment_count, client_socket, written_count);
 		}
+
+		emit_batch_confirmation(client_socket, command->id, applied, command->assignment_count); // one reply for the whole batch
+
+		break;
+	}
+	case CMDFADE:
+	{
+		struct Profile *profile = find_profile_from_client_socket(client_socket);
+		struct Node *node = find_node_from_room(command->room, command->node);
+		bool is_applied = false;
+
+		if (command->nonce[0] != '\0' && profile != NULL && is_replayed_command(profile->identifier, command->nonce))
+		{
+			printf("[!] Discarded replayed fade of %s, %s from Client %d\n", command->node, command->room, client_socket);
+		}
+		else if (node == NULL || command->duration < 0)
+		{
+			printf("[!] Rejected fade of %s, %s from Client %d - unknown node\n", command->node, command->room, client_socket);
+		}
+		else if (record_proposed_transaction_from_client(client_socket, command->node, command->room, command->value, false)) // the target is recorded, not each step
+		{
+			struct Room *room;
+
+			HASH_FIND_STR(rooms, command->room, room);
+			start_fade(room, node, command->value, command->duration, resolve_easing(command->easing));
+
+			printf("[<] Fading %s (%s) to %d over %d ms\n", command->node, command->room, command->value, command->duration);
+			is_applied = true;
+		}
+		else
+		{
+			printf("[!] Rejected fade of %s, %s from Client %d - insufficient permissions\n", command->node, command->room, client_socket);
+		}
+
+		if (command->id != NO_REQUEST_ID)
+		{
+			emit_confirmation(client_socket, command->id, CMDFADE, is_applied);
+		}
+
+		break;
+	}
+	case CMDSCENE:
+	{
+		struct Profile *profile = find_profile_from_client_socket(client_socket);
+		struct Scene *scene = find_scene(command->scene);
+		bool is_applied = false;
+
+		if (scene == NULL)
+		{
+			printf("[!] Rejected unknown scene '%s' from Client %d\n", command->scene, client_socket);
+		}
+		else if (command->nonce[0] != '\0' && profile != NULL && is_replayed_command(profile->identifier, command->nonce))
+		{
+			printf("[!] Discarded replayed scene '%s' from Client %d\n", scene->name, client_socket);
+		}
+		else if ((is_applied = activate_scene(scene, profile)))
+		{
+			printf("[<] Applied scene '%s' (%u nodes)\n", scene->name, scene->target_count);
+		}
+		else
+		{
+			printf("[!] Rejected scene '%s' from Client %d - insufficient permissions\n", scene->name, client_socket);
+		}
+
+		emit_confirmation(client_socket, command->id, CMDSCENE, is_applied);
+
+		break;
+	}
+	case CMDREPORT:
+	{
+		if (strcmp(command->subtype, "structure") == 0)
+		{
+			request_report(client_socket, command->id, true, false);
+		}
+		else if (strcmp(command->subtype, "system") == 0)
+		{
+			request_report(client_socket, command->id, false, true);
+		}
+
+		break;
 	}
 	case CMDIDENTIFICATION:
 	{
-		const char *identification = cJSON_GetObjectItem(payload_object, "value")->valuestring;
-		bind_client_socket_to_profile(identification, client_socket);
+		bind_client_socket_to_profile(command->identification, client_socket);
+
+		struct Profile *profile = find_profile_from_client_socket(client_socket);
+		struct ClientSession *session = find_client_session(client_socket);
 
-		printf("[~] Client %d assigned profile \"%s\" - batching home data\n", client_socket, identification);
+		if (profile != NULL && session != NULL)
+		{
+			limit_connection(session->connection, profile->session_limit);
+		}
+
+		set_client_encoding(client_socket, resolve_wire_encoding(command->encoding)); // replies follow in the negotiated encoding
 
-		emit_room_structure_json(active_socket);
-		emit_system_report_json(active_socket);
+		printf("[~] Client %d assigned profile \"%s\" - batching home data\n", client_socket, command->identification);
+
+		request_report(client_socket, command->id, true, true);
 
 		break;
 	}
 	case CMDDEMO:
 	{
-		const char *report_type = cJSON_GetObjectItem(payload_object, "type")->valuestring;
+		if (strcmp(command->subtype, "blockchain") == 0) // confirmed once printed
+		{
+			request_ledger_dump(client_socket, command->id);
+			break;
+		}
+		else if (strcmp(command->subtype, "arena") == 0)
+		{
+			print_arena_statistics();
+		}
+		else if (strcmp(command->subtype, "admission") == 0)
+		{
+			print_admission_statistics();
+		}
+		else if (strcmp(command->subtype, "latency") == 0)
+		{
+			print_loop_latency();
+		}
+		else if (strcmp(command->subtype, "alarm") == 0) // as if the PIR sensor fired
+		{
+			did_detect_motion_signal();
+		}
 
-		if (strcmp(report_type, "blockchain") == 0)
+		if (command->id != NO_REQUEST_ID)
 		{
-			emit_block_json(true, true);
+			emit_confirmation(client_socket, command->id, CMDDEMO, true);
 		}
 
 		break;
@@ -176,71 +751,231 @@ void evaluate_message(const int client_socket, const char *message)
 	}
 }
 
+/// <summary>
+/// Evaluates the commands a client's reactor handed over, up to its in-flight limit.
+/// </summary>
+static void evaluate_session_input(int client_socket, struct ClientSession *session)
+{
+	const uint64_t now = monotonic_milliseconds();
+	struct InboundEvent *event;
+
+	session->is_backlogged = false;
+
+	while (session->inbox_head != NULL)
+	{
+		if (session->in_flight_count + session->task_count >= MAX_IN_FLIGHT_COMMANDS) // remaining commands wait for those in flight
+		{
+			session->is_backlogged = session->in_flight_count > 0; // tasks wake the loop themselves as they complete
+			break;
+		}
+
+		event = take_session_command(session);
+
+		if (admit_client_command(session, now)) // shed over its profile's rate limit, its reactor having shed those over the connection's
+		{
+			evaluate_message(client_socket, &event->command);
+		}
+
+		release_inbound_event(event);
+	}
+}
+
+/// <summary>
+/// Completes the commands a client deferred, in the order received.
+/// </summary>
+static void complete_deferred_commands(int client_socket, struct ClientSession *session)
+{
+	for (uint8_t i = 0; i < session->in_flight_count; i++)
+	{
+		evaluate_command(client_socket, &session->in_flight[i]);
+	}
+
+	session->in_flight_count = 0;
+}
+
+/// <summary>
+/// Reads the monotonic clock in microseconds, finer than the timers need.
+/// </summary>
+static uint64_t monotonic_microseconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/// <summary>
+/// Orders latencies for percentiles to be read off.
+/// </summary>
+static int compare_latencies(const void *a, const void *b)
+{
+	const uint32_t left = *(const uint32_t *)a;
+	const uint32_t right = *(const uint32_t *)b;
+
+	return left < right ? -1 : left > right;
+}
+
+void print_loop_latency(void)
+{
+	const size_t count = loop_iteration_count < LOOP_LATENCY_SAMPLES ? loop_iteration_count : LOOP_LATENCY_SAMPLES;
+	uint32_t sorted[LOOP_LATENCY_SAMPLES];
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	memcpy(sorted, loop_latencies, count * sizeof(uint32_t));
+	qsort(sorted, count, sizeof(uint32_t), compare_latencies);
+
+	printf("[~] Loop latency over the last %zu of %llu iterations, %u workers: p50 %u us, p90 %u us, p99 %u us, p99.9 %u us, max %u us\n",
+		count, (unsigned long long)loop_iteration_count, worker_count,
+		sorted[count * 50 / 100], sorted[count * 90 / 100], sorted[count * 99 / 100], sorted[count * 999 / 1000], sorted[count - 1]);
+}
+
+/// <summary>
+/// Opens sessions for clients the reactors accepted, queues their commands and closes those gone, in the order each happened.
+/// </summary>
+/// <returns>Highest client socket.</returns>
+static int handle_inbound_descriptor(fd_set *read_fds, fd_set *active_fds, int fdmax)
+{
+	struct InboundEvent *event = take_inbound_events(read_fds);
+
+	while (event != NULL)
+	{
+		struct InboundEvent *next = event->next;
+		struct ClientSession *session = find_client_session(event->client_socket);
+
+		if (event->kind == INBOUNDOPENED && open_client_session(event->client_socket, event->connection) == NULL)
+		{
+			printf("[x] Client %d refused - no session\n", event->client_socket);
+			shutdown(event->client_socket, SHUT_RDWR); // its reactor hands it back once it sees the shutdown
+		}
+		else if (event->kind == INBOUNDOPENED)
+		{
+			FD_SET(event->client_socket, active_fds);
+
+			if (event->client_socket > fdmax)
+			{
+				fdmax = event->client_socket;
+			}
+
+			printf("[+] Client %d online\n", event->client_socket);
+		}
+		else if (event->kind == INBOUNDCOMMAND && session != NULL)
+		{
+			touch_client_session(session, monotonic_milliseconds());
+			queue_session_command(session, event); // released once evaluated
+
+			event = next;
+			continue;
+		}
+		else if (event->kind == INBOUNDSHED && session != NULL)
+		{
+			shed_client_commands(session);
+		}
+		else if (event->kind == INBOUNDCLOSED)
+		{
+			if (session != NULL)
+			{
+				printf("[-] Client %d offline\n", event->client_socket);
+			}
+
+			shutdown_socket(event->client_socket, active_fds);
+			close(event->client_socket); // only now, lest the descriptor be reused while its events are pending
+		}
+
+		release_inbound_event(event);
+		event = next;
+	}
+
+	return fdmax;
+}
+
 int run_server(void)
 {
 	int fdmax = -1;
 	int i = 0;
-	int client_socket = -1;
+	bool is_backlogged = false;
 
-	fd_set read_fds, active_fds;
+	fd_set read_fds, write_fds, active_fds, pending_fds; // active - clients with a session, pending - clients with messages their socket has yet to take
 
 	FD_ZERO(&read_fds);
+	FD_ZERO(&write_fds);
 	FD_ZERO(&active_fds);
-	FD_SET(server_socket, &active_fds);
-
-	if (server_socket > fdmax)
-	{
-		fdmax = server_socket;
-	}
+	FD_ZERO(&pending_fds);
 
 	while (1)
 	{
-		memcpy(&read_fds, &active_fds, sizeof(active_fds));
-		select(fdmax + 1, &read_fds, NULL, NULL, NULL);
+		struct timeval poll_timeout = { 0, 0 }; // backlogged commands are evaluated without waiting for input
 
-		for (i = 0; i <= fdmax; i++) // iterate connections
+		FD_ZERO(&read_fds); // clients are read by their reactors
+		memcpy(&write_fds, &pending_fds, sizeof(pending_fds));
+		select(fill_sensor_descriptor(&read_fds, fill_timer_descriptor(&read_fds, fill_reactor_descriptor(&read_fds, fill_worker_descriptor(&read_fds,
+			fill_mining_descriptor(&read_fds, fill_replication_descriptors(&read_fds, &write_fds, fdmax)))))) + 1,
+			&read_fds, &write_fds, NULL, is_backlogged ? &poll_timeout : NULL);
+
+		const uint64_t woken_at = monotonic_microseconds();
+
+		open_arena_scope();
+		handle_sensor_descriptor(&read_fds, &active_fds, fdmax); // alarms first, so they are queued ahead of replies below
+		handle_timer_descriptor(&read_fds); // fades and coalescing windows
+		handle_worker_descriptor(&read_fds); // reports and dumps finished off the loop
+		close_arena_scope();
+
+		handle_mining_descriptor(&read_fds);
+		handle_replication_descriptors(&read_fds, &write_fds);
+
+		fdmax = handle_inbound_descriptor(&read_fds, &active_fds, fdmax);
+
+		for (i = 0; i <= fdmax; i++) // send what sockets can now take
 		{
-			if (FD_ISSET(i, &read_fds))
+			if (FD_ISSET(i, &write_fds) && find_client_session(i) != NULL)
 			{
-				if (i == server_socket) // new client connection
-				{
-					client_socket = accept(server_socket, NULL, NULL);
+				flush_outbox(i, &find_client_session(i)->outbox);
+			}
+		}
 
-					if (client_socket == -1)
-					{
-						perror("[x] Acceptance failure");
-						continue;
-					}
-					else
-					{
-						FD_SET(client_socket, &active_fds);
+		is_backlogged = false;
 
-						if (client_socket > fdmax)
-						{
-							fdmax = client_socket;
-						}
+		for (i = 0; i <= fdmax; i++) // evaluate commands handed over, then complete those deferred once the rest of their batch is applied
+		{
+			struct ClientSession *session = FD_ISSET(i, &active_fds) ? find_client_session(i) : NULL;
 
-						printf("[+] Client %d online\n", fdmax);
-					}
-				}
-				else
-				{
-					active_socket = i;
+			if (session == NULL)
+			{
+				FD_CLR(i, &pending_fds);
+				continue;
+			}
+			else if (session->is_idle) // silent through heartbeats, as a half-open connection is
+			{
+				printf("[-] Client %d evicted - idle\n", i);
+				shutdown_socket(i, &active_fds);
+				FD_CLR(i, &pending_fds);
 
-					char *message = NULL;
+				continue;
+			}
 
-					if (handle_read_descriptor(&message, active_socket) == 0) // nothing received - close socket
-					{
-						printf("[-] Client %d offline\n", client_socket);
-						shutdown_socket(active_socket, &active_fds);
+			active_socket = i;
 
-						continue;
-					}
+			open_arena_scope(); // every tree built while dispatching is reclaimed at once
+			evaluate_session_input(i, session);
+			complete_deferred_commands(i, session);
+			close_arena_scope();
 
-					evaluate_message(client_socket, message);
-				}
+			if (is_outbox_pending(&session->outbox)) // sent once writable, most urgent first
+			{
+				FD_SET(i, &pending_fds);
 			}
+			else
+			{
+				FD_CLR(i, &pending_fds);
+			}
+
+			is_backlogged |= session->is_backlogged || session->in_flight_count > 0;
 		}
+
+		loop_latencies[loop_iteration_count++ % LOOP_LATENCY_SAMPLES] = monotonic_microseconds() - woken_at;
 	}
 
 	return 0;
@@ -248,14 +983,84 @@ int run_server(void)
 
 void shutdown_socket(int client_socket, fd_set *active_fds)
 {
+	struct ClientSession *session = find_client_session(client_socket);
+
+	if (session != NULL) // a departing client's last values are recorded
+	{
+		settle_coalesced_writes(&session->coalescer, monotonic_milliseconds(), true);
+	}
+
 	FD_CLR(client_socket, active_fds);
-	close(client_socket);
+	unbind_client_socket(client_socket);
+	set_client_encoding(client_socket, ENCODINGJSON);
+	close_client_session(client_socket);
+	shutdown(client_socket, SHUT_RDWR); // its reactor sees the end of input and hands the socket back to be closed
 }
 
 int main(int argc, char *argv[])
 {
 	puts(CASA_ASCII);
 
+	install_arena_hooks();
+
+	int option;
+	const char *export_path = NULL;
+	uint32_t heartbeat_interval = HEARTBEAT_INTERVAL;
+	uint32_t idle_timeout = IDLE_TIMEOUT;
+
+	uint8_t reactor_count = default_reactor_count();
+
+	worker_count = default_worker_count();
+
+	while ((option = getopt(argc, argv, "d:x:k:i:w:r:")) != -1)
+	{
+		if (option == 'd') // -d <bits> enables proof-of-work, shared by all peers
+		{
+			char *end;
+			long difficulty = strtol(optarg, &end, 10);
+
+			if (*optarg == '\0' || *end != '\0' || difficulty < 0 || difficulty > MAX_MINING_DIFFICULTY)
+			{
+				fprintf(stderr, "Difficulty must be 0 to %d leading zero bits\n", MAX_MINING_DIFFICULTY);
+				return -1;
+			}
+
+			set_mining_difficulty((uint8_t)difficulty);
+		}
+		else if (option == 'x') // -x <path> exports the checkpointed ledger and exits
+		{
+			export_path = optarg;
+		}
+		else if (option == 'k') // -k <seconds> of client silence before a heartbeat, 0 disables
+		{
+			heartbeat_interval = atoi(optarg);
+		}
+		else if (option == 'i') // -i <seconds> of client silence before eviction, 0 disables
+		{
+			idle_timeout = atoi(optarg);
+		}
+		else if (option == 'w') // -w <workers> reading sensors and dumping the ledger off the event loop, 0 runs them inline
+		{
+			worker_count = atoi(optarg) > MAX_WORKER_THREADS ? MAX_WORKER_THREADS : atoi(optarg);
+		}
+		else if (option == 'r') // -r <reactors> accepting and reading clients, at least 1
+		{
+			reactor_count = atoi(optarg) < 1 ? 1 : atoi(optarg) > MAX_REACTOR_THREADS ? MAX_REACTOR_THREADS : atoi(optarg);
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [-d difficulty] [-x export_path] [-k heartbeat_interval] [-i idle_timeout] [-w workers] [-r reactors] [port [peer:port ...]]\n", argv[0]);
+			return -1;
+		}
+	}
+
+	set_session_liveness(heartbeat_interval, idle_timeout);
+
+	if (export_path != NULL)
+	{
+		return export_ledger(export_path);
+	}
+
 	if (puts("[~] Initialising GPIO pins...") && wiringPiSetup() != 0)
 	{
 		return -1;
@@ -274,15 +1079,33 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (puts("[~] Composing scenes...") && compose_scenes() != 0)
+	{
+		return -1;
+	}
+
 	if (puts("[~] Formulating blockchain...") && formulate_blockchain() != 0)
 	{
 		return -1;
 	}
 
-	if (argc > 1)
+	if (argc > optind)
 	{
-		puts("[~] Opening channel...");
-		server_socket = start_server(atoi(argv[1]));
+		printf("[~] Opening channel on %u reactors...\n", reactor_count);
+
+		if (start_reactors(atoi(argv[optind]), reactor_count) == 0)
+		{
+			return -1;
+		}
+
+		printf("[~] Starting %u workers...\n", worker_count);
+		start_workers(worker_count);
+
+		if (argc > optind + 1) // remaining args are peer controllers, as host:port
+		{
+			puts("[~] Joining peer controllers...");
+			start_replication(atoi(argv[optind]) + REPLICATION_PORT_OFFSET, argv + optind + 1, argc - optind - 1);
+		}
 
 		return run_server();
 	}
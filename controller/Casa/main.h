@@ -1,4 +1,8 @@
+#include "command.h"
+#include "parser.h"
+
 #define	DAYLIGHT_PIN 28
+#define LOOP_LATENCY_SAMPLES 4096 // event loop iterations whose latency is kept for percentiles, the eldest overwritten
 #define CASA_ASCII "\
          @@@@@@        %@@@@@@@  @&         @@@@@@#         ,@@@@@@@  @&\n\
      @@@@@@@@@     %@@@@@@@@@@@@@@@      @@@@@@@         @@@@@@@@@@@@@@@\n\
@@ -12,21 +16,35 @@
 bool is_night_time;
 uint8_t rgb_gpio[3] = { 23, 24, 25 };
 
-int server_socket;
 int active_socket;
 
 /// <summary>
-/// Interrupt service routine for PIR sensors.
+/// Events interrupt service routines hand to the event loop, as bytes through a pipe.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// The PIR sensor of the main alarm fired.
+	/// </summary>
+	SENSORMOTION = 'm',
+	/// <summary>
+	/// The light sensor changed state.
+	/// </summary>
+	SENSORDAYLIGHT = 'd'
+} SensorEvent;
+
+/// <summary>
+/// Interrupt service routine for PIR sensors. Raises an alarm to every client, ahead of anything else queued to them.
 /// </summary>
 void did_detect_motion_signal(void);
 
 /// <summary>
-/// Interrupt service routine for light sensors. Emits a daylight report to client and adjusts home lighting.
+/// Interrupt service routine for light sensors. Adjusts home lighting and emits a daylight report to every client.
 /// </summary>
 void did_detect_daylight_change(void);
 
 /// <summary>
-/// Registers interrupts to home sensors.
+/// Registers interrupts to home sensors, and the pipe through which they reach the event loop.
 /// </summary>
 int arm_sensors(void);
 
@@ -36,19 +54,49 @@ int arm_sensors(void);
 void populate_rooms(void);
 
 /// <summary>
-/// Evaluates the message from a client.
+/// Emits a confirmation of a command.
+/// </summary>
+/// <param name="dispatch_socket">Client socket to dispatch.</param>
+/// <param name="request_id">ID of the command confirmed, or NO_REQUEST_ID.</param>
+/// <param name="type">Type of the command confirmed.</param>
+/// <param name="is_accepted">Whether the command took effect.</param>
+void emit_confirmation(int dispatch_socket, int64_t request_id, Command type, bool is_accepted);
+
+/// <summary>
+/// Emits the single confirmation of a batch, holding whether each of its node values was applied.
+/// </summary>
+/// <param name="dispatch_socket">Client socket to dispatch.</param>
+/// <param name="request_id">ID of the batch, or NO_REQUEST_ID.</param>
+/// <param name="applied">Whether each node value was applied.</param>
+/// <param name="count">Number of node values.</param>
+void emit_batch_confirmation(int dispatch_socket, int64_t request_id, const bool *applied, uint8_t count);
+
+/// <summary>
+/// Evaluates a command from a client, deferring a slow command with a correlation ID until the rest of its batch is evaluated.
 /// </summary>
 /// <param name="client_socket">Active client socket.</param>
-/// <param name="message">Message to evaluate.</param>
-void evaluate_message(const int client_socket, const char *message);
+/// <param name="command">Command decoded by the client's reactor.</param>
+void evaluate_message(const int client_socket, const struct CommandMessage *command);
+
+/// <summary>
+/// Evaluates a decoded command from a client.
+/// </summary>
+/// <param name="client_socket">Issuing client socket.</param>
+/// <param name="command">Command to evaluate.</param>
+void evaluate_command(const int client_socket, const struct CommandMessage *command);
+
+/// <summary>
+/// Reports percentiles of the time the event loop spends on each iteration, from select() returning to its next call.
+/// </summary>
+void print_loop_latency(void);
 
 /// <summary>
-/// Main controller body. Receives and processes messages from socket connections.
+/// Main controller body. Evaluates the commands reactors hand over, the only thread changing home state.
 /// </summary>
 int run_server(void); // credit to: http://beej.us/guide/bgnet/html/single/bgnet.html
 
 /// <summary>
-/// Terminates a socket and its descriptor.
+/// Terminates a socket's session and shuts the connection down, leaving the descriptor open until its reactor hands it back.
 /// </summary>
 /// <param name="client_socket">The client socket.</param>
 /// <param name="active_fds">The active FDS.</param>
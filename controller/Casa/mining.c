@@ -0,0 +1,257 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mining.h"
+
+#include "sha256.h"
+
+#include "block.h"
+#include "blockchain.h"
+
+uint8_t mining_difficulty = 0;
+struct Block *mining_block = NULL;
+
+/// <summary>
+/// struct of a nonce search worker, searching every nth nonce from its offset.
+/// </summary>
+struct MiningWorker
+{
+	pthread_t thread;
+
+	uint32_t first_nonce;
+	uint64_t hash_count;
+};
+
+/// <summary>
+/// struct of the nonce search shared between workers.
+/// </summary>
+struct MiningJob
+{
+	sha256_context midstate; // hashed block contents, preceding the nonce
+	uint8_t difficulty;
+
+	atomic_bool halted;
+	atomic_uint exhausted_count; // workers through their share of the nonce space without a hash meeting the difficulty
+	bool found;
+
+	uint32_t nonce;
+	uint8_t hash[SHA256_BYTES];
+
+	struct MiningWorker workers[MAX_MINING_THREADS];
+	uint8_t worker_count;
+};
+
+struct MiningJob mining_job;
+
+int mining_notify_fds[2] = { -1, -1 }; // written by the successful worker, read by the event loop
+
+/// <summary>
+/// Searches nonces for a hash meeting the job's difficulty, resuming from the shared midstate so only the final chunks are hashed.
+/// The last worker through its share of the nonce space without one signals the search exhausted.
+/// </summary>
+/// <param name="argument">The struct MiningWorker.</param>
+static void *search_nonces(void *argument)
+{
+	struct MiningWorker *worker = argument;
+	uint8_t hash[SHA256_BYTES];
+
+	for (uint64_t nonce = worker->first_nonce; nonce <= UINT32_MAX; nonce += mining_job.worker_count) // wider than a nonce, lest it wrap
+	{
+		const uint8_t nonce_bytes[4] = { nonce & 0xff, (nonce >> 8) & 0xff, (nonce >> 16) & 0xff, nonce >> 24 };
+
+		sha256_context context = mining_job.midstate;
+
+		sha256_hash(&context, nonce_bytes, sizeof(nonce_bytes));
+		sha256_done(&context, hash);
+
+		worker->hash_count++;
+
+		if (meets_mining_difficulty(hash, mining_job.difficulty))
+		{
+			if (!atomic_exchange(&mining_job.halted, true)) // first to find wins
+			{
+				mining_job.nonce = nonce;
+				memcpy(mining_job.hash, hash, SHA256_BYTES);
+				mining_job.found = true;
+
+				write(mining_notify_fds[1], "", 1);
+			}
+
+			return NULL;
+		}
+
+		if (worker->hash_count % MINING_CANCEL_INTERVAL == 0 && atomic_load(&mining_job.halted))
+		{
+			return NULL;
+		}
+	}
+
+	if (atomic_fetch_add(&mining_job.exhausted_count, 1) + 1 == mining_job.worker_count && !atomic_load(&mining_job.halted))
+	{
+		write(mining_notify_fds[1], "", 1);
+	}
+
+	return NULL;
+}
+
+/// <summary>
+/// Spawns one worker per online core, up to MAX_MINING_THREADS.
+/// </summary>
+static void spawn_mining_workers(void)
+{
+	long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	mining_job.worker_count = core_count < 1 ? 1 : core_count > MAX_MINING_THREADS ? MAX_MINING_THREADS : core_count;
+	atomic_store(&mining_job.halted, false);
+	atomic_store(&mining_job.exhausted_count, 0);
+	mining_job.found = false;
+
+	for (uint8_t i = 0; i < mining_job.worker_count; i++)
+	{
+		mining_job.workers[i].first_nonce = i;
+		mining_job.workers[i].hash_count = 0;
+
+		pthread_create(&mining_job.workers[i].thread, NULL, search_nonces, &mining_job.workers[i]);
+	}
+}
+
+static void join_mining_workers(void)
+{
+	for (uint8_t i = 0; i < mining_job.worker_count; i++)
+	{
+		pthread_join(mining_job.workers[i].thread, NULL);
+	}
+}
+
+void set_mining_difficulty(uint8_t difficulty)
+{
+	mining_difficulty = difficulty > MAX_MINING_DIFFICULTY ? MAX_MINING_DIFFICULTY : difficulty;
+
+	if (mining_difficulty > 0 && mining_notify_fds[0] == -1 && pipe(mining_notify_fds) == 0)
+	{
+		fcntl(mining_notify_fds[0], F_SETFL, O_NONBLOCK);
+	}
+}
+
+bool meets_mining_difficulty(const uint8_t *hash, uint8_t difficulty)
+{
+	uint8_t i = 0;
+
+	for (; difficulty >= 8; difficulty -= 8)
+	{
+		if (hash[i++] != 0)
+		{
+			return false;
+		}
+	}
+
+	return difficulty == 0 || (hash[i] >> (8 - difficulty)) == 0;
+}
+
+void start_mining(struct Block *block)
+{
+	mining_block = block;
+	mining_job.difficulty = mining_difficulty;
+
+	prepare_block_hash(block, &mining_job.midstate);
+	spawn_mining_workers();
+
+	printf("[~] Mining block #%u at difficulty %d on %d cores\n", block->index, mining_job.difficulty, mining_job.worker_count);
+}
+
+struct Block *await_mining(void)
+{
+	struct Block *block = mining_block;
+
+	join_mining_workers();
+
+	mining_block = NULL;
+
+	char notification;
+
+	while (read(mining_notify_fds[0], &notification, 1) == 1) // drain
+	{
+	}
+
+	if (block == NULL || !mining_job.found)
+	{
+		return NULL;
+	}
+
+	block->nonce = mining_job.nonce;
+	memcpy(block->hash, mining_job.hash, SHA256_BYTES);
+
+	return block;
+}
+
+void abandon_mining(void)
+{
+	atomic_store(&mining_job.halted, true);
+	join_mining_workers();
+
+	printf("[~] Abandoned mining block #%u\n", mining_block->index);
+
+	char notification;
+
+	while (read(mining_notify_fds[0], &notification, 1) == 1)
+	{
+	}
+
+	mining_block = NULL;
+}
+
+int fill_mining_descriptor(fd_set *read_fds, int fdmax)
+{
+	if (mining_block == NULL)
+	{
+		return fdmax;
+	}
+
+	FD_SET(mining_notify_fds[0], read_fds);
+
+	return mining_notify_fds[0] > fdmax ? mining_notify_fds[0] : fdmax;
+}
+
+void handle_mining_descriptor(fd_set *read_fds)
+{
+	if (mining_block != NULL && FD_ISSET(mining_notify_fds[0], read_fds))
+	{
+		complete_mined_block();
+	}
+}
+
+void benchmark_mining(unsigned int duration_seconds)
+{
+	struct Block *block = calloc(1, sizeof(struct Block));
+
+	block->timestamp = time(NULL);
+
+	mining_job.difficulty = UINT8_MAX; // unreachable - runs until halted
+	prepare_block_hash(block, &mining_job.midstate);
+
+	spawn_mining_workers();
+	sleep(duration_seconds);
+
+	atomic_store(&mining_job.halted, true);
+	join_mining_workers();
+
+	uint64_t total_count = 0;
+
+	for (uint8_t i = 0; i < mining_job.worker_count; i++)
+	{
+		total_count += mining_job.workers[i].hash_count;
+		printf("[~] Core %d: %.0f H/s\n", i, (double)mining_job.workers[i].hash_count / duration_seconds);
+	}
+
+	printf("[~] Total: %.0f H/s across %d cores (%.0f H/s per core)\n", (double)total_count / duration_seconds,
+		mining_job.worker_count, (double)total_count / duration_seconds / mining_job.worker_count);
+
+	free(block);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/select.h>
+
+#include "sha256.h"
+
+#include "block.h"
+
+#define MAX_MINING_THREADS 16
+#define MAX_MINING_DIFFICULTY 32 // leading zero bits, well inside the hash width and about one extra nonce of search
+
+#define MINING_CANCEL_INTERVAL 1024 // nonces searched between checks for cancellation
+
+uint8_t mining_difficulty; // leading zero bits required of a block hash, 0 disables proof-of-work
+struct Block *mining_block; // full block whose nonce is being searched, the eldest of any queued behind it, NULL if idle
+
+/// <summary>
+/// Sets the proof-of-work difficulty applied to sealed and replicated blocks.
+/// </summary>
+/// <param name="difficulty">Leading zero bits required, 0 to disable.</param>
+void set_mining_difficulty(uint8_t difficulty);
+
+/// <summary>
+/// Determines whether a hash satisfies a difficulty target.
+/// </summary>
+/// <param name="hash">The hash.</param>
+/// <param name="difficulty">Leading zero bits required.</param>
+/// <returns>
+///   <c>true</c> if the hash has at least the required leading zero bits.
+/// </returns>
+bool meets_mining_difficulty(const uint8_t *hash, uint8_t difficulty);
+
+/// <summary>
+/// Starts a nonce search for a full block across all cores, returning immediately.
+/// </summary>
+/// <param name="block">The block to mine, left untouched until the search is awaited.</param>
+void start_mining(struct Block *block);
+
+/// <summary>
+/// Waits for the nonce search to conclude and applies the nonce and hash to the mined block.
+/// </summary>
+/// <returns>The mined block, or NULL if the search was abandoned or no nonce met the difficulty.</returns>
+struct Block *await_mining(void);
+
+/// <summary>
+/// Cancels the nonce search early and waits for all workers to stop.
+/// </summary>
+void abandon_mining(void);
+
+/// <summary>
+/// Adds the mining completion descriptor to a descriptor set.
+/// </summary>
+/// <param name="read_fds">Descriptor set to populate.</param>
+/// <param name="fdmax">Current highest descriptor.</param>
+/// <returns>Highest descriptor, including the mining descriptor.</returns>
+int fill_mining_descriptor(fd_set *read_fds, int fdmax);
+
+/// <summary>
+/// Completes sealing of the mined block once the workers have found a nonce or exhausted them, without waiting on the search.
+/// </summary>
+/// <param name="read_fds">Descriptor set returned by select().</param>
+void handle_mining_descriptor(fd_set *read_fds);
+
+/// <summary>
+/// Measures nonce search throughput on every core against an unreachable target, and reports hashes per second.
+/// </summary>
+/// <param name="duration_seconds">Duration of the measurement.</param>
+void benchmark_mining(unsigned int duration_seconds);
@@ -25,9 +25,22 @@ struct Node
 {
 	uint8_t gpio[3];
 	uint8_t value;
+	uint32_t color; // 24 bit value last driven to an RGB node
+
+	struct Fade *fade; // transition in progress, NULL if none
 
 	char name[32];
 	NodeType type;
 
 	UT_hash_handle hh; // hashable
+};
+
+/// <summary>
+/// struct of a value to apply to a node, one of several within a batch.
+/// </summary>
+struct NodeAssignment
+{
+	char room[32];
+	char node[32];
+	int value;
 };
\ No newline at end of file
@@ -0,0 +1,491 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#include "cJSON.h"
+#include "uthash.h"
+
+#include "numeric.h"
+#include "room.h"
+#include "controller.h"
+#include "blockchain.h"
+
+#define DOUBLE_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DOUBLE_EXPONENT_MASK 0x7FF0000000000000ULL
+#define DOUBLE_HIDDEN_BIT 0x0010000000000000ULL
+#define DOUBLE_EXPONENT_BIAS 1075 // 1023, and the 52 bit significand taken as an integer
+
+#define CACHED_POWER_MIN_EXPONENT -348 // of the first cached power of ten, the rest following every 8
+
+/// <summary>
+/// struct of an unnormalized floating point value, f * 2^e.
+/// </summary>
+struct DiyFp
+{
+	uint64_t f;
+	int e;
+};
+
+static const uint64_t cached_power_significands[] = // 10^-348 through 10^340, rounded to 64 bits
+{
+	0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+	0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+	0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+	0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+	0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+	0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+	0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+	0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+	0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+	0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+	0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+	0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+	0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+	0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+	0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+	0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+	0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+	0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+	0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+	0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+	0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+	0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t cached_power_exponents[] =
+{
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+	-901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+	-582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+	-263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+	56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+	694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+	1013, 1039, 1066,
+};
+
+static const uint64_t powers_of_ten[] =
+{
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+	10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+	1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static struct DiyFp multiply_diy_fp(struct DiyFp x, struct DiyFp y)
+{
+	const unsigned __int128 product = (unsigned __int128)x.f * y.f;
+
+	struct DiyFp result = { (uint64_t)(product >> 64), x.e + y.e + 64 };
+
+	if ((uint64_t)product & (1ULL << 63)) // round to nearest
+	{
+		result.f++;
+	}
+
+	return result;
+}
+
+static struct DiyFp normalize_diy_fp(struct DiyFp x)
+{
+	const int shift = __builtin_clzll(x.f);
+
+	x.f <<= shift;
+	x.e -= shift;
+
+	return x;
+}
+
+/// <summary>
+/// Finds the boundaries halfway to the neighbouring doubles, normalized to the same exponent.
+/// </summary>
+static void find_boundaries(struct DiyFp value, struct DiyFp *minus, struct DiyFp *plus)
+{
+	*plus = normalize_diy_fp((struct DiyFp) { (value.f << 1) + 1, value.e - 1 });
+
+	if (value.f == DOUBLE_HIDDEN_BIT) // the lower neighbour is closer at a power of two
+	{
+		*minus = (struct DiyFp) { (value.f << 2) - 1, value.e - 2 };
+	}
+	else
+	{
+		*minus = (struct DiyFp) { (value.f << 1) - 1, value.e - 1 };
+	}
+
+	minus->f <<= minus->e - plus->e;
+	minus->e = plus->e;
+}
+
+/// <summary>
+/// Picks the cached power of ten that scales a binary exponent into the range digit generation works in.
+/// </summary>
+static struct DiyFp cached_power(int exponent, int *decimal_exponent)
+{
+	const double estimate = (-61 - exponent) * 0.30102999566398114 + 347; // log10(2)
+
+	int k = (int)estimate;
+	k += estimate - k > 0.0;
+
+	const unsigned int index = (unsigned int)((k >> 3) + 1);
+
+	*decimal_exponent = -(CACHED_POWER_MIN_EXPONENT + (int)index * 8);
+
+	return (struct DiyFp) { cached_power_significands[index], cached_power_exponents[index] };
+}
+
+/// <summary>
+/// Moves the last digit towards the exact value while the result stays within the rounding interval.
+/// </summary>
+static void round_last_digit(char *digits, size_t length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t distance)
+{
+	while (rest < distance && delta - rest >= ten_kappa &&
+		(rest + ten_kappa < distance || distance - rest > rest + ten_kappa - distance))
+	{
+		digits[length - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+/// <summary>
+/// Generates the shortest digits within the scaled rounding interval (Grisu2).
+/// </summary>
+static size_t generate_digits(struct DiyFp scaled, struct DiyFp upper, uint64_t delta, char *digits, int *decimal_exponent)
+{
+	const struct DiyFp one = { 1ULL << -upper.e, upper.e };
+	const uint64_t distance = upper.f - scaled.f;
+
+	uint32_t integral = (uint32_t)(upper.f >> -one.e);
+	uint64_t fractional = upper.f & (one.f - 1);
+
+	int kappa = 1;
+	size_t length = 0;
+
+	while (kappa < 10 && integral >= powers_of_ten[kappa])
+	{
+		kappa++;
+	}
+
+	while (kappa > 0)
+	{
+		const uint32_t divisor = (uint32_t)powers_of_ten[--kappa];
+		const uint32_t digit = integral / divisor;
+
+		integral %= divisor;
+
+		if (digit != 0 || length != 0)
+		{
+			digits[length++] = (char)('0' + digit);
+		}
+
+		const uint64_t rest = ((uint64_t)integral << -one.e) + fractional;
+
+		if (rest <= delta)
+		{
+			*decimal_exponent += kappa;
+			round_last_digit(digits, length, delta, rest, powers_of_ten[kappa] << -one.e, distance);
+
+			return length;
+		}
+	}
+
+	while (true)
+	{
+		fractional *= 10;
+		delta *= 10;
+
+		const char digit = (char)(fractional >> -one.e);
+
+		if (digit != 0 || length != 0)
+		{
+			digits[length++] = (char)('0' + digit);
+		}
+
+		fractional &= one.f - 1;
+		kappa--;
+
+		if (fractional < delta)
+		{
+			*decimal_exponent += kappa;
+			round_last_digit(digits, length, delta, fractional, one.f, -kappa < 20 ? distance * powers_of_ten[-kappa] : 0);
+
+			return length;
+		}
+	}
+}
+
+static size_t format_exponent(int exponent, char *buffer)
+{
+	size_t length = 0;
+
+	if (exponent < 0)
+	{
+		buffer[length++] = '-';
+		exponent = -exponent;
+	}
+
+	if (exponent >= 100)
+	{
+		buffer[length++] = (char)('0' + exponent / 100);
+		exponent %= 100;
+		buffer[length++] = (char)('0' + exponent / 10);
+	}
+	else if (exponent >= 10)
+	{
+		buffer[length++] = (char)('0' + exponent / 10);
+	}
+
+	buffer[length++] = (char)('0' + exponent % 10);
+
+	return length;
+}
+
+/// <summary>
+/// Lays out digits scaled by 10^decimal_exponent as a JSON number, in positional notation unless that would pad with more than 21 or 6 zeros.
+/// </summary>
+static size_t lay_out_digits(char *digits, size_t length, int decimal_exponent)
+{
+	const int point = (int)length + decimal_exponent; // 10^(point - 1) <= value < 10^point
+
+	if (decimal_exponent >= 0 && point <= 21) // 1234e7 -> 12340000000
+	{
+		memset(digits + length, '0', (size_t)decimal_exponent);
+
+		return (size_t)point;
+	}
+	else if (point > 0 && point <= 21) // 1234e-2 -> 12.34
+	{
+		memmove(digits + point + 1, digits + point, length - (size_t)point);
+		digits[point] = '.';
+
+		return length + 1;
+	}
+	else if (point > -6 && point <= 0) // 1234e-6 -> 0.001234
+	{
+		const size_t offset = (size_t)(2 - point);
+
+		memmove(digits + offset, digits, length);
+		memset(digits, '0', offset);
+		digits[1] = '.';
+
+		return length + offset;
+	}
+	else if (length == 1) // 1e30
+	{
+		digits[1] = 'e';
+
+		return 2 + format_exponent(point - 1, digits + 2);
+	}
+	else // 1234e30 -> 1.234e33
+	{
+		memmove(digits + 2, digits + 1, length - 1);
+		digits[1] = '.';
+		digits[length + 1] = 'e';
+
+		return length + 2 + format_exponent(point - 1, digits + length + 2);
+	}
+}
+
+static size_t format_integer(uint64_t value, char *buffer)
+{
+	char reversed[20];
+	size_t length = 0;
+
+	do
+	{
+		reversed[length++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+
+	for (size_t i = 0; i < length; i++)
+	{
+		buffer[i] = reversed[length - 1 - i];
+	}
+
+	return length;
+}
+
+size_t format_number(double value, char *buffer)
+{
+	size_t length = 0;
+
+	if (signbit(value))
+	{
+		buffer[length++] = '-';
+		value = -value;
+	}
+
+	if (value < 9007199254740992.0 && value == (double)(uint64_t)value) // integral, and exact in a double
+	{
+		length += format_integer((uint64_t)value, buffer + length);
+		buffer[length] = '\0';
+
+		return length;
+	}
+
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	const int biased_exponent = (int)((bits & DOUBLE_EXPONENT_MASK) >> 52);
+
+	struct DiyFp exact = { bits & DOUBLE_SIGNIFICAND_MASK, 1 - DOUBLE_EXPONENT_BIAS }; // subnormal
+
+	if (biased_exponent != 0)
+	{
+		exact.f += DOUBLE_HIDDEN_BIT;
+		exact.e = biased_exponent - DOUBLE_EXPONENT_BIAS;
+	}
+
+	struct DiyFp minus, plus;
+	find_boundaries(exact, &minus, &plus);
+
+	int decimal_exponent;
+	const struct DiyFp power = cached_power(plus.e, &decimal_exponent);
+
+	const struct DiyFp scaled = multiply_diy_fp(normalize_diy_fp(exact), power);
+	struct DiyFp upper = multiply_diy_fp(plus, power);
+	struct DiyFp lower = multiply_diy_fp(minus, power);
+
+	lower.f++; // stay strictly inside the interval, as the products are imprecise
+	upper.f--;
+
+	const size_t digit_count = generate_digits(scaled, upper, upper.f - lower.f, buffer + length, &decimal_exponent);
+
+	length += lay_out_digits(buffer + length, digit_count, decimal_exponent);
+	buffer[length] = '\0';
+
+	return length;
+}
+
+/// <summary>
+/// Formats a number as print_number did before, trying 15 significant digits and falling back to 17 if they do not round trip.
+/// </summary>
+static size_t format_number_printf(double value, char *buffer)
+{
+	double test;
+	int length = sprintf(buffer, "%1.15g", value);
+
+	if (sscanf(buffer, "%lg", &test) != 1 || test != value)
+	{
+		length = sprintf(buffer, "%1.17g", value);
+	}
+
+	return (size_t)length;
+}
+
+static size_t collect_numbers(const cJSON *item, double *numbers, size_t count, size_t capacity)
+{
+	for (; item != NULL; item = item->next)
+	{
+		if (cJSON_IsNumber(item) && count < capacity)
+		{
+			numbers[count++] = item->valuedouble;
+		}
+
+		count = collect_numbers(item->child, numbers, count, capacity);
+	}
+
+	return count;
+}
+
+/// <summary>
+/// Builds the room structure as emitted to an unrestricted profile, with readings as the sensors report them.
+/// </summary>
+static cJSON *build_structure_dump(void)
+{
+	cJSON *rooms_array = cJSON_CreateArray();
+
+	struct Room *room, *tmp_room;
+	struct Node *node, *tmp_node;
+
+	HASH_ITER(hh, rooms, room, tmp_room)
+	{
+		cJSON *room_object = cJSON_CreateObject();
+		cJSON *node_array = cJSON_AddArrayToObject(room_object, "nodes");
+
+		cJSON_AddStringToObject(room_object, "name", room->name);
+		cJSON_AddNumberToObject(room_object, "temperature", 18.0 + (rand() % 1000) / 62.5); // probe resolution
+
+		HASH_ITER(hh, room->nodes, node, tmp_node)
+		{
+			cJSON *node_object = cJSON_CreateObject();
+
+			cJSON_AddStringToObject(node_object, "name", node->name);
+			cJSON_AddNumberToObject(node_object, "value", node->value);
+
+			cJSON_AddItemToArray(node_array, node_object);
+		}
+
+		cJSON_AddItemToArray(rooms_array, room_object);
+	}
+
+	return rooms_array;
+}
+
+static double elapsed_nanoseconds(struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+static void benchmark_dump(const char *name, const cJSON *dump, unsigned int iterations)
+{
+	double numbers[4096];
+	char buffer[64];
+
+	const size_t count = collect_numbers(dump, numbers, 0, sizeof(numbers) / sizeof(numbers[0]));
+	size_t mismatches = 0;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		format_number(numbers[i], buffer);
+		mismatches += strtod(buffer, NULL) != numbers[i];
+	}
+
+	struct timespec start;
+	size_t checksum = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (size_t j = 0; j < count; j++)
+		{
+			checksum += format_number_printf(numbers[j], buffer);
+		}
+	}
+
+	const double printf_time = elapsed_nanoseconds(&start) / ((double)iterations * count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (size_t j = 0; j < count; j++)
+		{
+			checksum += format_number(numbers[j], buffer);
+		}
+	}
+
+	const double shortest_time = elapsed_nanoseconds(&start) / ((double)iterations * count);
+
+	printf("[~] %s: %zu numbers, printf %.0f ns/number, format_number %.0f ns/number, %.1fx (%zu not round tripped, checksum %zu)\n",
+		name, count, printf_time, shortest_time, printf_time / shortest_time, mismatches, checksum);
+}
+
+void benchmark_number_formatting(unsigned int iterations)
+{
+	cJSON *structure_dump = build_structure_dump();
+	cJSON *ledger_dump = cJSON_CreateObject();
+
+	build_block_json(ledger_dump, lead_block, true, true);
+
+	benchmark_dump("Room structure", structure_dump, iterations);
+	benchmark_dump("Ledger", ledger_dump, iterations);
+
+	cJSON_Delete(structure_dump);
+	cJSON_Delete(ledger_dump);
+}
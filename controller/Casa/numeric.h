@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAX_NUMBER_LENGTH 25 // longest formatted double, e.g. -0.0000012345678901234567
+
+/// <summary>
+/// Formats a finite double as the shortest decimal that parses back to the same value, independent of the locale.
+/// Integral values within 2^53 are written as plain integers, anything else is found by Grisu2 digit generation.
+/// </summary>
+/// <param name="value">The value, neither infinite nor NaN.</param>
+/// <param name="buffer">Output buffer of at least MAX_NUMBER_LENGTH + 1 bytes, null terminated.</param>
+/// <returns>Length of the formatted number.</returns>
+size_t format_number(double value, char *buffer);
+
+/// <summary>
+/// Measures format_number against the printf round trip cJSON used, over the numbers of room structure and ledger dumps.
+/// </summary>
+/// <param name="iterations">Passes over each dump.</param>
+void benchmark_number_formatting(unsigned int iterations);
@@ -0,0 +1,240 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "outbox.h"
+#include "session.h"
+#include "socket.h"
+#include "coalesce.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024 // the Linux limit, only declared by limits.h under _XOPEN_SOURCE
+#endif
+
+/// <summary>
+/// Copies the segments of a message into a frame, less the bytes already sent.
+/// </summary>
+static struct OutboundFrame *create_outbound_frame(Priority priority, const struct iovec *segments, int count, size_t skipped, size_t length)
+{
+	struct OutboundFrame *frame = malloc(sizeof(struct OutboundFrame) + length);
+
+	if (frame == NULL)
+	{
+		return NULL;
+	}
+
+	frame->next = NULL;
+	frame->priority = priority;
+	frame->queued_at = monotonic_milliseconds();
+	frame->length = length;
+
+	char *cursor = frame->bytes;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (skipped >= segments[i].iov_len)
+		{
+			skipped -= segments[i].iov_len;
+			continue;
+		}
+
+		memcpy(cursor, (const char *)segments[i].iov_base + skipped, segments[i].iov_len - skipped);
+		cursor += segments[i].iov_len - skipped;
+		skipped = 0;
+	}
+
+	return frame;
+}
+
+void queue_outbound_frame(int client_socket, Priority priority, const char *message, size_t length)
+{
+	const struct iovec segment = { (void *)message, length };
+
+	queue_outbound_frame_vector(client_socket, priority, &segment, 1);
+}
+
+void queue_outbound_frame_vector(int client_socket, Priority priority, const struct iovec *segments, int count)
+{
+	struct ClientSession *session = find_client_session(client_socket);
+
+	if (session == NULL) // not a client of the event loop
+	{
+		handle_write_descriptor_vector(segments, count, client_socket);
+		return;
+	}
+
+	size_t length = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		length += segments[i].iov_len;
+	}
+
+	if (priority == PRIORITYBULK && is_outbox_pending(&session->outbox) && session->outbox.queued_bytes + length > MAX_OUTBOX_BYTES)
+	{
+		printf("[!] Dropped %zu byte report to Client %d - %zu bytes behind\n", length, client_socket, session->outbox.queued_bytes);
+		return;
+	}
+
+	queue_outbox_frame_vector(client_socket, &session->outbox, priority, segments, count);
+}
+
+void queue_outbox_frame_vector(int socket, struct Outbox *outbox, Priority priority, const struct iovec *segments, int count)
+{
+	size_t length = 0;
+	size_t sent = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		length += segments[i].iov_len;
+	}
+
+	if (!is_outbox_pending(outbox) && count <= IOV_MAX) // nothing ahead of it, so written straight from the caller's buffers
+	{
+		struct msghdr message = { 0 };
+
+		message.msg_iov = (struct iovec *)segments;
+		message.msg_iovlen = count;
+
+		const ssize_t bytes = sendmsg(socket, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) // gone - its input side reports the closure
+		{
+			return;
+		}
+
+		sent = bytes > 0 ? bytes : 0;
+
+		if (sent == length)
+		{
+			if (priority == PRIORITYALARM)
+			{
+				printf("[>] Alarm reached Client %d without queuing\n", socket);
+			}
+
+			return;
+		}
+	}
+
+	struct OutboundFrame *frame = create_outbound_frame(priority, segments, count, sent, length - sent);
+
+	if (frame == NULL)
+	{
+		return;
+	}
+
+	if (sent > 0) // the rest of a frame begun goes before any other
+	{
+		outbox->sending = frame;
+		outbox->sent = 0;
+	}
+	else if (outbox->tails[priority] != NULL)
+	{
+		outbox->tails[priority]->next = frame;
+		outbox->tails[priority] = frame;
+	}
+	else
+	{
+		outbox->heads[priority] = outbox->tails[priority] = frame;
+	}
+
+	outbox->queued_bytes += frame->length;
+}
+
+/// <summary>
+/// Takes the eldest frame of the most urgent lane to be sent next.
+/// </summary>
+static struct OutboundFrame *dequeue_outbound_frame(struct Outbox *outbox)
+{
+	for (uint8_t priority = 0; priority < PRIORITY_COUNT; priority++)
+	{
+		struct OutboundFrame *frame = outbox->heads[priority];
+
+		if (frame != NULL)
+		{
+			outbox->heads[priority] = frame->next;
+
+			if (frame->next == NULL)
+			{
+				outbox->tails[priority] = NULL;
+			}
+
+			return frame;
+		}
+	}
+
+	return NULL;
+}
+
+bool flush_outbox(int client_socket, struct Outbox *outbox)
+{
+	while (true)
+	{
+		if (outbox->sending == NULL)
+		{
+			outbox->sending = dequeue_outbound_frame(outbox);
+			outbox->sent = 0;
+
+			if (outbox->sending == NULL)
+			{
+				return false;
+			}
+		}
+
+		struct OutboundFrame *frame = outbox->sending;
+		const ssize_t bytes = send(client_socket, frame->bytes + outbox->sent, frame->length - outbox->sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		if (bytes < 0)
+		{
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+			{
+				return true;
+			}
+
+			release_outbox(outbox); // gone - its input side reports the closure
+			return false;
+		}
+
+		outbox->sent += bytes;
+
+		if (outbox->sent < frame->length)
+		{
+			return true;
+		}
+
+		if (frame->priority == PRIORITYALARM)
+		{
+			printf("[>] Alarm reached Client %d after %llu ms queued\n", client_socket, (unsigned long long)(monotonic_milliseconds() - frame->queued_at));
+		}
+
+		outbox->queued_bytes -= frame->length;
+		outbox->sending = NULL;
+
+		free(frame);
+	}
+}
+
+bool is_outbox_pending(const struct Outbox *outbox)
+{
+	return outbox->queued_bytes > 0;
+}
+
+void release_outbox(struct Outbox *outbox)
+{
+	struct OutboundFrame *frame;
+
+	free(outbox->sending);
+
+	while ((frame = dequeue_outbound_frame(outbox)) != NULL)
+	{
+		free(frame);
+	}
+
+	memset(outbox, 0, sizeof(struct Outbox));
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <sys/uio.h>
+
+#define PRIORITY_COUNT 4
+#define MAX_OUTBOX_BYTES (1024 * 1024) // bytes a client may fall behind by before further bulk frames to it are dropped
+#define CLIENT_SEND_BUFFER_SIZE (16 * 1024) // bytes the kernel holds for a client, beyond reordering - the rest waits in lanes
+
+/// <summary>
+/// Priorities of messages sent to a client, each queued in a lane of its own. A frame is never interrupted once begun,
+/// but the next one sent is the eldest of the most urgent lane.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// Safety events, such as a triggered alarm.
+	/// </summary>
+	PRIORITYALARM = 0,
+	/// <summary>
+	/// Unsolicited notices, such as daylight shifts and heartbeats.
+	/// </summary>
+	PRIORITYNOTIFICATION = 1,
+	/// <summary>
+	/// Confirmations of a client's commands, reporting the state they changed.
+	/// </summary>
+	PRIORITYDELTA = 2,
+	/// <summary>
+	/// Reports of the whole home and system, dropped if the client falls too far behind.
+	/// </summary>
+	PRIORITYBULK = 3
+} Priority;
+
+/// <summary>
+/// struct of a message waiting to be sent.
+/// </summary>
+struct OutboundFrame
+{
+	struct OutboundFrame *next;
+
+	Priority priority;
+	uint64_t queued_at; // from monotonic_milliseconds
+
+	size_t length;
+	char bytes[];
+};
+
+/// <summary>
+/// struct of a client's queued messages, by priority, behind the frame being sent.
+/// </summary>
+struct Outbox
+{
+	struct OutboundFrame *heads[PRIORITY_COUNT];
+	struct OutboundFrame *tails[PRIORITY_COUNT];
+
+	struct OutboundFrame *sending; // begun, sent before any other
+	size_t sent; // bytes of it
+
+	size_t queued_bytes;
+};
+
+/// <summary>
+/// Sends a message to a client, at once if nothing is queued ahead of it, queuing whatever the socket does not take.
+/// </summary>
+/// <param name="client_socket">Destination socket.</param>
+/// <param name="priority">Lane of the message.</param>
+/// <param name="message">Message, which may hold null bytes if binary.</param>
+/// <param name="length">Length of the message.</param>
+void queue_outbound_frame(int client_socket, Priority priority, const char *message, size_t length);
+
+/// <summary>
+/// Sends a message assembled from segments to a client, as queue_outbound_frame does, copying them together only if queued.
+/// </summary>
+/// <param name="client_socket">Destination socket.</param>
+/// <param name="priority">Lane of the message.</param>
+/// <param name="segments">Segments of the message, in order.</param>
+/// <param name="count">Number of segments.</param>
+void queue_outbound_frame_vector(int client_socket, Priority priority, const struct iovec *segments, int count);
+
+/// <summary>
+/// Sends a message through any outbox, at once if nothing is queued ahead of it, queuing whatever the socket does not take.
+/// Unlike queue_outbound_frame, no report is ever dropped, so the caller bounds how far the socket may fall behind.
+/// </summary>
+/// <param name="socket">Destination socket, non-blocking.</param>
+/// <param name="outbox">Its outbox.</param>
+/// <param name="priority">Lane of the message.</param>
+/// <param name="segments">Segments of the message, in order.</param>
+/// <param name="count">Number of segments.</param>
+void queue_outbox_frame_vector(int socket, struct Outbox *outbox, Priority priority, const struct iovec *segments, int count);
+
+/// <summary>
+/// Sends queued messages, most urgent first, until the socket would block. Messages to a socket that has failed are discarded.
+/// </summary>
+/// <param name="client_socket">Destination socket, writable.</param>
+/// <param name="outbox">Its outbox.</param>
+/// <returns>
+///   <c>true</c> if messages remain queued, to be sent once the socket is writable again.
+/// </returns>
+bool flush_outbox(int client_socket, struct Outbox *outbox);
+
+/// <summary>
+/// Determines whether an outbox has messages waiting.
+/// </summary>
+/// <param name="outbox">Outbox.</param>
+/// <returns>
+///   <c>true</c> if any message is queued or partly sent.
+/// </returns>
+bool is_outbox_pending(const struct Outbox *outbox);
+
+/// <summary>
+/// Discards every queued message.
+/// </summary>
+/// <param name="outbox">Outbox to empty.</param>
+void release_outbox(struct Outbox *outbox);
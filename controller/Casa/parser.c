@@ -0,0 +1,1388 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <time.h>
+
+#include "cJSON.h"
+
+#include "parser.h"
+#include "arena.h"
+
+#define PACKED_STRING 0xa0 // MessagePack fixstr, and the family of str 8, 16 and 32
+#define PACKED_MAP 0x80
+#define PACKED_ARRAY 0x90
+
+#define PAYLOAD_FIELD(key, kind, member, required) \
+	{ key, kind, offsetof(struct CommandMessage, member), sizeof(((struct CommandMessage *)0)->member), required }
+#define ASSIGNMENT_FIELD(key, kind, member) \
+	{ key, kind, offsetof(struct NodeAssignment, member), sizeof(((struct NodeAssignment *)0)->member), true }
+
+static const struct PayloadField node_fields[] =
+{
+	PAYLOAD_FIELD("room", FIELDSTRING, room, true),
+	PAYLOAD_FIELD("node", FIELDSTRING, node, true),
+	PAYLOAD_FIELD("value", FIELDINTEGER, value, true),
+	PAYLOAD_FIELD("nonce", FIELDSTRING, nonce, false),
+	{ NULL }
+};
+
+static const struct PayloadField fade_fields[] =
+{
+	PAYLOAD_FIELD("room", FIELDSTRING, room, true),
+	PAYLOAD_FIELD("node", FIELDSTRING, node, true),
+	PAYLOAD_FIELD("value", FIELDINTEGER, value, true),
+	PAYLOAD_FIELD("duration", FIELDINTEGER, duration, true),
+	PAYLOAD_FIELD("easing", FIELDSTRING, easing, false),
+	PAYLOAD_FIELD("nonce", FIELDSTRING, nonce, false),
+	{ NULL }
+};
+
+static const struct PayloadField batch_fields[] =
+{
+	PAYLOAD_FIELD("nodes", FIELDASSIGNMENTS, assignments, true),
+	PAYLOAD_FIELD("nonce", FIELDSTRING, nonce, false),
+	{ NULL }
+};
+
+static const struct PayloadField scene_fields[] =
+{
+	PAYLOAD_FIELD("scene", FIELDSTRING, scene, true),
+	PAYLOAD_FIELD("nonce", FIELDSTRING, nonce, false),
+	{ NULL }
+};
+
+static const struct PayloadField assignment_fields[] =
+{
+	ASSIGNMENT_FIELD("room", FIELDSTRING, room),
+	ASSIGNMENT_FIELD("node", FIELDSTRING, node),
+	ASSIGNMENT_FIELD("value", FIELDINTEGER, value),
+	{ NULL }
+};
+
+static const struct PayloadField subtype_fields[] =
+{
+	PAYLOAD_FIELD("type", FIELDSTRING, subtype, true),
+	{ NULL }
+};
+
+static const struct PayloadField identification_fields[] =
+{
+	PAYLOAD_FIELD("value", FIELDSTRING, identification, true),
+	PAYLOAD_FIELD("encoding", FIELDSTRING, encoding, false),
+	{ NULL }
+};
+
+static const struct PayloadField no_fields[] =
+{
+	{ NULL }
+};
+
+/// <summary>
+/// struct of the parser's position within a message.
+/// </summary>
+struct ParserState
+{
+	const char *cursor;
+	const char *end;
+};
+
+/// <summary>
+/// Resolves the payload fields accepted by a command type.
+/// </summary>
+/// <returns>Null terminated field table, or NULL if clients may not issue the command.</returns>
+static const struct PayloadField *resolve_payload_fields(Command type)
+{
+	switch (type)
+	{
+	case CMDNODE:
+		return node_fields;
+	case CMDBATCH:
+		return batch_fields;
+	case CMDSCENE:
+		return scene_fields;
+	case CMDFADE:
+		return fade_fields;
+	case CMDREPORT:
+	case CMDDEMO:
+		return subtype_fields;
+	case CMDIDENTIFICATION:
+		return identification_fields;
+	case CMDCONFIRMATION:
+		return no_fields;
+	default:
+		return NULL;
+	}
+}
+
+static void skip_whitespace(struct ParserState *state)
+{
+	while (state->cursor < state->end && (*state->cursor == ' ' || *state->cursor == '\t' || *state->cursor == '\n' || *state->cursor == '\r'))
+	{
+		state->cursor++;
+	}
+}
+
+static bool consume_character(struct ParserState *state, char character)
+{
+	skip_whitespace(state);
+
+	if (state->cursor < state->end && *state->cursor == character)
+	{
+		state->cursor++;
+		return true;
+	}
+
+	return false;
+}
+
+static bool consume_literal(struct ParserState *state, const char *literal)
+{
+	size_t literal_length = strlen(literal);
+
+	if ((size_t)(state->end - state->cursor) < literal_length || memcmp(state->cursor, literal, literal_length) != 0)
+	{
+		return false;
+	}
+
+	state->cursor += literal_length;
+
+	return true;
+}
+
+static int32_t parse_hex_quad(struct ParserState *state)
+{
+	if (state->end - state->cursor < 4)
+	{
+		return -1;
+	}
+
+	int32_t code_point = 0;
+
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		char digit = *state->cursor++;
+
+		code_point <<= 4;
+
+		if (digit >= '0' && digit <= '9')
+		{
+			code_point |= digit - '0';
+		}
+		else if ((digit | 0x20) >= 'a' && (digit | 0x20) <= 'f')
+		{
+			code_point |= (digit | 0x20) - 'a' + 10;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	return code_point;
+}
+
+/// <summary>
+/// Decodes a string, writing as much as fits into the destination.
+/// </summary>
+/// <param name="dest">Destination buffer, or NULL to skip the string.</param>
+/// <param name="dest_size">Size of the destination buffer.</param>
+/// <returns>Decoded length, which exceeds dest_size - 1 if truncated, or -1 if malformed.</returns>
+static int32_t parse_string(struct ParserState *state, char *dest, size_t dest_size)
+{
+	if (!consume_character(state, '"'))
+	{
+		return -1;
+	}
+
+	int32_t length = 0;
+
+	while (state->cursor < state->end && *state->cursor != '"')
+	{
+		const char *run = state->cursor;
+
+		while (state->cursor < state->end && *state->cursor != '"' && *state->cursor != '\\' && (uint8_t)*state->cursor >= 0x20) // copy unescaped runs at once
+		{
+			state->cursor++;
+		}
+
+		if (state->cursor > run)
+		{
+			size_t run_length = state->cursor - run;
+
+			if (dest != NULL && (size_t)length < dest_size - 1)
+			{
+				memcpy(dest + length, run, run_length < dest_size - 1 - length ? run_length : dest_size - 1 - length);
+			}
+
+			length += run_length;
+
+			continue;
+		}
+
+		uint8_t encoded[4];
+		uint8_t encoded_length = 1;
+
+		char character = *state->cursor++;
+
+		if ((uint8_t)character < 0x20) // control characters must be escaped
+		{
+			return -1;
+		}
+
+		if (character != '\\')
+		{
+			encoded[0] = character;
+		}
+		else if (state->cursor == state->end)
+		{
+			return -1;
+		}
+		else
+		{
+			switch (*state->cursor++)
+			{
+			case '"': encoded[0] = '"'; break;
+			case '\\': encoded[0] = '\\'; break;
+			case '/': encoded[0] = '/'; break;
+			case 'b': encoded[0] = '\b'; break;
+			case 'f': encoded[0] = '\f'; break;
+			case 'n': encoded[0] = '\n'; break;
+			case 'r': encoded[0] = '\r'; break;
+			case 't': encoded[0] = '\t'; break;
+			case 'u':
+			{
+				int32_t code_point = parse_hex_quad(state);
+
+				if (code_point >= 0xd800 && code_point <= 0xdbff) // high surrogate, a low surrogate must follow
+				{
+					int32_t low_surrogate = consume_literal(state, "\\u") ? parse_hex_quad(state) : -1;
+
+					if (low_surrogate < 0xdc00 || low_surrogate > 0xdfff)
+					{
+						return -1;
+					}
+
+					code_point = 0x10000 + ((code_point - 0xd800) << 10) + (low_surrogate - 0xdc00);
+				}
+				else if (code_point < 0 || (code_point >= 0xdc00 && code_point <= 0xdfff))
+				{
+					return -1;
+				}
+
+				if (code_point < 0x80)
+				{
+					encoded[0] = code_point;
+				}
+				else if (code_point < 0x800)
+				{
+					encoded[0] = 0xc0 | (code_point >> 6);
+					encoded[1] = 0x80 | (code_point & 0x3f);
+					encoded_length = 2;
+				}
+				else if (code_point < 0x10000)
+				{
+					encoded[0] = 0xe0 | (code_point >> 12);
+					encoded[1] = 0x80 | ((code_point >> 6) & 0x3f);
+					encoded[2] = 0x80 | (code_point & 0x3f);
+					encoded_length = 3;
+				}
+				else
+				{
+					encoded[0] = 0xf0 | (code_point >> 18);
+					encoded[1] = 0x80 | ((code_point >> 12) & 0x3f);
+					encoded[2] = 0x80 | ((code_point >> 6) & 0x3f);
+					encoded[3] = 0x80 | (code_point & 0x3f);
+					encoded_length = 4;
+				}
+
+				break;
+			}
+			default:
+				return -1;
+			}
+		}
+
+		for (uint8_t i = 0; i < encoded_length; i++, length++)
+		{
+			if (dest != NULL && (size_t)length < dest_size - 1)
+			{
+				dest[length] = encoded[i];
+			}
+		}
+	}
+
+	if (state->cursor == state->end) // unterminated
+	{
+		return -1;
+	}
+
+	state->cursor++;
+
+	if (dest != NULL)
+	{
+		dest[(size_t)length < dest_size - 1 ? (size_t)length : dest_size - 1] = '\0';
+	}
+
+	return length;
+}
+
+static bool parse_number(struct ParserState *state, double *number)
+{
+	skip_whitespace(state);
+
+	const char *start = state->cursor;
+
+	consume_literal(state, "-");
+
+	if (state->cursor == state->end || *state->cursor < '0' || *state->cursor > '9')
+	{
+		return false;
+	}
+
+	if (*state->cursor++ != '0') // no leading zeroes
+	{
+		while (state->cursor < state->end && *state->cursor >= '0' && *state->cursor <= '9')
+		{
+			state->cursor++;
+		}
+	}
+
+	bool is_fractional = false;
+
+	if (consume_literal(state, "."))
+	{
+		is_fractional = true;
+
+		const char *fraction = state->cursor;
+
+		while (state->cursor < state->end && *state->cursor >= '0' && *state->cursor <= '9')
+		{
+			state->cursor++;
+		}
+
+		if (state->cursor == fraction)
+		{
+			return false;
+		}
+	}
+
+	if (state->cursor < state->end && (*state->cursor | 0x20) == 'e')
+	{
+		is_fractional = true;
+		state->cursor++;
+
+		if (state->cursor < state->end && (*state->cursor == '+' || *state->cursor == '-'))
+		{
+			state->cursor++;
+		}
+
+		const char *exponent = state->cursor;
+
+		while (state->cursor < state->end && *state->cursor >= '0' && *state->cursor <= '9')
+		{
+			state->cursor++;
+		}
+
+		if (state->cursor == exponent)
+		{
+			return false;
+		}
+	}
+
+	if (!is_fractional) // common case, without strtod
+	{
+		double integer = 0;
+
+		for (const char *digit = *start == '-' ? start + 1 : start; digit < state->cursor; digit++)
+		{
+			integer = integer * 10 + (*digit - '0');
+		}
+
+		*number = *start == '-' ? -integer : integer;
+
+		return true;
+	}
+
+	char number_buffer[32]; // the input is not null terminated
+
+	if ((size_t)(state->cursor - start) >= sizeof(number_buffer))
+	{
+		return false;
+	}
+
+	memcpy(number_buffer, start, state->cursor - start);
+	number_buffer[state->cursor - start] = '\0';
+
+	*number = strtod(number_buffer, NULL);
+
+	return true;
+}
+
+static int saturate_number(double number)
+{
+	return number >= INT_MAX ? INT_MAX : number <= INT_MIN ? INT_MIN : (int)number;
+}
+
+static bool is_request_id(double number)
+{
+	return number >= 0 && number <= UINT32_MAX && number == (int64_t)number;
+}
+
+/// <summary>
+/// Skips a value of any type, bounded in nesting.
+/// </summary>
+static bool skip_value(struct ParserState *state, uint8_t depth)
+{
+	skip_whitespace(state);
+
+	if (state->cursor == state->end)
+	{
+		return false;
+	}
+
+	switch (*state->cursor)
+	{
+	case '"':
+		return parse_string(state, NULL, 0) >= 0;
+	case 't':
+		return consume_literal(state, "true");
+	case 'f':
+		return consume_literal(state, "false");
+	case 'n':
+		return consume_literal(state, "null");
+	case '{':
+	case '[':
+	{
+		const bool is_object = *state->cursor++ == '{';
+		const char closing = is_object ? '}' : ']';
+
+		if (depth == MAX_SKIPPED_DEPTH)
+		{
+			return false;
+		}
+
+		if (consume_character(state, closing))
+		{
+			return true;
+		}
+
+		do
+		{
+			if ((is_object && (parse_string(state, NULL, 0) < 0 || !consume_character(state, ':'))) || !skip_value(state, depth + 1))
+			{
+				return false;
+			}
+		} while (consume_character(state, ','));
+
+		return consume_character(state, closing);
+	}
+	default:
+	{
+		double number;
+		return parse_number(state, &number);
+	}
+	}
+}
+
+static bool parse_assignments(struct ParserState *state, struct CommandMessage *command);
+
+/// <summary>
+/// Parses a payload object, storing each field its command accepts into a command, or a node assignment, and skipping any other.
+/// </summary>
+static bool parse_payload(struct ParserState *state, const struct PayloadField *fields, void *record)
+{
+	uint32_t found_fields = 0;
+
+	if (!consume_character(state, '{'))
+	{
+		return false;
+	}
+
+	if (!consume_character(state, '}'))
+	{
+		do
+		{
+			char key[16];
+			int32_t key_length = parse_string(state, key, sizeof(key));
+
+			if (key_length < 0 || !consume_character(state, ':'))
+			{
+				return false;
+			}
+
+			const struct PayloadField *field = NULL;
+
+			for (uint8_t i = 0; key_length < (int32_t)sizeof(key) && fields[i].key != NULL; i++)
+			{
+				if (strcmp(fields[i].key, key) == 0)
+				{
+					field = &fields[i];
+					found_fields |= 1u << i;
+
+					break;
+				}
+			}
+
+			if (field == NULL)
+			{
+				if (!skip_value(state, 0))
+				{
+					return false;
+				}
+			}
+			else if (field->kind == FIELDSTRING)
+			{
+				int32_t value_length = parse_string(state, (char *)record + field->offset, field->size);
+
+				if (value_length < 0 || (size_t)value_length >= field->size) // oversized values are never truncated
+				{
+					return false;
+				}
+			}
+			else if (field->kind == FIELDASSIGNMENTS)
+			{
+				if (!parse_assignments(state, (struct CommandMessage *)record))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				double number;
+
+				if (!parse_number(state, &number))
+				{
+					return false;
+				}
+
+				*(int *)((char *)record + field->offset) = saturate_number(number);
+			}
+		} while (consume_character(state, ','));
+
+		if (!consume_character(state, '}'))
+		{
+			return false;
+		}
+	}
+
+	for (uint8_t i = 0; fields[i].key != NULL; i++)
+	{
+		if (fields[i].required && (found_fields & (1u << i)) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Parses the array of node assignments of a batch, of at least one and at most MAX_BATCH_SIZE objects.
+/// </summary>
+static bool parse_assignments(struct ParserState *state, struct CommandMessage *command)
+{
+	command->assignment_count = 0; // a repeated key replaces the nodes, as it would any other field
+
+	if (!consume_character(state, '[') || consume_character(state, ']'))
+	{
+		return false;
+	}
+
+	do
+	{
+		if (command->assignment_count == MAX_BATCH_SIZE || !parse_payload(state, assignment_fields, &command->assignments[command->assignment_count++]))
+		{
+			return false;
+		}
+	} while (consume_character(state, ','));
+
+	return consume_character(state, ']');
+}
+
+bool parse_command(const char *message, size_t length, struct CommandMessage *command)
+{
+	memset(command, 0, sizeof(struct CommandMessage));
+	command->id = NO_REQUEST_ID;
+
+	if (length == 0 || length > MAX_COMMAND_LENGTH)
+	{
+		return false;
+	}
+
+	struct ParserState state = { message, message + length };
+
+	const struct PayloadField *fields = NULL;
+
+	const char *deferred_payload = NULL; // precedes the type, so parsed once the fields are known
+	bool payload_parsed = false;
+
+	if (!consume_character(&state, '{') || consume_character(&state, '}'))
+	{
+		return false;
+	}
+
+	do
+	{
+		char key[16];
+
+		if (parse_string(&state, key, sizeof(key)) < 0 || !consume_character(&state, ':'))
+		{
+			return false;
+		}
+
+		if (strcmp(key, "type") == 0 && fields == NULL)
+		{
+			double number;
+
+			if (!parse_number(&state, &number) || number < 0 || number > INT8_MAX || number != (int)number || (fields = resolve_payload_fields((Command)number)) == NULL)
+			{
+				return false;
+			}
+
+			command->type = (Command)number;
+		}
+		else if (strcmp(key, "id") == 0 && command->id == NO_REQUEST_ID)
+		{
+			double number;
+
+			if (!parse_number(&state, &number) || !is_request_id(number))
+			{
+				return false;
+			}
+
+			command->id = (int64_t)number;
+		}
+		else if (strcmp(key, "payload") == 0 && !payload_parsed && deferred_payload == NULL)
+		{
+			skip_whitespace(&state);
+
+			if (fields != NULL)
+			{
+				payload_parsed = true;
+
+				if (!parse_payload(&state, fields, command))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				deferred_payload = state.cursor;
+
+				if (!skip_value(&state, 0))
+				{
+					return false;
+				}
+			}
+		}
+		else if (!skip_value(&state, 0)) // unknown keys and repeated keys are ignored
+		{
+			return false;
+		}
+	} while (consume_character(&state, ','));
+
+	if (!consume_character(&state, '}') || fields == NULL) // trailing input is ignored, as with cJSON_Parse
+	{
+		return false;
+	}
+
+	if (deferred_payload != NULL)
+	{
+		struct ParserState payload_state = { deferred_payload, state.end };
+
+		return parse_payload(&payload_state, fields, command);
+	}
+
+	if (!payload_parsed) // absent, so only valid if nothing is required
+	{
+		for (uint8_t i = 0; fields[i].key != NULL; i++)
+		{
+			if (fields[i].required)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Reads a big endian integer of a number of bytes.
+/// </summary>
+static bool read_packed_integer(struct ParserState *state, uint8_t bytes, uint64_t *value)
+{
+	if (state->end - state->cursor < bytes)
+	{
+		return false;
+	}
+
+	*value = 0;
+
+	for (uint8_t i = 0; i < bytes; i++)
+	{
+		*value = (*value << 8) | (uint8_t)*state->cursor++;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Reads the header of a MessagePack string, map or array.
+/// </summary>
+/// <param name="family">PACKED_STRING, PACKED_MAP or PACKED_ARRAY.</param>
+/// <param name="count">Output reference to the byte length or member count.</param>
+static bool read_packed_header(struct ParserState *state, uint8_t family, uint32_t *count)
+{
+	if (state->cursor == state->end)
+	{
+		return false;
+	}
+
+	const uint8_t type = (uint8_t)*state->cursor++;
+	const uint8_t fixed_mask = family == PACKED_STRING ? 0xe0 : 0xf0; // fixstr holds 5 bits of length, fixmap and fixarray 4
+
+	if ((type & fixed_mask) == family)
+	{
+		*count = type & ~fixed_mask;
+		return true;
+	}
+
+	uint8_t length_bytes;
+
+	switch (type)
+	{
+	case 0xd9: case 0xda: case 0xdb: // str 8, 16 and 32
+		length_bytes = family == PACKED_STRING ? 1 << (type - 0xd9) : 0;
+		break;
+	case 0xdc: case 0xdd: // array 16 and 32
+		length_bytes = family == PACKED_ARRAY ? 2 << (type - 0xdc) : 0;
+		break;
+	case 0xde: case 0xdf: // map 16 and 32
+		length_bytes = family == PACKED_MAP ? 2 << (type - 0xde) : 0;
+		break;
+	default:
+		length_bytes = 0;
+	}
+
+	uint64_t value;
+
+	if (length_bytes == 0 || !read_packed_integer(state, length_bytes, &value))
+	{
+		return false;
+	}
+
+	*count = (uint32_t)value;
+
+	return true;
+}
+
+/// <summary>
+/// Reads a string, writing as much as fits into the destination.
+/// </summary>
+/// <param name="dest">Destination buffer, or NULL to skip the string.</param>
+/// <param name="dest_size">Size of the destination buffer.</param>
+/// <returns>Length, which exceeds dest_size - 1 if truncated, or -1 if malformed.</returns>
+static int32_t read_packed_string(struct ParserState *state, char *dest, size_t dest_size)
+{
+	uint32_t length;
+
+	if (!read_packed_header(state, PACKED_STRING, &length) || length > INT32_MAX || (size_t)(state->end - state->cursor) < length)
+	{
+		return -1;
+	}
+
+	if (dest != NULL)
+	{
+		const size_t copied = length < dest_size - 1 ? length : dest_size - 1;
+
+		memcpy(dest, state->cursor, copied);
+		dest[copied] = '\0';
+	}
+
+	state->cursor += length;
+
+	return (int32_t)length;
+}
+
+static bool read_packed_number(struct ParserState *state, double *number)
+{
+	if (state->cursor == state->end)
+	{
+		return false;
+	}
+
+	const uint8_t type = (uint8_t)*state->cursor++;
+	uint64_t value;
+
+	if (type <= 0x7f || type >= 0xe0) // positive and negative fixint
+	{
+		*number = (int8_t)type;
+		return true;
+	}
+
+	switch (type)
+	{
+	case 0xcc: case 0xcd: case 0xce: case 0xcf: // uint 8, 16, 32 and 64
+		if (!read_packed_integer(state, 1 << (type - 0xcc), &value))
+		{
+			return false;
+		}
+
+		*number = (double)value;
+		return true;
+	case 0xd0: case 0xd1: case 0xd2: case 0xd3: // int 8, 16, 32 and 64, sign extended from their width
+	{
+		const uint8_t bytes = 1 << (type - 0xd0);
+
+		if (!read_packed_integer(state, bytes, &value))
+		{
+			return false;
+		}
+
+		*number = (double)((int64_t)(value << (64 - 8 * bytes)) >> (64 - 8 * bytes));
+		return true;
+	}
+	case 0xca: // float 32
+	{
+		if (!read_packed_integer(state, 4, &value))
+		{
+			return false;
+		}
+
+		union { uint32_t bits; float number; } single = { (uint32_t)value };
+
+		*number = single.number;
+		return true;
+	}
+	case 0xcb: // float 64
+	{
+		if (!read_packed_integer(state, 8, &value))
+		{
+			return false;
+		}
+
+		union { uint64_t bits; double number; } wide = { value };
+
+		*number = wide.number;
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+/// <summary>
+/// Skips a value of any type, bounded in nesting.
+/// </summary>
+static bool skip_packed_value(struct ParserState *state, uint8_t depth)
+{
+	if (state->cursor == state->end)
+	{
+		return false;
+	}
+
+	const uint8_t type = (uint8_t)*state->cursor;
+	uint32_t count;
+	uint64_t length;
+
+	if ((type & 0xe0) == PACKED_STRING || (type >= 0xd9 && type <= 0xdb))
+	{
+		return read_packed_string(state, NULL, 0) >= 0;
+	}
+
+	const bool is_map = (type & 0xf0) == PACKED_MAP || type == 0xde || type == 0xdf;
+
+	if (is_map || (type & 0xf0) == PACKED_ARRAY || type == 0xdc || type == 0xdd)
+	{
+		if (depth == MAX_SKIPPED_DEPTH || !read_packed_header(state, is_map ? PACKED_MAP : PACKED_ARRAY, &count))
+		{
+			return false;
+		}
+
+		for (uint64_t i = 0; i < (is_map ? 2 * (uint64_t)count : count); i++)
+		{
+			if (!skip_packed_value(state, depth + 1))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	if (type == 0xc0 || type == 0xc2 || type == 0xc3) // nil, false and true
+	{
+		state->cursor++;
+		return true;
+	}
+
+	if (type >= 0xc4 && type <= 0xc6) // bin 8, 16 and 32
+	{
+		state->cursor++;
+
+		if (!read_packed_integer(state, 1 << (type - 0xc4), &length) || (uint64_t)(state->end - state->cursor) < length)
+		{
+			return false;
+		}
+
+		state->cursor += length;
+		return true;
+	}
+
+	double number;
+
+	return read_packed_number(state, &number);
+}
+
+static bool parse_packed_assignments(struct ParserState *state, struct CommandMessage *command);
+
+/// <summary>
+/// Parses a payload map, storing each field its command accepts into a command, or a node assignment, and skipping any other.
+/// </summary>
+static bool parse_packed_payload(struct ParserState *state, const struct PayloadField *fields, void *record)
+{
+	uint32_t found_fields = 0;
+	uint32_t member_count;
+
+	if (!read_packed_header(state, PACKED_MAP, &member_count))
+	{
+		return false;
+	}
+
+	for (uint32_t member = 0; member < member_count; member++)
+	{
+		char key[16];
+		int32_t key_length = read_packed_string(state, key, sizeof(key));
+
+		if (key_length < 0)
+		{
+			return false;
+		}
+
+		const struct PayloadField *field = NULL;
+
+		for (uint8_t i = 0; key_length < (int32_t)sizeof(key) && fields[i].key != NULL; i++)
+		{
+			if (strcmp(fields[i].key, key) == 0)
+			{
+				field = &fields[i];
+				found_fields |= 1u << i;
+
+				break;
+			}
+		}
+
+		if (field == NULL)
+		{
+			if (!skip_packed_value(state, 0))
+			{
+				return false;
+			}
+		}
+		else if (field->kind == FIELDSTRING)
+		{
+			int32_t value_length = read_packed_string(state, (char *)record + field->offset, field->size);
+
+			if (value_length < 0 || (size_t)value_length >= field->size) // oversized values are never truncated
+			{
+				return false;
+			}
+		}
+		else if (field->kind == FIELDASSIGNMENTS)
+		{
+			if (!parse_packed_assignments(state, (struct CommandMessage *)record))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			double number;
+
+			if (!read_packed_number(state, &number))
+			{
+				return false;
+			}
+
+			*(int *)((char *)record + field->offset) = saturate_number(number);
+		}
+	}
+
+	for (uint8_t i = 0; fields[i].key != NULL; i++)
+	{
+		if (fields[i].required && (found_fields & (1u << i)) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Parses the array of node assignments of a batch, of at least one and at most MAX_BATCH_SIZE maps.
+/// </summary>
+static bool parse_packed_assignments(struct ParserState *state, struct CommandMessage *command)
+{
+	uint32_t element_count;
+
+	command->assignment_count = 0; // a repeated key replaces the nodes, as it would any other field
+
+	if (!read_packed_header(state, PACKED_ARRAY, &element_count) || element_count == 0 || element_count > MAX_BATCH_SIZE)
+	{
+		return false;
+	}
+
+	for (uint32_t element = 0; element < element_count; element++)
+	{
+		if (!parse_packed_payload(state, assignment_fields, &command->assignments[command->assignment_count++]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool parse_packed_command(const char *message, size_t length, struct CommandMessage *command)
+{
+	memset(command, 0, sizeof(struct CommandMessage));
+	command->id = NO_REQUEST_ID;
+
+	if (length == 0 || length > MAX_COMMAND_LENGTH)
+	{
+		return false;
+	}
+
+	struct ParserState state = { message, message + length };
+
+	const struct PayloadField *fields = NULL;
+
+	const char *deferred_payload = NULL; // precedes the type, so parsed once the fields are known
+	bool payload_parsed = false;
+
+	uint32_t member_count;
+
+	if (!read_packed_header(&state, PACKED_MAP, &member_count) || member_count == 0)
+	{
+		return false;
+	}
+
+	for (uint32_t member = 0; member < member_count; member++)
+	{
+		char key[16];
+
+		if (read_packed_string(&state, key, sizeof(key)) < 0)
+		{
+			return false;
+		}
+
+		if (strcmp(key, "type") == 0 && fields == NULL)
+		{
+			double number;
+
+			if (!read_packed_number(&state, &number) || number < 0 || number > INT8_MAX || number != (int)number || (fields = resolve_payload_fields((Command)number)) == NULL)
+			{
+				return false;
+			}
+
+			command->type = (Command)number;
+		}
+		else if (strcmp(key, "id") == 0 && command->id == NO_REQUEST_ID)
+		{
+			double number;
+
+			if (!read_packed_number(&state, &number) || !is_request_id(number))
+			{
+				return false;
+			}
+
+			command->id = (int64_t)number;
+		}
+		else if (strcmp(key, "payload") == 0 && !payload_parsed && deferred_payload == NULL)
+		{
+			if (fields != NULL)
+			{
+				payload_parsed = true;
+
+				if (!parse_packed_payload(&state, fields, command))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				deferred_payload = state.cursor;
+
+				if (!skip_packed_value(&state, 0))
+				{
+					return false;
+				}
+			}
+		}
+		else if (!skip_packed_value(&state, 0)) // unknown keys and repeated keys are ignored
+		{
+			return false;
+		}
+	}
+
+	if (fields == NULL)
+	{
+		return false;
+	}
+
+	if (deferred_payload != NULL)
+	{
+		struct ParserState payload_state = { deferred_payload, state.end };
+
+		return parse_packed_payload(&payload_state, fields, command);
+	}
+
+	if (!payload_parsed) // absent, so only valid if nothing is required
+	{
+		for (uint8_t i = 0; fields[i].key != NULL; i++)
+		{
+			if (fields[i].required)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool is_packed_command(const char *message, size_t length)
+{
+	const uint8_t first_byte = length > 0 ? (uint8_t)message[0] : 0;
+
+	return (first_byte & 0xf0) == PACKED_MAP || first_byte == 0xde || first_byte == 0xdf; // fixmap, map 16 or map 32
+}
+
+/// <summary>
+/// Finds the end of a JSON object by its brackets alone, leaving validation to parse_command.
+/// </summary>
+static bool scan_json_object(struct ParserState *state)
+{
+	uint32_t depth = 0;
+	bool in_string = false;
+
+	while (state->cursor < state->end)
+	{
+		const char character = *state->cursor++;
+
+		if (in_string)
+		{
+			if (character == '\\' && state->cursor < state->end)
+			{
+				state->cursor++;
+			}
+			else if (character == '"')
+			{
+				in_string = false;
+			}
+		}
+		else if (character == '"')
+		{
+			in_string = true;
+		}
+		else if (character == '{' || character == '[')
+		{
+			depth++;
+		}
+		else if ((character == '}' || character == ']') && --depth == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+FrameStatus frame_command(const char *buffer, size_t length, size_t *command_length)
+{
+	struct ParserState state = { buffer, buffer + length };
+
+	skip_whitespace(&state);
+
+	const size_t leading_length = state.cursor - buffer;
+	const size_t extent = length - leading_length < MAX_COMMAND_LENGTH ? length - leading_length : MAX_COMMAND_LENGTH;
+
+	state.end = state.cursor + extent;
+
+	if (extent == 0)
+	{
+		return FRAMEINCOMPLETE;
+	}
+
+	bool is_framed;
+
+	if (is_packed_command(state.cursor, extent))
+	{
+		is_framed = skip_packed_value(&state, 0);
+	}
+	else if (*state.cursor == '{')
+	{
+		is_framed = scan_json_object(&state);
+	}
+	else
+	{
+		return FRAMEMALFORMED;
+	}
+
+	if (is_framed)
+	{
+		*command_length = state.cursor - buffer;
+		return FRAMECOMPLETE;
+	}
+
+	return extent < MAX_COMMAND_LENGTH ? FRAMEINCOMPLETE : FRAMEMALFORMED; // a truncated command reads as malformed until the rest arrives
+}
+
+static const char *benchmark_commands[] = // weighted as clients issue them - mostly node changes
+{
+	"{\"type\":0,\"payload\":{\"room\":\"home\",\"node\":\"porch_light\",\"value\":40,\"nonce\":\"kz3f9q1x0a7c\"}}",
+	"{\"type\":0,\"payload\":{\"room\":\"lounge\",\"node\":\"fireplace\",\"value\":1,\"nonce\":\"kz3f9r2d8m4p\"}}",
+	"{\"type\":0,\"payload\":{\"room\":\"home\",\"node\":\"side_lighting\",\"value\":16762880,\"nonce\":\"kz3f9s0b1w6e\"}}",
+	"{\"type\":0,\"payload\":{\"room\":\"garage\",\"node\":\"entrance_light\",\"value\":60}}",
+	"{\"type\": 1, \"payload\": {\"type\": \"system\"}}",
+	"{\"type\":4,\"payload\":{\"value\":\"owner\"}}"
+};
+
+/// <summary>
+/// Extracts the same fields as parse_command from a cJSON tree, as evaluate_message did.
+/// </summary>
+static bool extract_cjson_command(const char *message, size_t length, bool in_situ, struct CommandMessage *command)
+{
+	char message_copy[MAX_COMMAND_LENGTH + 1]; // a received message is mutable
+
+	cJSON *root_object = NULL;
+
+	if (in_situ)
+	{
+		memcpy(message_copy, message, length + 1);
+		root_object = cJSON_ParseInSitu(message_copy);
+	}
+	else
+	{
+		root_object = cJSON_Parse(message);
+	}
+	cJSON *payload_object = cJSON_GetObjectItem(root_object, "payload");
+	cJSON *type_json = cJSON_GetObjectItem(root_object, "type");
+
+	bool extracted = cJSON_IsNumber(type_json);
+
+	if (extracted)
+	{
+		command->type = (Command)type_json->valueint;
+
+		const char *room = cJSON_GetStringValue(cJSON_GetObjectItem(payload_object, "room"));
+		const char *node = cJSON_GetStringValue(cJSON_GetObjectItem(payload_object, "node"));
+		const char *nonce = cJSON_GetStringValue(cJSON_GetObjectItem(payload_object, "nonce"));
+		cJSON *value_json = cJSON_GetObjectItem(payload_object, "value");
+
+		if (room != NULL && node != NULL && cJSON_IsNumber(value_json))
+		{
+			strncpy(command->room, room, sizeof(command->room) - 1);
+			strncpy(command->node, node, sizeof(command->node) - 1);
+			strncpy(command->nonce, nonce != NULL ? nonce : "", sizeof(command->nonce) - 1);
+
+			command->value = value_json->valueint;
+		}
+	}
+
+	cJSON_Delete(root_object);
+
+	return extracted;
+}
+
+static double elapsed_nanoseconds(struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+void benchmark_command_parser(unsigned int iterations)
+{
+	const size_t command_count = sizeof(benchmark_commands) / sizeof(benchmark_commands[0]);
+	size_t command_lengths[sizeof(benchmark_commands) / sizeof(benchmark_commands[0])];
+
+	for (size_t i = 0; i < command_count; i++)
+	{
+		command_lengths[i] = strlen(benchmark_commands[i]);
+	}
+
+	struct CommandMessage command;
+	struct timespec start;
+
+	unsigned int parsed_count = 0;
+	const double message_count = (double)iterations * command_count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (size_t j = 0; j < command_count; j++)
+		{
+			parsed_count += parse_command(benchmark_commands[j], command_lengths[j], &command);
+		}
+	}
+
+	const double sax_time = elapsed_nanoseconds(&start) / message_count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (size_t j = 0; j < command_count; j++)
+		{
+			memset(&command, 0, sizeof(command));
+			parsed_count += extract_cjson_command(benchmark_commands[j], command_lengths[j], false, &command);
+		}
+	}
+
+	const double heap_time = elapsed_nanoseconds(&start) / message_count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (size_t j = 0; j < command_count; j++)
+		{
+			memset(&command, 0, sizeof(command));
+
+			open_arena_scope(); // as dispatched
+			parsed_count += extract_cjson_command(benchmark_commands[j], command_lengths[j], false, &command);
+			close_arena_scope();
+		}
+	}
+
+	const double arena_time = elapsed_nanoseconds(&start) / message_count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < iterations; i++)
+	{
+		for (size_t j = 0; j < command_count; j++)
+		{
+			memset(&command, 0, sizeof(command));
+
+			open_arena_scope();
+			parsed_count += extract_cjson_command(benchmark_commands[j], command_lengths[j], true, &command);
+			close_arena_scope();
+		}
+	}
+
+	const double in_situ_time = elapsed_nanoseconds(&start) / message_count;
+
+	printf("[~] parse_command: %.0f ns/message\n", sax_time);
+	printf("[~] cJSON_Parse (heap): %.0f ns/message, %.1fx\n", heap_time, heap_time / sax_time);
+	printf("[~] cJSON_Parse (arena): %.0f ns/message, %.1fx\n", arena_time, arena_time / sax_time);
+	printf("[~] cJSON_ParseInSitu (arena): %.0f ns/message, %.1fx\n", in_situ_time, in_situ_time / sax_time);
+	printf("[~] %u of %.0f messages parsed\n", parsed_count, message_count * 4);
+}
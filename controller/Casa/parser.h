@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "command.h"
+#include "node.h"
+#include "profile.h"
+#include "replay.h"
+
+#define MAX_COMMAND_LENGTH 1024 // a single command, larger input is rejected before parsing
+#define MAX_SKIPPED_DEPTH 8 // nesting tolerated within ignored values
+#define MAX_BATCH_SIZE 16 // node assignments of a batch, about as many as fit within a command
+
+/// <summary>
+/// struct of a client command, populated by <c>parse_command</c> without allocating.
+/// </summary>
+struct CommandMessage
+{
+	Command type;
+	int64_t id; // correlation ID echoed on replies, NO_REQUEST_ID if absent
+
+	char room[32];
+	char node[32];
+	int value;
+
+	char nonce[MAX_COMMAND_NONCE + 1]; // empty if absent
+	char subtype[32]; // payload type of reports and demo actions
+	char identification[MAX_SET_SIZE]; // payload value of identifications
+	char encoding[16]; // encoding requested by identifications, empty if absent
+	char scene[32]; // payload name of scenes
+	int duration; // milliseconds of fades
+	char easing[16]; // easing curve of fades, empty if absent
+
+	struct NodeAssignment assignments[MAX_BATCH_SIZE]; // payload nodes of batches
+	uint8_t assignment_count;
+};
+
+/// <summary>
+/// Outcomes of framing the next command within received bytes.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// A whole command, to be parsed.
+	/// </summary>
+	FRAMECOMPLETE = 0,
+	/// <summary>
+	/// The start of a command, awaiting more bytes.
+	/// </summary>
+	FRAMEINCOMPLETE,
+	/// <summary>
+	/// Neither, the bytes received cannot be resynchronised and are discarded.
+	/// </summary>
+	FRAMEMALFORMED
+} FrameStatus;
+
+/// <summary>
+/// Kinds of payload value a field accepts.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// A JSON string, copied into a fixed buffer.
+	/// </summary>
+	FIELDSTRING = 0,
+	/// <summary>
+	/// A JSON number, truncated to an int.
+	/// </summary>
+	FIELDINTEGER,
+	/// <summary>
+	/// A JSON array of node assignment objects, stored into the command's assignments.
+	/// </summary>
+	FIELDASSIGNMENTS
+} FieldKind;
+
+/// <summary>
+/// struct of a payload key and where its value is stored within a <c>struct CommandMessage</c>, or within a <c>struct NodeAssignment</c> of a batch.
+/// </summary>
+struct PayloadField
+{
+	const char *key;
+	FieldKind kind;
+
+	size_t offset;
+	size_t size;
+
+	bool required;
+};
+
+/// <summary>
+/// Parses a client command in a single pass, storing only the payload fields of its command type.
+/// </summary>
+/// <param name="message">Message to parse, not necessarily null terminated.</param>
+/// <param name="length">Length of the message.</param>
+/// <param name="command">Output reference to the parsed command.</param>
+/// <returns>
+///   <c>true</c> if the message is well formed, of a known type and carries every required field.
+/// </returns>
+bool parse_command(const char *message, size_t length, struct CommandMessage *command);
+
+/// <summary>
+/// Parses a client command encoded as MessagePack, a map of the same keys and values as the JSON form, in a single pass.
+/// </summary>
+/// <param name="message">Message to parse.</param>
+/// <param name="length">Length of the message.</param>
+/// <param name="command">Output reference to the parsed command.</param>
+/// <returns>
+///   <c>true</c> if the message is well formed, of a known type and carries every required field.
+/// </returns>
+bool parse_packed_command(const char *message, size_t length, struct CommandMessage *command);
+
+/// <summary>
+/// Determines whether a command is encoded as MessagePack rather than JSON, by its first byte: a map header never begins JSON text.
+/// </summary>
+/// <param name="message">Message to inspect.</param>
+/// <param name="length">Length of the message.</param>
+/// <returns>
+///   <c>true</c> if the message begins with a MessagePack map.
+/// </returns>
+bool is_packed_command(const char *message, size_t length);
+
+/// <summary>
+/// Finds the extent of the first command within bytes received from a client, which may hold several pipelined commands or part of one.
+/// </summary>
+/// <param name="buffer">Received bytes.</param>
+/// <param name="length">Number of bytes received.</param>
+/// <param name="command_length">Output reference to the length of the command, including any whitespace preceding it.</param>
+/// <returns>Whether a whole command was found.</returns>
+FrameStatus frame_command(const char *buffer, size_t length, size_t *command_length);
+
+/// <summary>
+/// Measures parse_command against cJSON_Parse and cJSON_ParseInSitu with key lookups, over a mix of client commands.
+/// </summary>
+/// <param name="iterations">Passes over the command mix.</param>
+void benchmark_command_parser(unsigned int iterations);
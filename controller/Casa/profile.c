@@ -8,6 +8,7 @@
 #include "uthash.h"
 
 #include "profile.h"
+#include "coalesce.h"
 
 #define PROFILE_DIRECTORY "./profiles/"
 #define PROFILE_EXTENSION ".casap"
@@ -95,6 +96,30 @@ void bind_client_socket_to_profile(const char *profile_identifier, const int cli
 	}
 }
 
+void unbind_client_socket(const int client_socket_identifier)
+{
+	struct Profile *profile, *tmpProfile;
+
+	HASH_ITER(hh, profiles, profile, tmpProfile)
+	{
+		if (profile->client_socket_identifier == client_socket_identifier)
+		{
+			profile->client_socket_identifier = UNBOUND_CLIENT_SOCKET;
+		}
+	}
+}
+
+void print_admission_statistics(void)
+{
+	struct Profile *profile, *tmpProfile;
+
+	HASH_ITER(hh, profiles, profile, tmpProfile)
+	{
+		printf("[~] Profile '%s': %llu commands admitted, %llu shed\n", profile->identifier,
+			(unsigned long long)profile->admitted_count, (unsigned long long)profile->shed_count);
+	}
+}
+
 char *profile_identifier_from_directory(const char *d_name)
 {
 	const size_t ext_len = strlen(PROFILE_EXTENSION);
@@ -108,6 +133,43 @@ char *profile_identifier_from_directory(const char *d_name)
 	return file_name_extless;
 }
 
+/// <summary>
+/// Reads a whole number of a limit, defaulting it if absent or outside its range.
+/// </summary>
+static uint32_t read_rate_limit_value(const cJSON *limit_json, const char *key, uint32_t minimum, uint32_t fallback)
+{
+	const cJSON *value_json = cJSON_GetObjectItem(limit_json, key);
+
+	if (!cJSON_IsNumber(value_json))
+	{
+		return fallback;
+	}
+
+	const double value = value_json->valuedouble;
+
+	if (!(value >= minimum && value <= MAX_RATE_LIMIT) || value != (uint32_t)value) // checked before the cast, which is undefined out of range
+	{
+		printf("[!] Ignoring %s of %g, not a whole number from %u to %d\n", key, value, minimum, MAX_RATE_LIMIT);
+		return fallback;
+	}
+
+	return (uint32_t)value;
+}
+
+/// <summary>
+/// Reads a limit of a profile, as in <c>"session": { "rate": 10, "burst": 20 }</c>, defaulting what is absent.
+/// </summary>
+static struct RateLimit read_rate_limit(const cJSON *limit_json, uint32_t rate, uint32_t burst)
+{
+	struct RateLimit limit =
+	{
+		.rate = read_rate_limit_value(limit_json, "rate", 0, rate),
+		.burst = read_rate_limit_value(limit_json, "burst", 1, burst)
+	};
+
+	return limit;
+}
+
 int gather_permissions(void)
 {
 	DIR *directory;
@@ -157,15 +219,25 @@ int gather_permissions(void)
 		const char *profile_identifier = profile_identifier_from_directory(dir->d_name);
 
 		strcpy(profile->identifier, profile_identifier);
+		profile->client_socket_identifier = UNBOUND_CLIENT_SOCKET;
+		profile->permissions = NULL;
+		memset(profile->fragments, 0, sizeof(profile->fragments));
 
-		cJSON *profile_json = cJSON_Parse(profile_data);
+		cJSON *profile_json = cJSON_ParseInSitu(profile_data); // permitted node names are kept, so profile_data is too
 		cJSON *permissions = cJSON_GetObjectItem(profile_json, "permissions");
 
+		cJSON *limits = cJSON_GetObjectItem(profile_json, "rateLimit"); // optional, commands a second and in a burst
+
+		init_token_bucket(&profile->bucket, read_rate_limit(cJSON_GetObjectItem(limits, "profile"), DEFAULT_PROFILE_RATE, DEFAULT_PROFILE_BURST), monotonic_milliseconds());
+		profile->session_limit = read_rate_limit(cJSON_GetObjectItem(limits, "session"), DEFAULT_SESSION_RATE, DEFAULT_SESSION_BURST);
+		profile->admitted_count = 0;
+		profile->shed_count = 0;
+
 		cJSON *permission_json_object = NULL;
 
 		cJSON_ArrayForEach(permission_json_object, permissions)
 		{
-			struct RoomPermission *permission = malloc(sizeof(struct RoomPermission));
+			struct RoomPermission *permission = calloc(1, sizeof(struct RoomPermission)); // vacant nodes stay NULL, ending the permitted set
 
 			strcpy(permission->room_name, cJSON_GetObjectItem(permission_json_object,
 				"roomName")->valuestring);
@@ -5,8 +5,11 @@
 #include <stdbool.h>
 
 #include "uthash.h"
+#include "codec.h"
+#include "ratelimit.h"
 
 #define MAX_SET_SIZE 16
+#define UNBOUND_CLIENT_SOCKET 0 // standard input, never a client
 
 struct Profile *profiles;
 
@@ -30,6 +33,12 @@ struct Profile
 	uint8_t client_socket_identifier;
 
 	struct RoomPermission *permissions;
+	struct StructureFragment *fragments[WIRE_ENCODING_COUNT]; // rooms pre-rendered for the profile in each encoding, by room
+
+	struct TokenBucket bucket; // commands across the profile's connections
+	struct RateLimit session_limit; // commands of each connection bound to the profile
+	uint64_t admitted_count;
+	uint64_t shed_count;
 
 	UT_hash_handle hh;
 };
@@ -92,6 +101,17 @@ struct Profile *find_profile_from_client_socket(const int client_socket_identifi
 /// <param name="client_socket_identifier">Socket address.</param>
 void bind_client_socket_to_profile(const char *profile_identifier, const int client_socket_identifier);
 
+/// <summary>
+/// Clears every association with a socket address, as its client leaves.
+/// </summary>
+/// <param name="client_socket_identifier">Socket address.</param>
+void unbind_client_socket(const int client_socket_identifier);
+
+/// <summary>
+/// Prints the commands admitted and shed of every profile.
+/// </summary>
+void print_admission_statistics(void);
+
 /// <summary>
 /// Extracts the profile name from the directory target.
 /// </summary>
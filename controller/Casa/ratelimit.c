@@ -0,0 +1,44 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "ratelimit.h"
+
+#define TOKEN_SCALE 1000
+
+void init_token_bucket(struct TokenBucket *bucket, struct RateLimit limit, uint64_t now)
+{
+	bucket->limit = limit;
+	bucket->tokens = (uint64_t)limit.burst * TOKEN_SCALE;
+	bucket->refilled_at = now;
+}
+
+bool take_token(struct TokenBucket *bucket, uint64_t now)
+{
+	if (bucket->limit.rate == 0)
+	{
+		return true;
+	}
+
+	const uint64_t capacity = (uint64_t)bucket->limit.burst * TOKEN_SCALE;
+
+	if (now > bucket->refilled_at) // a thousandth of a token per millisecond for each command a second
+	{
+		bucket->tokens += (now - bucket->refilled_at) * bucket->limit.rate;
+		bucket->refilled_at = now;
+
+		if (bucket->tokens > capacity)
+		{
+			bucket->tokens = capacity;
+		}
+	}
+
+	if (bucket->tokens < TOKEN_SCALE)
+	{
+		return false;
+	}
+
+	bucket->tokens -= TOKEN_SCALE;
+
+	return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DEFAULT_SESSION_RATE 100 // commands a second a connection may sustain, enough for a dragged slider
+#define DEFAULT_SESSION_BURST 200
+#define DEFAULT_PROFILE_RATE 200 // commands a second a profile may sustain across its connections
+#define DEFAULT_PROFILE_BURST 400
+#define MAX_RATE_LIMIT 1000000 // commands a second or in a burst a profile may configure, keeping refills far from overflow
+
+/// <summary>
+/// struct of a limit on commands, as configured in a profile.
+/// </summary>
+struct RateLimit
+{
+	uint32_t rate; // tokens refilled a second, 0 if unlimited
+	uint32_t burst; // tokens held at most
+};
+
+/// <summary>
+/// struct of a token bucket, each admitted command taking a token.
+/// </summary>
+struct TokenBucket
+{
+	struct RateLimit limit;
+
+	uint64_t tokens; // in thousandths, so a millisecond refills a whole number of them
+	uint64_t refilled_at; // from monotonic_milliseconds
+};
+
+/// <summary>
+/// Fills a bucket to its burst under a limit.
+/// </summary>
+/// <param name="bucket">Bucket to initialize.</param>
+/// <param name="limit">Its limit.</param>
+/// <param name="now">Current time, from monotonic_milliseconds.</param>
+void init_token_bucket(struct TokenBucket *bucket, struct RateLimit limit, uint64_t now);
+
+/// <summary>
+/// Takes a token from a bucket, refilled for the time since it was last taken from.
+/// </summary>
+/// <param name="bucket">Bucket.</param>
+/// <param name="now">Current time, from monotonic_milliseconds.</param>
+/// <returns>
+///   <c>true</c> if a token was taken; <c>false</c> if the bucket is empty.
+/// </returns>
+bool take_token(struct TokenBucket *bucket, uint64_t now);
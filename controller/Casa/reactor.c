@@ -0,0 +1,511 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "reactor.h"
+#include "socket.h"
+#include "codec.h"
+#include "outbox.h"
+#include "coalesce.h"
+
+struct Reactor;
+
+/// <summary>
+/// struct of a client as its reactor holds it: bytes received but not yet framed, and how far the event loop lags behind it.
+/// </summary>
+struct Connection
+{
+	int client_socket;
+	struct Reactor *reactor;
+
+	char received[CONNECTION_BUFFER_SIZE];
+	size_t received_length;
+
+	atomic_uint queued_count; // commands handed over and not yet released
+	atomic_bool is_paused; // set by the reactor at MAX_QUEUED_COMMANDS, cleared by the event loop once it has caught up by half
+	bool is_reading; // watched for input, only touched by the reactor
+
+	struct TokenBucket bucket; // commands of the connection, taken before decoding so a flood is shed cheaply, only touched by the reactor
+	atomic_uint_least64_t pending_limit; // rate above burst, set by the event loop once the client identifies, 0 if unchanged
+	atomic_uint shed_count; // commands shed since the event loop last counted them
+	bool is_shedding; // its last command was shed, only touched by the reactor
+};
+
+/// <summary>
+/// struct of a reactor thread, owning the clients accepted on its listener.
+/// </summary>
+struct Reactor
+{
+	pthread_t thread;
+
+	int listen_socket;
+	int epoll_fd;
+	int resume_fd; // eventfd, signalled once a paused connection may be read again
+
+	struct Connection *connections[MAX_CLIENT_SOCKETS]; // by socket
+};
+
+/// <summary>
+/// struct of the reactors, and the queue of events they hand to the event loop.
+/// </summary>
+struct ReactorPool
+{
+	struct Reactor reactors[MAX_REACTOR_THREADS];
+	uint8_t reactor_count;
+
+	pthread_mutex_t inbound_lock;
+	struct InboundEvent *inbound_head;
+	struct InboundEvent *inbound_tail;
+	int inbound_fd; // eventfd, signalled once per run of events handed over
+};
+
+static struct ReactorPool reactor_pool =
+{
+	.inbound_lock = PTHREAD_MUTEX_INITIALIZER,
+	.inbound_fd = -1
+};
+
+/// <summary>
+/// Allocates an event of a client.
+/// </summary>
+static struct InboundEvent *create_inbound_event(InboundKind kind, struct Connection *connection)
+{
+	struct InboundEvent *event = malloc(sizeof(struct InboundEvent));
+
+	if (event != NULL)
+	{
+		event->next = NULL;
+		event->kind = kind;
+		event->client_socket = connection->client_socket;
+		event->connection = connection;
+	}
+
+	return event;
+}
+
+/// <summary>
+/// Queues a run of events for the event loop at once, and signals it.
+/// </summary>
+static void hand_over_events(struct InboundEvent *head, struct InboundEvent *tail)
+{
+	const uint64_t signal = 1;
+
+	pthread_mutex_lock(&reactor_pool.inbound_lock);
+
+	if (reactor_pool.inbound_tail != NULL)
+	{
+		reactor_pool.inbound_tail->next = head;
+	}
+	else
+	{
+		reactor_pool.inbound_head = head;
+	}
+
+	reactor_pool.inbound_tail = tail;
+
+	pthread_mutex_unlock(&reactor_pool.inbound_lock);
+
+	write(reactor_pool.inbound_fd, &signal, sizeof(signal));
+}
+
+/// <summary>
+/// Decodes a framed command into an event to hand over.
+/// </summary>
+static struct InboundEvent *decode_connection_command(struct Connection *connection, const char *message, size_t length)
+{
+	struct InboundEvent *event = create_inbound_event(INBOUNDCOMMAND, connection);
+
+	if (event != NULL && !decode_command(message, length, &event->command))
+	{
+		puts("[!] Received malformed command");
+		free(event);
+
+		return NULL;
+	}
+
+	return event;
+}
+
+/// <summary>
+/// Starts or stops watching a connection for input.
+/// </summary>
+static void watch_connection(struct Reactor *reactor, struct Connection *connection, bool is_reading)
+{
+	struct epoll_event event = { is_reading ? EPOLLIN : 0, { .ptr = connection } }; // hang-ups are reported regardless
+
+	connection->is_reading = is_reading;
+	epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, connection->client_socket, &event);
+}
+
+/// <summary>
+/// Accepts every pending client on the reactor's listener.
+/// </summary>
+static void accept_clients(struct Reactor *reactor)
+{
+	while (true)
+	{
+		const int client_socket = accept(reactor->listen_socket, NULL, NULL);
+
+		if (client_socket == -1)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				perror("[x] Acceptance failure");
+			}
+
+			return;
+		}
+
+		struct Connection *connection = client_socket < MAX_CLIENT_SOCKETS ? malloc(sizeof(struct Connection)) : NULL;
+
+		if (connection == NULL)
+		{
+			printf("[x] Client %d refused - no session\n", client_socket);
+			close(client_socket);
+
+			continue;
+		}
+
+		connection->client_socket = client_socket;
+		connection->reactor = reactor;
+		connection->received_length = 0;
+		connection->is_reading = true;
+		atomic_init(&connection->queued_count, 0);
+		atomic_init(&connection->is_paused, false);
+
+		init_token_bucket(&connection->bucket, (struct RateLimit) { DEFAULT_SESSION_RATE, DEFAULT_SESSION_BURST }, monotonic_milliseconds());
+		atomic_init(&connection->pending_limit, 0);
+		atomic_init(&connection->shed_count, 0);
+		connection->is_shedding = false;
+
+		struct InboundEvent *opened = create_inbound_event(INBOUNDOPENED, connection);
+		struct epoll_event event = { EPOLLIN, { .ptr = connection } };
+		const int send_buffer_size = CLIENT_SEND_BUFFER_SIZE;
+
+		fcntl(client_socket, F_SETFL, O_NONBLOCK); // what the socket does not take waits in the session's outbox, by priority
+		setsockopt(client_socket, SOL_SOCKET, SO_SNDBUF, &send_buffer_size, sizeof(send_buffer_size));
+
+		if (opened == NULL || epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client_socket, &event) == -1)
+		{
+			printf("[x] Client %d refused - no session\n", client_socket);
+			close(client_socket);
+			free(connection);
+			free(opened);
+
+			continue;
+		}
+
+		reactor->connections[client_socket] = connection;
+		hand_over_events(opened, opened);
+	}
+}
+
+/// <summary>
+/// Stops watching a connection that closed, handing its socket to the event loop to be closed once its commands are released.
+/// </summary>
+static void close_connection(struct Reactor *reactor, struct Connection *connection)
+{
+	struct InboundEvent *closed = create_inbound_event(INBOUNDCLOSED, connection);
+
+	epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, connection->client_socket, NULL);
+	reactor->connections[connection->client_socket] = NULL;
+
+	if (closed != NULL)
+	{
+		hand_over_events(closed, closed);
+	}
+}
+
+/// <summary>
+/// Hands over every whole command received at once, so the event loop evaluates a pipelined batch together,
+/// keeping any partial command for the next read.
+/// </summary>
+static void frame_connection_input(struct Connection *connection)
+{
+	struct InboundEvent *head = NULL, *tail = NULL;
+	unsigned int command_count = 0;
+	size_t offset = 0;
+
+	const uint64_t now = monotonic_milliseconds();
+	const uint64_t pending_limit = atomic_exchange(&connection->pending_limit, 0);
+
+	if (pending_limit != 0)
+	{
+		init_token_bucket(&connection->bucket, (struct RateLimit) { pending_limit >> 32, (uint32_t)pending_limit }, now);
+		connection->is_shedding = false;
+	}
+
+	while (offset < connection->received_length)
+	{
+		size_t command_length;
+		FrameStatus status = frame_command(connection->received + offset, connection->received_length - offset, &command_length);
+
+		if (status == FRAMEINCOMPLETE && (offset > 0 || connection->received_length < CONNECTION_BUFFER_SIZE)) // the rest fits once moved to the front
+		{
+			break;
+		}
+		else if (status != FRAMECOMPLETE) // unframeable, or a partial command that cannot fit once whole
+		{
+			printf("[!] Discarded %zu unframeable bytes from Client %d\n", connection->received_length - offset, connection->client_socket);
+
+			offset = connection->received_length;
+			break;
+		}
+
+		struct InboundEvent *event;
+
+		if (take_token(&connection->bucket, now))
+		{
+			connection->is_shedding = false;
+			event = decode_connection_command(connection, connection->received + offset, command_length);
+		}
+		else // shed undecoded, the event loop told once a run
+		{
+			atomic_fetch_add(&connection->shed_count, 1);
+			event = connection->is_shedding ? NULL : create_inbound_event(INBOUNDSHED, connection);
+			connection->is_shedding = true;
+		}
+
+		if (event != NULL)
+		{
+			if (tail != NULL)
+			{
+				tail->next = event;
+			}
+			else
+			{
+				head = event;
+			}
+
+			tail = event;
+			command_count += event->kind == INBOUNDCOMMAND; // only commands are released against the queued count
+		}
+
+		offset += command_length;
+	}
+
+	connection->received_length -= offset;
+	memmove(connection->received, connection->received + offset, connection->received_length);
+
+	if (head != NULL)
+	{
+		atomic_fetch_add(&connection->queued_count, command_count);
+		hand_over_events(head, tail);
+	}
+}
+
+/// <summary>
+/// Reads a client and hands over its commands, pausing it while too many wait on the event loop.
+/// </summary>
+static void receive_client_input(struct Reactor *reactor, struct Connection *connection)
+{
+	const int received_length = handle_read_descriptor(connection->received + connection->received_length,
+		CONNECTION_BUFFER_SIZE - connection->received_length, connection->client_socket);
+
+	if (received_length == 0 || (received_length < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) // closed, reset or shut down by the event loop
+	{
+		close_connection(reactor, connection);
+		return;
+	}
+
+	connection->received_length += received_length > 0 ? received_length : 0;
+	frame_connection_input(connection);
+
+	if (connection->is_reading && atomic_load(&connection->queued_count) >= MAX_QUEUED_COMMANDS)
+	{
+		atomic_store(&connection->is_paused, true);
+
+		if (atomic_load(&connection->queued_count) > MAX_QUEUED_COMMANDS / 2) // otherwise released since, and the event loop may have missed the pause
+		{
+			watch_connection(reactor, connection, false);
+		}
+		else
+		{
+			atomic_store(&connection->is_paused, false);
+		}
+	}
+}
+
+/// <summary>
+/// Watches again the connections the event loop has caught up with.
+/// </summary>
+static void resume_connections(struct Reactor *reactor)
+{
+	uint64_t resumed_count;
+
+	read(reactor->resume_fd, &resumed_count, sizeof(resumed_count));
+
+	for (int i = 0; i < MAX_CLIENT_SOCKETS; i++)
+	{
+		struct Connection *connection = reactor->connections[i];
+
+		if (connection != NULL && !connection->is_reading && !atomic_load(&connection->is_paused))
+		{
+			watch_connection(reactor, connection, true);
+		}
+	}
+}
+
+/// <summary>
+/// Waits on the reactor's listener and clients, accepting and reading them as they become ready.
+/// </summary>
+static void *run_reactor(void *argument)
+{
+	struct Reactor *reactor = argument;
+	struct epoll_event events[MAX_REACTOR_EVENTS];
+
+	while (true)
+	{
+		const int event_count = epoll_wait(reactor->epoll_fd, events, MAX_REACTOR_EVENTS, -1);
+
+		for (int i = 0; i < event_count; i++)
+		{
+			if (events[i].data.ptr == &reactor->listen_socket)
+			{
+				accept_clients(reactor);
+			}
+			else if (events[i].data.ptr == &reactor->resume_fd)
+			{
+				resume_connections(reactor);
+			}
+			else
+			{
+				receive_client_input(reactor, events[i].data.ptr);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/// <summary>
+/// Opens a reactor's listener and epoll instance, watching the listener and the resume descriptor.
+/// </summary>
+static bool open_reactor(struct Reactor *reactor, int server_port)
+{
+	reactor->listen_socket = start_server(server_port);
+	reactor->epoll_fd = epoll_create1(0);
+	reactor->resume_fd = eventfd(0, EFD_NONBLOCK);
+
+	struct epoll_event listen_event = { EPOLLIN, { .ptr = &reactor->listen_socket } };
+	struct epoll_event resume_event = { EPOLLIN, { .ptr = &reactor->resume_fd } };
+
+	if (reactor->listen_socket == -1 || reactor->epoll_fd == -1 || reactor->resume_fd == -1 ||
+		epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->listen_socket, &listen_event) == -1 ||
+		epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->resume_fd, &resume_event) == -1)
+	{
+		perror("[x] Reactor failure");
+		return false;
+	}
+
+	return true;
+}
+
+uint8_t start_reactors(int server_port, uint8_t count)
+{
+	if (count > MAX_REACTOR_THREADS)
+	{
+		count = MAX_REACTOR_THREADS;
+	}
+
+	if ((reactor_pool.inbound_fd = eventfd(0, EFD_NONBLOCK)) == -1)
+	{
+		perror("[x] Reactor event queue failure");
+		return 0;
+	}
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		struct Reactor *reactor = &reactor_pool.reactors[i];
+
+		if (!open_reactor(reactor, server_port) || pthread_create(&reactor->thread, NULL, run_reactor, reactor) != 0)
+		{
+			break;
+		}
+
+		pthread_detach(reactor->thread);
+		reactor_pool.reactor_count++;
+	}
+
+	return reactor_pool.reactor_count;
+}
+
+uint8_t default_reactor_count(void)
+{
+	long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return core_count < 1 ? 1 : core_count > MAX_REACTOR_THREADS ? MAX_REACTOR_THREADS : core_count;
+}
+
+int fill_reactor_descriptor(fd_set *read_fds, int fdmax)
+{
+	if (reactor_pool.inbound_fd == -1)
+	{
+		return fdmax;
+	}
+
+	FD_SET(reactor_pool.inbound_fd, read_fds);
+
+	return reactor_pool.inbound_fd > fdmax ? reactor_pool.inbound_fd : fdmax;
+}
+
+struct InboundEvent *take_inbound_events(fd_set *read_fds)
+{
+	uint64_t event_count;
+
+	if (reactor_pool.inbound_fd == -1 || !FD_ISSET(reactor_pool.inbound_fd, read_fds))
+	{
+		return NULL;
+	}
+
+	read(reactor_pool.inbound_fd, &event_count, sizeof(event_count)); // resets the count, every event queued by now is taken below
+
+	pthread_mutex_lock(&reactor_pool.inbound_lock);
+
+	struct InboundEvent *events = reactor_pool.inbound_head;
+	reactor_pool.inbound_head = reactor_pool.inbound_tail = NULL;
+
+	pthread_mutex_unlock(&reactor_pool.inbound_lock);
+
+	return events;
+}
+
+void limit_connection(struct Connection *connection, struct RateLimit limit)
+{
+	atomic_store(&connection->pending_limit, (uint64_t)limit.rate << 32 | limit.burst); // a burst is at least 1, so never 0
+}
+
+uint32_t take_shed_count(struct Connection *connection)
+{
+	return atomic_exchange(&connection->shed_count, 0);
+}
+
+void release_inbound_event(struct InboundEvent *event)
+{
+	struct Connection *connection = event->connection;
+
+	if (event->kind == INBOUNDCOMMAND && atomic_fetch_sub(&connection->queued_count, 1) - 1 <= MAX_QUEUED_COMMANDS / 2 &&
+		atomic_exchange(&connection->is_paused, false))
+	{
+		const uint64_t signal = 1;
+
+		write(connection->reactor->resume_fd, &signal, sizeof(signal));
+	}
+	else if (event->kind == INBOUNDCLOSED)
+	{
+		free(connection);
+	}
+
+	free(event);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <sys/select.h>
+
+#include "parser.h"
+#include "ratelimit.h"
+
+#define MAX_REACTOR_THREADS 8
+#define MAX_REACTOR_EVENTS 64 // readiness events taken from epoll at a time
+#define CONNECTION_BUFFER_SIZE (2 * MAX_COMMAND_LENGTH) // received bytes held while framing, at least one whole command
+#define MAX_QUEUED_COMMANDS 64 // commands of a connection waiting on the event loop before its reactor stops reading it
+
+struct Connection;
+
+/// <summary>
+/// Kinds of event a reactor hands to the event loop.
+/// </summary>
+typedef enum
+{
+	/// <summary>
+	/// A client was accepted, and needs a session.
+	/// </summary>
+	INBOUNDOPENED = 0,
+	/// <summary>
+	/// A client sent a command, framed and decoded.
+	/// </summary>
+	INBOUNDCOMMAND,
+	/// <summary>
+	/// A client started sending commands over its connection's limit, shed without being decoded.
+	/// </summary>
+	INBOUNDSHED,
+	/// <summary>
+	/// A client closed, reset or was shut down, and its socket is left to the event loop to close.
+	/// </summary>
+	INBOUNDCLOSED
+} InboundKind;
+
+/// <summary>
+/// struct of an event a reactor hands to the event loop, the only thread changing home state.
+/// Events of a client arrive in the order they happened, and its commands are released once evaluated.
+/// </summary>
+struct InboundEvent
+{
+	struct InboundEvent *next;
+
+	InboundKind kind;
+	int client_socket;
+	struct Connection *connection; // of the reactor that owns the client
+
+	struct CommandMessage command; // of INBOUNDCOMMAND
+};
+
+/// <summary>
+/// Starts reactor threads, each accepting clients on a listener of its own sharing the port, and reading them through an epoll instance of its own.
+/// </summary>
+/// <param name="server_port">Port listened on.</param>
+/// <param name="count">Reactors, up to MAX_REACTOR_THREADS.</param>
+/// <returns>Number of reactors started.</returns>
+uint8_t start_reactors(int server_port, uint8_t count);
+
+/// <summary>
+/// Determines how many reactors suit this machine, one per online core.
+/// </summary>
+/// <returns>Online cores, up to MAX_REACTOR_THREADS.</returns>
+uint8_t default_reactor_count(void);
+
+/// <summary>
+/// Adds the inbound event descriptor to a descriptor set.
+/// </summary>
+/// <param name="read_fds">Descriptor set to populate.</param>
+/// <param name="fdmax">Current highest descriptor.</param>
+/// <returns>Highest descriptor, including the inbound event descriptor.</returns>
+int fill_reactor_descriptor(fd_set *read_fds, int fdmax);
+
+/// <summary>
+/// Takes every event the reactors have handed over since last taken.
+/// </summary>
+/// <param name="read_fds">Descriptor set returned by select().</param>
+/// <returns>The events in the order they were handed over, or NULL if there are none.</returns>
+struct InboundEvent *take_inbound_events(fd_set *read_fds);
+
+/// <summary>
+/// Limits the commands of a client's connection from its next read, with a full bucket. Until then, the default session limit applies.
+/// </summary>
+/// <param name="connection">Connection of the client.</param>
+/// <param name="limit">Limit of each connection of the client's profile.</param>
+void limit_connection(struct Connection *connection, struct RateLimit limit);
+
+/// <summary>
+/// Takes the number of commands a client's reactor has shed since last taken.
+/// </summary>
+/// <param name="connection">Connection of the client.</param>
+/// <returns>Commands shed.</returns>
+uint32_t take_shed_count(struct Connection *connection);
+
+/// <summary>
+/// Releases an event once handled. A released command lets its reactor read further commands of the client,
+/// and a released closure frees what the reactor held of the client, so it must follow every command before it.
+/// </summary>
+/// <param name="event">Event to free.</param>
+void release_inbound_event(struct InboundEvent *event);
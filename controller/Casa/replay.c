@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "uthash.h"
+
+#include "replay.h"
+
+struct ReplayFilter replay_filters[2]; // current and previous generation
+uint8_t current_filter = 0;
+
+struct ReplayEntry *replay_entries = NULL; // insertion ordered, so the eldest are pruned first
+
+/// <summary>
+/// Derives the two base hashes of a key, from which every filter probe is generated (Kirsch-Mitzenmacher).
+/// </summary>
+static void hash_replay_key(const char *key, uint32_t *primary_hash, uint32_t *secondary_hash)
+{
+	uint32_t hash = 2166136261u; // FNV-1a
+
+	for (const char *c = key; *c != '\0'; c++)
+	{
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+	}
+
+	*primary_hash = hash;
+
+	hash ^= hash >> 16; // murmur3 finaliser
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+
+	*secondary_hash = hash | 1; // odd, so probes never collapse onto one bit
+}
+
+static bool test_replay_filter(struct ReplayFilter *filter, uint32_t primary_hash, uint32_t secondary_hash)
+{
+	for (uint32_t i = 0; i < REPLAY_FILTER_HASHES; i++)
+	{
+		uint32_t bit = (primary_hash + i * secondary_hash) % REPLAY_FILTER_BITS;
+
+		if ((filter->bits[bit / 8] & (1 << (bit % 8))) == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void add_to_replay_filter(struct ReplayFilter *filter, uint32_t primary_hash, uint32_t secondary_hash)
+{
+	for (uint32_t i = 0; i < REPLAY_FILTER_HASHES; i++)
+	{
+		uint32_t bit = (primary_hash + i * secondary_hash) % REPLAY_FILTER_BITS;
+
+		filter->bits[bit / 8] |= 1 << (bit % 8);
+	}
+}
+
+/// <summary>
+/// Retires the previous filter generation once the current one spans a full window, forgetting the nonces it held.
+/// </summary>
+static void rotate_replay_filters(time_t now)
+{
+	struct ReplayFilter *filter = &replay_filters[current_filter];
+
+	if (now - filter->epoch < REPLAY_WINDOW)
+	{
+		return;
+	}
+
+	struct ReplayFilter *previous_filter = &replay_filters[current_filter ^ 1];
+
+	if (now - filter->epoch >= REPLAY_WINDOW * 2) // idle for over a window, both generations have expired
+	{
+		memset(filter->bits, 0, sizeof(filter->bits));
+		filter->epoch = now - REPLAY_WINDOW;
+	}
+
+	memset(previous_filter->bits, 0, sizeof(previous_filter->bits));
+	previous_filter->epoch = now;
+	current_filter ^= 1;
+
+	struct ReplayEntry *entry, *tmpEntry;
+
+	HASH_ITER(hh, replay_entries, entry, tmpEntry) // entries expire alongside the generation they were added to
+	{
+		if (entry->timestamp >= replay_filters[current_filter ^ 1].epoch)
+		{
+			break;
+		}
+
+		HASH_DEL(replay_entries, entry);
+		free(entry);
+	}
+}
+
+bool is_replayed_command(const char *profile_identifier, const char *nonce)
+{
+	char key[MAX_REPLAY_KEY];
+	snprintf(key, sizeof(key), "%s:%s", profile_identifier, nonce);
+
+	time_t now = time(NULL);
+	rotate_replay_filters(now);
+
+	uint32_t primary_hash, secondary_hash;
+	hash_replay_key(key, &primary_hash, &secondary_hash);
+
+	if (test_replay_filter(&replay_filters[0], primary_hash, secondary_hash) ||
+		test_replay_filter(&replay_filters[1], primary_hash, secondary_hash)) // possible replay - confirm against the exact entries
+	{
+		struct ReplayEntry *entry;
+		HASH_FIND_STR(replay_entries, key, entry);
+
+		if (entry != NULL)
+		{
+			return true;
+		}
+	}
+
+	add_to_replay_filter(&replay_filters[current_filter], primary_hash, secondary_hash);
+
+	struct ReplayEntry *entry = malloc(sizeof(struct ReplayEntry));
+
+	strcpy(entry->key, key);
+	entry->timestamp = now;
+
+	HASH_ADD_STR(replay_entries, key, entry);
+
+	return false;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "uthash.h"
+
+#include "profile.h"
+
+#define REPLAY_WINDOW 300 // seconds covered by each filter generation, nonces are remembered for one to two windows
+#define REPLAY_FILTER_BITS 65536 // ~1% false positives at 6800 commands per window
+#define REPLAY_FILTER_HASHES 7
+
+#define MAX_COMMAND_NONCE 64
+#define MAX_REPLAY_KEY (MAX_SET_SIZE + 1 + MAX_COMMAND_NONCE) // profile identifier, separator and nonce
+
+/// <summary>
+/// struct of a Bloom filter generation, holding the nonces seen since its epoch.
+/// </summary>
+struct ReplayFilter
+{
+	uint8_t bits[REPLAY_FILTER_BITS / 8];
+	time_t epoch;
+};
+
+/// <summary>
+/// struct of a remembered command nonce, consulted only when the filters report a possible replay.
+/// </summary>
+struct ReplayEntry
+{
+	char key[MAX_REPLAY_KEY];
+	time_t timestamp;
+
+	UT_hash_handle hh;
+};
+
+/// <summary>
+/// Determines whether a command nonce has already been seen from a profile within the replay window, remembering it if not.
+/// </summary>
+/// <param name="profile_identifier">Identifier of the issuing profile.</param>
+/// <param name="nonce">Nonce attached to the command by the client.</param>
+/// <returns>
+///   <c>true</c> if the command is a replay and must be discarded.
+/// </returns>
+bool is_replayed_command(const char *profile_identifier, const char *nonce);
@@ -0,0 +1,717 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "replication.h"
+#include "arena.h"
+
+#include "cJSON.h"
+
+#include "block.h"
+#include "blockchain.h"
+#include "checkpoint.h"
+#include "command.h"
+#include "socket.h"
+
+struct Peer peers[MAX_PEERS];
+
+int replication_socket = -1;
+
+/// <summary>
+/// Encodes a hash as a hex digest.
+/// </summary>
+/// <param name="hash">The hash.</param>
+/// <param name="hash_digest">Destination of at least SHA256_BYTES * 2 + 1 characters.</param>
+static void encode_hash_digest(const uint8_t *hash, char *hash_digest)
+{
+	for (size_t i = 0; i < SHA256_BYTES; i++)
+	{
+		snprintf(hash_digest + (i * 2), 3, "%02x", hash[i]);
+	}
+}
+
+/// <summary>
+/// Decodes a hex digest into a hash.
+/// </summary>
+/// <param name="hash_digest">The hex digest.</param>
+/// <param name="hash">Destination of SHA256_BYTES bytes.</param>
+/// <returns><c>true</c> if the digest was well formed.</returns>
+static bool decode_hash_digest(const char *hash_digest, uint8_t *hash)
+{
+	if (hash_digest == NULL || strlen(hash_digest) != SHA256_BYTES * 2)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < SHA256_BYTES; i++)
+	{
+		unsigned int octet;
+
+		if (sscanf(hash_digest + (i * 2), "%2x", &octet) != 1)
+		{
+			return false;
+		}
+
+		hash[i] = (uint8_t)octet;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Resolves the index of the eldest sealed block still resident in memory, from which forks can be resolved.
+/// </summary>
+static uint32_t eldest_resident_index(void)
+{
+	struct Block *unsealed_block = first_unsealed_block();
+	uint32_t index = unsealed_block->index == 0 ? 0 : unsealed_block->index - 1;
+
+	for (struct Block *block = unsealed_block->prev_block; block != NULL; block = block->prev_block)
+	{
+		index = block->index;
+	}
+
+	return index;
+}
+
+static struct Peer *register_peer(int peer_socket)
+{
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (peers[i].socket == -1)
+		{
+			fcntl(peer_socket, F_SETFL, O_NONBLOCK); // a slow peer's frames wait in its outbox, rather than holding the event loop back
+
+			peers[i].socket = peer_socket;
+			peers[i].buffer = NULL;
+			peers[i].buffer_length = 0;
+
+			memset(&peers[i].outbox, 0, sizeof(struct Outbox));
+
+			return &peers[i];
+		}
+	}
+
+	close(peer_socket);
+
+	return NULL;
+}
+
+static void release_peer(struct Peer *peer)
+{
+	printf("[-] Peer %d offline\n", peer->socket);
+
+	close(peer->socket);
+	free(peer->buffer);
+	release_outbox(&peer->outbox);
+
+	peer->socket = -1;
+	peer->buffer = NULL;
+	peer->buffer_length = 0;
+}
+
+/// <summary>
+/// Sends a newline-delimited frame to a peer, queuing whatever its socket does not take, and releases a peer too far behind.
+/// </summary>
+static void write_peer_frame(struct Peer *peer, cJSON *root_object)
+{
+	char *frame = cJSON_PrintUnformatted(root_object); // never contains a raw newline
+
+	if (frame == NULL)
+	{
+		puts("[x] Peer frame could not be printed");
+		return;
+	}
+
+	const struct iovec segments[2] = { { frame, strlen(frame) }, { "\n", 1 } };
+
+	queue_outbox_frame_vector(peer->socket, &peer->outbox, PRIORITYDELTA, segments, 2);
+	cJSON_free(frame);
+
+	if (peer->outbox.queued_bytes > MAX_PEER_OUTBOX_BYTES)
+	{
+		printf("[!] Dropping peer %d - %zu bytes behind\n", peer->socket, peer->outbox.queued_bytes);
+		release_peer(peer);
+	}
+}
+
+static cJSON *build_peer_frame(const char *exchange_type, cJSON **payload_object)
+{
+	cJSON *root_object = cJSON_CreateObject();
+	*payload_object = cJSON_CreateObject();
+
+	cJSON_AddNumberToObject(root_object, "type", CMDLEDGER);
+	cJSON_AddStringToObject(*payload_object, "type", exchange_type);
+	cJSON_AddItemToObject(root_object, "payload", *payload_object);
+
+	return root_object;
+}
+
+static void emit_head(struct Peer *peer)
+{
+	char hash_digest[SHA256_BYTES * 2 + 1];
+	cJSON *payload_object;
+	cJSON *root_object = build_peer_frame("head", &payload_object);
+	struct Block *unsealed_block = first_unsealed_block();
+
+	encode_hash_digest(unsealed_block->prev_hash, hash_digest);
+
+	cJSON_AddNumberToObject(payload_object, "next", unsealed_block->index);
+	cJSON_AddStringToObject(payload_object, "hash", hash_digest);
+
+	write_peer_frame(peer, root_object);
+	cJSON_Delete(root_object);
+}
+
+static void emit_pull(struct Peer *peer, uint32_t from_index, uint32_t to_index)
+{
+	cJSON *payload_object;
+	cJSON *root_object = build_peer_frame("pull", &payload_object);
+
+	cJSON_AddNumberToObject(payload_object, "from", from_index);
+	cJSON_AddNumberToObject(payload_object, "to", to_index);
+
+	write_peer_frame(peer, root_object);
+	cJSON_Delete(root_object);
+
+	printf("[>] Pulling blocks #%u-#%u from peer %d\n", from_index, to_index, peer->socket);
+}
+
+/// <summary>
+/// Streams a range of sealed blocks to a peer, batching many blocks per frame without awaiting acknowledgement.
+/// </summary>
+static void emit_block_range(struct Peer *peer, uint32_t from_index, uint32_t to_index)
+{
+	struct Block *unsealed_block = first_unsealed_block();
+
+	if (unsealed_block->index == 0)
+	{
+		return;
+	}
+
+	if (to_index >= unsealed_block->index)
+	{
+		to_index = unsealed_block->index - 1;
+	}
+
+	struct Block *paged_block = NULL;
+
+	cJSON *root_object = NULL;
+	cJSON *block_array = NULL;
+	uint32_t batched_count = 0;
+
+	for (uint32_t index = from_index; index <= to_index && peer->socket != -1; index++)
+	{
+		struct Block *block = find_block(unsealed_block->prev_block, index);
+
+		if (block == NULL) // evicted - page the range back in
+		{
+			if (find_block(paged_block, index) == NULL)
+			{
+				destroy_blockchain(paged_block);
+				paged_block = page_in_checkpoint(index);
+			}
+
+			block = find_block(paged_block, index);
+		}
+
+		if (block == NULL)
+		{
+			break;
+		}
+
+		if (root_object == NULL)
+		{
+			cJSON *payload_object;
+
+			root_object = build_peer_frame("blocks", &payload_object);
+			block_array = cJSON_AddArrayToObject(payload_object, "value");
+		}
+
+		cJSON_AddItemToArray(block_array, build_replicated_block_json(block));
+
+		if (++batched_count == REPLICATION_BATCH_SIZE)
+		{
+			write_peer_frame(peer, root_object);
+			cJSON_Delete(root_object);
+
+			root_object = NULL;
+			batched_count = 0;
+		}
+	}
+
+	if (root_object != NULL && peer->socket != -1)
+	{
+		write_peer_frame(peer, root_object);
+	}
+
+	cJSON_Delete(root_object);
+	destroy_blockchain(paged_block);
+}
+
+/// <summary>
+/// Pushes a block to every peer but its origin.
+/// </summary>
+/// <param name="block_object">cJSON object of the block, consumed.</param>
+/// <param name="origin_peer">Peer the block was received from, if any.</param>
+static void push_block_json(cJSON *block_object, struct Peer *origin_peer)
+{
+	cJSON *payload_object;
+	cJSON *root_object = build_peer_frame("blocks", &payload_object);
+
+	cJSON_AddTrueToObject(payload_object, "pushed");
+	cJSON_AddItemToArray(cJSON_AddArrayToObject(payload_object, "value"), block_object);
+
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (peers[i].socket != -1 && &peers[i] != origin_peer)
+		{
+			write_peer_frame(&peers[i], root_object);
+		}
+	}
+
+	cJSON_Delete(root_object);
+}
+
+int start_replication(int replication_port, char *peer_addresses[], int peer_count)
+{
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		peers[i].socket = -1;
+	}
+
+	replication_socket = start_server(replication_port);
+
+	for (int i = 0; i < peer_count; i++)
+	{
+		int peer_socket = connect_to_peer(peer_addresses[i]);
+
+		if (peer_socket == -1)
+		{
+			printf("[x] Peer %s unreachable\n", peer_addresses[i]);
+			continue;
+		}
+
+		struct Peer *peer = register_peer(peer_socket);
+
+		if (peer != NULL)
+		{
+			printf("[+] Peer %s online\n", peer_addresses[i]);
+			emit_head(peer);
+		}
+	}
+
+	return replication_socket;
+}
+
+int connect_to_peer(const char *peer_address)
+{
+	char host[64];
+	const char *port_delimiter = strrchr(peer_address, ':');
+
+	if (port_delimiter == NULL || (size_t)(port_delimiter - peer_address) >= sizeof(host))
+	{
+		return -1;
+	}
+
+	memcpy(host, peer_address, port_delimiter - peer_address);
+	host[port_delimiter - peer_address] = '\0';
+
+	struct addrinfo hints;
+	struct addrinfo *result;
+
+	memset(&hints, 0, sizeof(hints));
+
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+
+	if (getaddrinfo(host, port_delimiter + 1, &hints, &result) != 0)
+	{
+		return -1;
+	}
+
+	int peer_socket = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+
+	if (peer_socket != -1 && connect(peer_socket, result->ai_addr, result->ai_addrlen) == -1)
+	{
+		close(peer_socket);
+		peer_socket = -1;
+	}
+
+	freeaddrinfo(result);
+
+	return peer_socket;
+}
+
+int fill_replication_descriptors(fd_set *read_fds, fd_set *write_fds, int fdmax)
+{
+	if (replication_socket == -1)
+	{
+		return fdmax;
+	}
+
+	FD_SET(replication_socket, read_fds);
+	fdmax = replication_socket > fdmax ? replication_socket : fdmax;
+
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (peers[i].socket != -1)
+		{
+			FD_SET(peers[i].socket, read_fds);
+			fdmax = peers[i].socket > fdmax ? peers[i].socket : fdmax;
+
+			if (is_outbox_pending(&peers[i].outbox))
+			{
+				FD_SET(peers[i].socket, write_fds);
+			}
+		}
+	}
+
+	return fdmax;
+}
+
+/// <summary>
+/// Reads from a peer socket and evaluates every complete frame received.
+/// </summary>
+static void read_peer_descriptor(struct Peer *peer)
+{
+	char chunk[4096];
+	ssize_t bytes = recv(peer->socket, chunk, sizeof(chunk), 0);
+
+	if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+	{
+		return;
+	}
+
+	if (bytes <= 0)
+	{
+		release_peer(peer);
+		return;
+	}
+
+	if (peer->buffer_length + bytes > MAX_REPLICATION_FRAME) // a frame never delimited
+	{
+		printf("[!] Dropping peer %d - frame beyond %d bytes\n", peer->socket, MAX_REPLICATION_FRAME);
+		release_peer(peer);
+
+		return;
+	}
+
+	char *buffer = realloc(peer->buffer, peer->buffer_length + bytes + 1);
+
+	if (buffer == NULL)
+	{
+		release_peer(peer); // frees the buffer still held
+		return;
+	}
+
+	peer->buffer = buffer;
+
+	memcpy(peer->buffer + peer->buffer_length, chunk, bytes);
+	peer->buffer_length += bytes;
+	peer->buffer[peer->buffer_length] = '\0';
+
+	char *frame = peer->buffer;
+	char *delimiter;
+
+	while ((delimiter = strchr(frame, '\n')) != NULL)
+	{
+		*delimiter = '\0';
+
+		open_arena_scope();
+		evaluate_peer_message(peer, frame);
+		close_arena_scope();
+
+		if (peer->socket == -1) // released while responding
+		{
+			return;
+		}
+
+		frame = delimiter + 1;
+	}
+
+	peer->buffer_length -= frame - peer->buffer;
+	memmove(peer->buffer, frame, peer->buffer_length + 1);
+}
+
+void handle_replication_descriptors(fd_set *read_fds, fd_set *write_fds)
+{
+	if (replication_socket == -1)
+	{
+		return;
+	}
+
+	if (FD_ISSET(replication_socket, read_fds))
+	{
+		int peer_socket = accept(replication_socket, NULL, NULL);
+
+		if (peer_socket == -1)
+		{
+			perror("[x] Peer acceptance failure");
+		}
+		else
+		{
+			struct Peer *peer = register_peer(peer_socket);
+
+			if (peer != NULL)
+			{
+				printf("[+] Peer %d online\n", peer_socket);
+				emit_head(peer);
+			}
+		}
+	}
+
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (peers[i].socket != -1 && FD_ISSET(peers[i].socket, write_fds))
+		{
+			flush_outbox(peers[i].socket, &peers[i].outbox);
+		}
+
+		if (peers[i].socket != -1 && FD_ISSET(peers[i].socket, read_fds))
+		{
+			read_peer_descriptor(&peers[i]);
+		}
+	}
+}
+
+void replicate_sealed_block(struct Block *block)
+{
+	if (replication_socket == -1)
+	{
+		return;
+	}
+
+	push_block_json(build_replicated_block_json(block), NULL);
+}
+
+cJSON *build_replicated_block_json(struct Block *block)
+{
+	char hash_digest[SHA256_BYTES * 2 + 1];
+	cJSON *block_object = cJSON_CreateObject();
+
+	cJSON_AddNumberToObject(block_object, "index", block->index);
+	cJSON_AddNumberToObject(block_object, "timestamp", block->timestamp);
+	cJSON_AddNumberToObject(block_object, "nonce", block->nonce);
+
+	if (block->extra_nonce != 0)
+	{
+		cJSON_AddNumberToObject(block_object, "extraNonce", block->extra_nonce);
+	}
+
+	encode_hash_digest(block->hash, hash_digest);
+	cJSON_AddStringToObject(block_object, "hash", hash_digest);
+
+	encode_hash_digest(block->prev_hash, hash_digest);
+	cJSON_AddStringToObject(block_object, "prevHash", hash_digest);
+
+	cJSON_AddItemToObject(block_object, "transactions", build_block_transactions_json(block));
+
+	return block_object;
+}
+
+/// <summary>
+/// Determines whether a number sent by a peer is a block index, so it converts to one without undefined behaviour.
+/// </summary>
+static bool is_block_index_json(const cJSON *index_json)
+{
+	return cJSON_IsNumber(index_json) && index_json->valuedouble >= 0 && index_json->valuedouble <= UINT32_MAX;
+}
+
+struct Block *parse_replicated_block_json(cJSON *block_json)
+{
+	cJSON *index_json = cJSON_GetObjectItem(block_json, "index");
+	cJSON *timestamp_json = cJSON_GetObjectItem(block_json, "timestamp");
+	cJSON *transaction_array = cJSON_GetObjectItem(block_json, "transactions");
+
+	if (!is_block_index_json(index_json) || !cJSON_IsNumber(timestamp_json) || !cJSON_IsArray(transaction_array) ||
+		cJSON_GetArraySize(transaction_array) > BLOCK_SIZE ||
+		timestamp_json->valuedouble < 1 || timestamp_json->valuedouble > INT_MAX) // the block timestamp divides its hash seed
+	{
+		return NULL;
+	}
+
+	cJSON *nonce_json = cJSON_GetObjectItem(block_json, "nonce");
+	cJSON *extra_nonce_json = cJSON_GetObjectItem(block_json, "extraNonce");
+
+	if ((cJSON_IsNumber(nonce_json) && (nonce_json->valuedouble < 0 || nonce_json->valuedouble > UINT32_MAX)) ||
+		(cJSON_IsNumber(extra_nonce_json) && (extra_nonce_json->valuedouble < 0 || extra_nonce_json->valuedouble > UINT32_MAX)))
+	{
+		return NULL;
+	}
+
+	struct Block *block = calloc(1, sizeof(struct Block));
+
+	if (block == NULL)
+	{
+		return NULL;
+	}
+
+	block->index = (uint32_t)index_json->valuedouble;
+	block->timestamp = (int)timestamp_json->valuedouble;
+
+	if (cJSON_IsNumber(nonce_json))
+	{
+		block->nonce = (uint32_t)nonce_json->valuedouble;
+	}
+
+	if (cJSON_IsNumber(extra_nonce_json))
+	{
+		block->extra_nonce = (uint32_t)extra_nonce_json->valuedouble;
+	}
+
+	if (!decode_hash_digest(cJSON_GetStringValue(cJSON_GetObjectItem(block_json, "hash")), block->hash) ||
+		!decode_hash_digest(cJSON_GetStringValue(cJSON_GetObjectItem(block_json, "prevHash")), block->prev_hash))
+	{
+		free(block);
+		return NULL;
+	}
+
+	cJSON *transaction_json = NULL;
+
+	cJSON_ArrayForEach(transaction_json, transaction_array)
+	{
+		const char *node = cJSON_GetStringValue(cJSON_GetObjectItem(transaction_json, "node"));
+		const char *room = cJSON_GetStringValue(cJSON_GetObjectItem(transaction_json, "room"));
+		const char *profile_identifier = cJSON_GetStringValue(cJSON_GetObjectItem(transaction_json, "profile"));
+
+		cJSON *value_json = cJSON_GetObjectItem(transaction_json, "value");
+		cJSON *timestamp_json = cJSON_GetObjectItem(transaction_json, "timestamp");
+
+		if (node == NULL || room == NULL || profile_identifier == NULL || !cJSON_IsNumber(value_json) || !cJSON_IsNumber(timestamp_json) ||
+			strlen(node) >= sizeof(((struct Transaction *)0)->node) || strlen(room) >= sizeof(((struct Transaction *)0)->room) ||
+			strlen(profile_identifier) >= sizeof(((struct Transaction *)0)->profile_identifier) ||
+			timestamp_json->valuedouble < 0 || timestamp_json->valuedouble > INT_MAX)
+		{
+			destroy_blockchain(block);
+			return NULL;
+		}
+
+		struct Transaction *transaction = calloc(1, sizeof(struct Transaction));
+
+		if (transaction == NULL)
+		{
+			destroy_blockchain(block);
+			return NULL;
+		}
+
+		strcpy(transaction->node, node);
+		strcpy(transaction->room, room);
+		strcpy(transaction->profile_identifier, profile_identifier);
+
+		transaction->value = value_json->valueint;
+		transaction->timestamp = (int)timestamp_json->valuedouble;
+		transaction->authorized = cJSON_IsTrue(cJSON_GetObjectItem(transaction_json, "authorized"));
+
+		cJSON *coalesced_json = cJSON_GetObjectItem(transaction_json, "coalesced");
+
+		if (cJSON_IsNumber(coalesced_json) && coalesced_json->valuedouble > 1 && coalesced_json->valuedouble <= UINT16_MAX)
+		{
+			transaction->coalesced_count = (uint16_t)coalesced_json->valuedouble;
+		}
+
+		block->transactions[block->occupied_capacity++] = transaction;
+	}
+
+	return block;
+}
+
+void evaluate_peer_message(struct Peer *peer, char *message)
+{
+	cJSON *root_object = cJSON_ParseInSitu(message); // the frame is consumed, its strings need not be copied
+	cJSON *payload_object = cJSON_GetObjectItem(root_object, "payload");
+
+	cJSON *type_json = cJSON_GetObjectItem(root_object, "type");
+	const char *exchange_type = cJSON_GetStringValue(cJSON_GetObjectItem(payload_object, "type"));
+
+	if (!cJSON_IsNumber(type_json) || (Command)type_json->valueint != CMDLEDGER || exchange_type == NULL)
+	{
+		puts("[!] Received unresolved peer exchange");
+		cJSON_Delete(root_object);
+
+		return;
+	}
+
+	if (strcmp(exchange_type, "head") == 0) // peer's chain summary - pull anything newer or divergent
+	{
+		cJSON *next_json = cJSON_GetObjectItem(payload_object, "next");
+		uint8_t hash[SHA256_BYTES];
+
+		if (is_block_index_json(next_json) && decode_hash_digest(cJSON_GetStringValue(cJSON_GetObjectItem(payload_object, "hash")), hash))
+		{
+			uint32_t next_index = (uint32_t)next_json->valuedouble;
+			struct Block *unsealed_block = first_unsealed_block();
+
+			if (next_index > unsealed_block->index ||
+				(next_index == unsealed_block->index && next_index > 0 && memcmp(hash, unsealed_block->prev_hash, SHA256_BYTES) != 0))
+			{
+				emit_pull(peer, eldest_resident_index(), next_index - 1);
+			}
+		}
+	}
+	else if (strcmp(exchange_type, "pull") == 0)
+	{
+		cJSON *from_json = cJSON_GetObjectItem(payload_object, "from");
+		cJSON *to_json = cJSON_GetObjectItem(payload_object, "to");
+
+		if (is_block_index_json(from_json) && is_block_index_json(to_json)) // otherwise ignored
+		{
+			emit_block_range(peer, (uint32_t)from_json->valuedouble, (uint32_t)to_json->valuedouble);
+		}
+	}
+	else if (strcmp(exchange_type, "blocks") == 0)
+	{
+		const bool pushed = cJSON_IsTrue(cJSON_GetObjectItem(payload_object, "pushed"));
+		cJSON *block_json = NULL;
+
+		cJSON_ArrayForEach(block_json, cJSON_GetObjectItem(payload_object, "value"))
+		{
+			struct Block *block = parse_replicated_block_json(block_json);
+
+			if (block == NULL)
+			{
+				puts("[!] Received malformed block from peer");
+				break;
+			}
+
+			const uint32_t block_index = block->index; // adopted blocks may be checkpointed and evicted immediately
+
+			switch (handle_replicated_block(block))
+			{
+			case PROPADOPTED:
+				printf("[<] Adopted block #%u from peer %d\n", block_index, peer->socket);
+				push_block_json(cJSON_Duplicate(block_json, true), peer); // relay onwards for peers not directly connected
+
+				break;
+			case PROPDETACHED:
+				if (pushed) // ranges answer pulls, so only pushes may trigger another
+				{
+					emit_pull(peer, eldest_resident_index(), block_index);
+				}
+
+				destroy_blockchain(block);
+				break;
+			default:
+				destroy_blockchain(block);
+				break;
+			}
+
+			if (peer->socket == -1)
+			{
+				break;
+			}
+		}
+	}
+
+	cJSON_Delete(root_object);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/select.h>
+
+#include "cJSON.h"
+
+#include "block.h"
+#include "outbox.h"
+
+#define MAX_PEERS 8
+
+#define REPLICATION_PORT_OFFSET 1 // peers listen beside the client port
+#define REPLICATION_BATCH_SIZE 32 // blocks pipelined per frame
+#define MAX_REPLICATION_FRAME 1048576
+#define MAX_PEER_OUTBOX_BYTES (16 * MAX_REPLICATION_FRAME) // bytes a peer may fall behind by before it is dropped
+
+/// <summary>
+/// struct of a connected peer controller, its partially received frames and the frames it has yet to take.
+/// </summary>
+struct Peer
+{
+	int socket;
+
+	char *buffer;
+	size_t buffer_length;
+
+	struct Outbox outbox; // one lane, so frames keep their order
+};
+
+/// <summary>
+/// Opens the replication listener and connects to the given peers, announcing the local chain head.
+/// </summary>
+/// <param name="replication_port">Port to accept peer controllers on.</param>
+/// <param name="peer_addresses">Peer replication addresses, as host:port.</param>
+/// <param name="peer_count">Number of peer addresses.</param>
+/// <returns>Replication listener socket.</returns>
+int start_replication(int replication_port, char *peer_addresses[], int peer_count);
+
+/// <summary>
+/// Opens a TCP connection to a peer controller.
+/// </summary>
+/// <param name="peer_address">Peer replication address, as host:port.</param>
+/// <returns>Peer socket, or -1 if unreachable.</returns>
+int connect_to_peer(const char *peer_address);
+
+/// <summary>
+/// Adds the replication listener and peer sockets to a descriptor set, and peers with frames queued to another.
+/// </summary>
+/// <param name="read_fds">Descriptor set to populate.</param>
+/// <param name="write_fds">Descriptor set to populate with peers behind.</param>
+/// <param name="fdmax">Current highest descriptor.</param>
+/// <returns>Highest descriptor, including replication sockets.</returns>
+int fill_replication_descriptors(fd_set *read_fds, fd_set *write_fds, int fdmax);
+
+/// <summary>
+/// Accepts peers, sends queued frames to writable peers and processes frames on ready replication sockets.
+/// </summary>
+/// <param name="read_fds">Descriptor set returned by select().</param>
+/// <param name="write_fds">Writable descriptor set returned by select().</param>
+void handle_replication_descriptors(fd_set *read_fds, fd_set *write_fds);
+
+/// <summary>
+/// Pushes a newly sealed block to all peers.
+/// </summary>
+/// <param name="block">The sealed block.</param>
+void replicate_sealed_block(struct Block *block);
+
+/// <summary>
+/// Builds a JSON representation of a sealed block for replication, including its hash linkage.
+/// </summary>
+/// <param name="block">The subject block.</param>
+/// <returns>cJSON object.</returns>
+cJSON *build_replicated_block_json(struct Block *block);
+
+/// <summary>
+/// Parses a replicated block.
+/// </summary>
+/// <param name="block_json">cJSON object of the block.</param>
+/// <returns>Detached block with no ancestor linked, or NULL if malformed.</returns>
+struct Block *parse_replicated_block_json(cJSON *block_json);
+
+/// <summary>
+/// Evaluates a framed message from a peer controller.
+/// </summary>
+/// <param name="peer">Originating peer.</param>
+/// <param name="message">Message to evaluate, parsed in place.</param>
+void evaluate_peer_message(struct Peer *peer, char *message);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdint.h>
 #include "uthash.h"
 
 /// <summary>
@@ -13,5 +14,21 @@ struct Room
 	uint8_t thermalGPIO;
 	struct Node *nodes;
 
+	uint32_t version; // advanced whenever a node is added or changes value
+
+	UT_hash_handle hh; // hashable
+};
+
+/// <summary>
+/// struct of a room as a profile sees it, pre-rendered up to its temperature and valid while the room's version is unchanged
+/// </summary>
+struct StructureFragment
+{
+	const struct Room *room; // key
+	uint32_t version; // room version rendered
+
+	char *bytes; // NULL if the room is inaccessible to the profile
+	size_t length;
+
 	UT_hash_handle hh; // hashable
 };
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "cJSON.h"
+#include "uthash.h"
+
+#include "scene.h"
+#include "controller.h"
+#include "blockchain.h"
+
+/// <summary>
+/// Reads a whole file into a null terminated buffer.
+/// </summary>
+/// <returns>The contents on the heap, or NULL if the file cannot be read.</returns>
+static char *read_scene_file(const char *path)
+{
+	FILE *scene_file = fopen(path, "r");
+
+	if (scene_file == NULL)
+	{
+		return NULL;
+	}
+
+	char *scene_data = NULL;
+
+	if (fseek(scene_file, 0, SEEK_END) == 0)
+	{
+		const long length = ftell(scene_file);
+
+		if (length >= 0 && fseek(scene_file, 0, SEEK_SET) == 0 && (scene_data = malloc(length + 1)) != NULL)
+		{
+			scene_data[fread(scene_data, 1, length, scene_file)] = '\0';
+		}
+	}
+
+	fclose(scene_file);
+
+	return scene_data;
+}
+
+/// <summary>
+/// Resolves the nodes of a scene from its JSON definition.
+/// </summary>
+/// <returns><c>true</c> if every node exists, once, and the scene is within bounds.</returns>
+static bool compile_scene(struct Scene *scene, cJSON *scene_json)
+{
+	cJSON *name_json = cJSON_GetObjectItem(scene_json, "name");
+	cJSON *node_array_json = cJSON_GetObjectItem(scene_json, "nodes");
+
+	if (!cJSON_IsString(name_json) || strlen(name_json->valuestring) >= sizeof(scene->name) ||
+		!cJSON_IsArray(node_array_json) || cJSON_GetArraySize(node_array_json) > MAX_SCENE_SIZE)
+	{
+		puts("[x] Skipped malformed scene");
+		return false;
+	}
+
+	strcpy(scene->name, name_json->valuestring);
+
+	cJSON *node_json = NULL;
+
+	cJSON_ArrayForEach(node_json, node_array_json)
+	{
+		cJSON *room_name_json = cJSON_GetObjectItem(node_json, "roomName");
+		cJSON *node_name_json = cJSON_GetObjectItem(node_json, "nodeName");
+		cJSON *value_json = cJSON_GetObjectItem(node_json, "value");
+
+		struct Room *room = NULL;
+		struct Node *node = NULL;
+
+		if (cJSON_IsString(room_name_json) && cJSON_IsString(node_name_json) && cJSON_IsNumber(value_json))
+		{
+			HASH_FIND_STR(rooms, room_name_json->valuestring, room);
+
+			if (room != NULL)
+			{
+				HASH_FIND_STR(room->nodes, node_name_json->valuestring, node);
+			}
+		}
+
+		if (node == NULL)
+		{
+			printf("[x] Skipped scene '%s' - unknown node\n", scene->name);
+			return false;
+		}
+
+		for (uint8_t i = 0; i < scene->target_count; i++) // a node is set once per scene
+		{
+			if (scene->nodes[i] == node)
+			{
+				printf("[x] Skipped scene '%s' - repeated node %s\n", scene->name, node->name);
+				return false;
+			}
+		}
+
+		struct NodeAssignment *target = &scene->targets[scene->target_count];
+
+		strcpy(target->room, room->name);
+		strcpy(target->node, node->name);
+		target->value = value_json->valueint;
+
+		scene->rooms[scene->target_count] = room;
+		scene->nodes[scene->target_count] = node;
+		scene->target_count++;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Grants a scene to every profile permitted all of its nodes.
+/// </summary>
+static void grant_scene(struct Scene *scene)
+{
+	struct Profile *profile, *tmpProfile;
+
+	HASH_ITER(hh, profiles, profile, tmpProfile)
+	{
+		bool is_permitted = true;
+
+		for (uint8_t i = 0; i < scene->target_count && is_permitted; i++)
+		{
+			is_permitted = is_transaction_permissible(profile, scene->targets[i].room, scene->targets[i].node);
+		}
+
+		if (is_permitted)
+		{
+			struct SceneGrant *grant = malloc(sizeof(struct SceneGrant));
+
+			grant->profile = profile;
+			HASH_ADD_PTR(scene->grants, profile, grant);
+		}
+	}
+}
+
+int compose_scenes(void)
+{
+	char *scene_data = read_scene_file(SCENE_FILE);
+
+	if (scene_data == NULL) // scenes are optional
+	{
+		return 0;
+	}
+
+	cJSON *scenes_json = cJSON_Parse(scene_data);
+	free(scene_data);
+
+	if (scenes_json == NULL)
+	{
+		return -1;
+	}
+
+	cJSON *scene_json = NULL;
+
+	cJSON_ArrayForEach(scene_json, cJSON_GetObjectItem(scenes_json, "scenes"))
+	{
+		struct Scene *scene = calloc(1, sizeof(struct Scene));
+
+		if (!compile_scene(scene, scene_json) || find_scene(scene->name) != NULL)
+		{
+			free(scene);
+			continue;
+		}
+
+		grant_scene(scene);
+
+		HASH_ADD_STR(scenes, name, scene);
+		printf("[+] Composed scene '%s' of %u nodes, granted to %u profiles\n", scene->name, scene->target_count, HASH_COUNT(scene->grants));
+	}
+
+	cJSON_Delete(scenes_json);
+
+	return 0;
+}
+
+struct Scene *find_scene(const char *name)
+{
+	struct Scene *scene;
+
+	HASH_FIND_STR(scenes, name, scene);
+
+	return scene;
+}
+
+bool is_scene_permitted(const struct Scene *scene, const struct Profile *profile)
+{
+	struct SceneGrant *grant;
+
+	HASH_FIND_PTR(scene->grants, &profile, grant);
+
+	return grant != NULL;
+}
+
+bool activate_scene(const struct Scene *scene, const struct Profile *profile)
+{
+	if (profile == NULL || !is_scene_permitted(scene, profile))
+	{
+		return false;
+	}
+
+	bool authorized[MAX_SCENE_SIZE];
+	memset(authorized, true, sizeof(authorized));
+
+	record_authorized_transaction_group(profile->identifier, scene->targets, scene->target_count, authorized);
+
+	for (uint8_t i = 0; i < scene->target_count; i++)
+	{
+		apply_value_to_resolved_node(scene->rooms[i], scene->nodes[i], scene->targets[i].value);
+	}
+
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uthash.h"
+
+#include "node.h"
+#include "room.h"
+#include "profile.h"
+
+#define SCENE_FILE "./scenes.json"
+#define MAX_SCENE_SIZE 16 // nodes a scene sets, as many as a batch
+
+struct Scene *scenes;
+
+/// <summary>
+/// struct of a profile's grant to activate a scene, its presence indicates every node of the scene is permitted.
+/// </summary>
+struct SceneGrant
+{
+	const struct Profile *profile; // key
+
+	UT_hash_handle hh;
+};
+
+/// <summary>
+/// struct of a named scene, precompiled into the nodes it sets and the profiles that may set them.
+/// </summary>
+struct Scene
+{
+	char name[32];
+
+	struct NodeAssignment targets[MAX_SCENE_SIZE]; // as recorded on the ledger
+	struct Room *rooms[MAX_SCENE_SIZE]; // resolved once, so activating needs no lookup per node
+	struct Node *nodes[MAX_SCENE_SIZE];
+	uint8_t target_count;
+
+	struct SceneGrant *grants;
+
+	UT_hash_handle hh; // hashable
+};
+
+/// <summary>
+/// Loads the scenes of the scene file, resolving their nodes and the profiles permitted each, once rooms and profiles are in place.
+/// A scene naming an unknown or repeated node is skipped.
+/// </summary>
+/// <returns>0 for success, including when no scene file exists; -1 if it cannot be parsed.</returns>
+int compose_scenes(void);
+
+/// <summary>
+/// Finds a scene by name.
+/// </summary>
+/// <param name="name">Scene name.</param>
+/// <returns>The scene, or NULL if none is named so.</returns>
+struct Scene *find_scene(const char *name);
+
+/// <summary>
+/// Determines whether a profile may activate a scene, as precomputed when scenes were composed.
+/// </summary>
+/// <param name="scene">The scene.</param>
+/// <param name="profile">The profile, possibly NULL.</param>
+/// <returns>
+///   <c>true</c> if the profile is permitted every node of the scene.
+/// </returns>
+bool is_scene_permitted(const struct Scene *scene, const struct Profile *profile);
+
+/// <summary>
+/// Records a scene's node values as one transaction group and applies them, all or none.
+/// </summary>
+/// <param name="scene">The scene.</param>
+/// <param name="profile">The activating profile.</param>
+/// <returns>
+///   <c>true</c> if applied; <c>false</c> if the profile is not permitted the scene, in which case nothing is recorded.
+/// </returns>
+bool activate_scene(const struct Scene *scene, const struct Profile *profile);
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "session.h"
+#include "command.h"
+#include "writer.h"
+#include "profile.h"
+#include "reactor.h"
+
+static struct ClientSession *client_sessions[MAX_CLIENT_SOCKETS]; // by socket, allocated while connected
+static uint64_t opened_session_count;
+
+static uint32_t heartbeat_interval = HEARTBEAT_INTERVAL * 1000; // milliseconds
+static uint32_t idle_timeout = IDLE_TIMEOUT * 1000;
+
+void set_session_liveness(uint32_t heartbeat_seconds, uint32_t idle_seconds)
+{
+	heartbeat_interval = heartbeat_seconds * 1000;
+	idle_timeout = idle_seconds * 1000;
+}
+
+/// <summary>
+/// Sends a bare confirmation, which a client acknowledges in kind.
+/// </summary>
+static void emit_heartbeat(int client_socket)
+{
+	char heartbeat[16];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, find_client_encoding(client_socket), heartbeat, sizeof(heartbeat));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDCONFIRMATION);
+	end_document_object(&writer);
+
+	size_t document_length;
+	const char *document = finish_document_writer(&writer, &document_length);
+
+	if (document != NULL)
+	{
+		queue_outbound_frame(client_socket, PRIORITYNOTIFICATION, document, document_length);
+	}
+
+	release_document_writer(&writer);
+}
+
+/// <summary>
+/// Sends a heartbeat to a client silent for an interval, or marks it idle once silent past the timeout, then schedules the next check.
+/// </summary>
+static void check_session_liveness(struct Timer *timer, void *context)
+{
+	struct ClientSession *session = context;
+
+	const uint64_t now = monotonic_milliseconds();
+	uint64_t deadline = NO_TIMER_DEADLINE;
+
+	if (idle_timeout != 0)
+	{
+		if (now - session->received_at >= idle_timeout)
+		{
+			session->is_idle = true;
+			return;
+		}
+
+		deadline = session->received_at + idle_timeout;
+	}
+
+	if (heartbeat_interval != 0)
+	{
+		uint64_t silent_since = session->heartbeat_at > session->received_at ? session->heartbeat_at : session->received_at;
+
+		if (now - silent_since >= heartbeat_interval)
+		{
+			emit_heartbeat(session->client_socket);
+			session->heartbeat_at = silent_since = now;
+		}
+
+		if (silent_since + heartbeat_interval < deadline)
+		{
+			deadline = silent_since + heartbeat_interval;
+		}
+	}
+
+	if (deadline != NO_TIMER_DEADLINE)
+	{
+		schedule_timer(timer, deadline - now, check_session_liveness, session);
+	}
+}
+
+struct ClientSession *open_client_session(int client_socket, struct Connection *connection)
+{
+	if (client_socket < 0 || client_socket >= MAX_CLIENT_SOCKETS)
+	{
+		return NULL;
+	}
+
+	close_client_session(client_socket); // a stale session of a reused descriptor
+
+	struct ClientSession *session = malloc(sizeof(struct ClientSession));
+
+	if (session != NULL)
+	{
+		session->inbox_head = session->inbox_tail = NULL;
+		session->in_flight_count = 0;
+		session->task_count = 0;
+		session->is_backlogged = false;
+		session->coalescer.write_count = 0;
+		session->coalescer.timer.is_scheduled = false;
+
+		session->client_socket = client_socket;
+		session->connection = connection;
+		session->serial = ++opened_session_count;
+		session->received_at = monotonic_milliseconds();
+		session->heartbeat_at = 0;
+		session->liveness_timer.is_scheduled = false;
+		session->is_idle = false;
+
+		memset(&session->outbox, 0, sizeof(struct Outbox));
+
+		session->is_shedding = false;
+
+		check_session_liveness(&session->liveness_timer, session);
+	}
+
+	client_sessions[client_socket] = session;
+
+	return session;
+}
+
+struct ClientSession *find_client_session(int client_socket)
+{
+	if (client_socket < 0 || client_socket >= MAX_CLIENT_SOCKETS)
+	{
+		return NULL;
+	}
+
+	return client_sessions[client_socket];
+}
+
+void queue_session_command(struct ClientSession *session, struct InboundEvent *event)
+{
+	event->next = NULL;
+
+	if (session->inbox_tail != NULL)
+	{
+		session->inbox_tail->next = event;
+	}
+	else
+	{
+		session->inbox_head = event;
+	}
+
+	session->inbox_tail = event;
+}
+
+struct InboundEvent *take_session_command(struct ClientSession *session)
+{
+	struct InboundEvent *event = session->inbox_head;
+
+	if (event != NULL)
+	{
+		session->inbox_head = event->next;
+
+		if (session->inbox_head == NULL)
+		{
+			session->inbox_tail = NULL;
+		}
+	}
+
+	return event;
+}
+
+void touch_client_session(struct ClientSession *session, uint64_t now)
+{
+	session->received_at = now; // the liveness timer finds the new deadline when it next fires, rather than moving on every read
+}
+
+/// <summary>
+/// Tells a client its commands are being discarded, until it slows down.
+/// </summary>
+static void emit_throttle_notification(int client_socket)
+{
+	char notification[64];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, find_client_encoding(client_socket), notification, sizeof(notification));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDNOTIFICATION);
+
+	write_document_key(&writer, "payload");
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_string(&writer, "throttled");
+	write_document_key(&writer, "value");
+	write_document_bool(&writer, true);
+	end_document_object(&writer);
+	end_document_object(&writer);
+
+	size_t document_length;
+	const char *document = finish_document_writer(&writer, &document_length);
+
+	if (document != NULL)
+	{
+		queue_outbound_frame(client_socket, PRIORITYNOTIFICATION, document, document_length);
+	}
+
+	release_document_writer(&writer);
+}
+
+/// <summary>
+/// Counts against a client's profile the commands its reactor has shed since last counted.
+/// </summary>
+static void count_shed_commands(struct ClientSession *session, struct Profile *profile)
+{
+	const uint32_t shed_count = take_shed_count(session->connection);
+
+	if (profile != NULL)
+	{
+		profile->shed_count += shed_count;
+	}
+}
+
+void shed_client_commands(struct ClientSession *session)
+{
+	count_shed_commands(session, find_profile_from_client_socket(session->client_socket));
+
+	printf("[!] Shedding commands from Client %d - over its rate limit\n", session->client_socket);
+	emit_throttle_notification(session->client_socket); // its reactor hands over a run only once
+}
+
+bool admit_client_command(struct ClientSession *session, uint64_t now)
+{
+	struct Profile *profile = find_profile_from_client_socket(session->client_socket);
+	const bool is_admitted = profile == NULL || take_token(&profile->bucket, now);
+
+	count_shed_commands(session, profile);
+
+	if (profile != NULL && is_admitted)
+	{
+		profile->admitted_count++;
+	}
+	else if (profile != NULL)
+	{
+		profile->shed_count++;
+	}
+
+	if (!is_admitted && !session->is_shedding) // once a run, lest the notices flood the client in turn
+	{
+		printf("[!] Shedding commands from Client %d - over its rate limit\n", session->client_socket);
+		emit_throttle_notification(session->client_socket);
+	}
+
+	session->is_shedding = !is_admitted;
+
+	return is_admitted;
+}
+
+void close_client_session(int client_socket)
+{
+	if (client_socket < 0 || client_socket >= MAX_CLIENT_SOCKETS)
+	{
+		return;
+	}
+
+	if (client_sessions[client_socket] != NULL) // no settling is due once gone
+	{
+		struct InboundEvent *event;
+
+		cancel_timer(&client_sessions[client_socket]->coalescer.timer);
+		cancel_timer(&client_sessions[client_socket]->liveness_timer);
+		release_outbox(&client_sessions[client_socket]->outbox);
+
+		while ((event = take_session_command(client_sessions[client_socket])) != NULL)
+		{
+			release_inbound_event(event);
+		}
+	}
+
+	free(client_sessions[client_socket]);
+	client_sessions[client_socket] = NULL;
+}
+
+bool defer_command(struct ClientSession *session, const struct CommandMessage *command)
+{
+	if (session->in_flight_count == MAX_IN_FLIGHT_COMMANDS)
+	{
+		return false;
+	}
+
+	session->in_flight[session->in_flight_count++] = *command;
+
+	return true;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "codec.h"
+#include "parser.h"
+#include "coalesce.h"
+#include "timer.h"
+#include "outbox.h"
+
+#define MAX_IN_FLIGHT_COMMANDS 8 // deferred commands and worker tasks a client may have outstanding, further input waits until they complete
+#define HEARTBEAT_INTERVAL 30 // default seconds of silence before a client is sent a heartbeat, which it answers with any command
+#define IDLE_TIMEOUT 90 // default seconds of silence before a client is evicted, as a connection left half-open by a roaming phone
+
+struct InboundEvent;
+struct Connection;
+
+/// <summary>
+/// struct of a connected client's pipeline: commands its reactor has decoded but not yet evaluated, and commands accepted but not yet completed.
+/// </summary>
+struct ClientSession
+{
+	int client_socket;
+	struct Connection *connection; // held by its reactor, which sheds commands over the connection's limit before decoding them
+	uint64_t serial; // distinguishes it from later sessions of the same descriptor, for replies completed off the event loop
+
+	struct InboundEvent *inbox_head; // commands handed over by its reactor, in the order received
+	struct InboundEvent *inbox_tail;
+
+	struct CommandMessage in_flight[MAX_IN_FLIGHT_COMMANDS]; // slow commands carrying an ID, completed after the faster ones received with them
+	uint8_t in_flight_count;
+
+	uint8_t task_count; // reports and dumps handed to the worker pool and not yet completed, counted against the in-flight limit
+
+	bool is_backlogged; // evaluation stopped at the in-flight limit, commands remain in its inbox
+
+	struct WriteCoalescer coalescer; // node writes received in quick succession, recorded once settled
+
+	uint64_t received_at; // last input, from monotonic_milliseconds
+	uint64_t heartbeat_at; // last heartbeat sent, 0 if none
+	struct Timer liveness_timer; // due at the next heartbeat or eviction
+	bool is_idle; // silent past the idle timeout, to be shut down by the event loop
+
+	struct Outbox outbox; // messages the socket has yet to take
+
+	bool is_shedding; // its last command was shed over its profile's limit, and it has been told
+};
+
+/// <summary>
+/// Sets how long a client may be silent before it is sent a heartbeat, and before it is evicted, for sessions opened from now on.
+/// </summary>
+/// <param name="heartbeat_interval">Seconds, 0 disabling heartbeats.</param>
+/// <param name="idle_timeout">Seconds, 0 disabling eviction.</param>
+void set_session_liveness(uint32_t heartbeat_interval, uint32_t idle_timeout);
+
+/// <summary>
+/// Opens the session of a newly accepted client socket.
+/// </summary>
+/// <param name="client_socket">Client socket.</param>
+/// <param name="connection">Connection of the client, held by its reactor.</param>
+/// <returns>The session, or NULL if the socket is out of range or memory is exhausted.</returns>
+struct ClientSession *open_client_session(int client_socket, struct Connection *connection);
+
+/// <summary>
+/// Finds the session of a client socket.
+/// </summary>
+/// <param name="client_socket">Client socket.</param>
+/// <returns>The session, or NULL if none is open.</returns>
+struct ClientSession *find_client_session(int client_socket);
+
+/// <summary>
+/// Queues a command a client's reactor handed over, to be evaluated as its in-flight limit allows.
+/// </summary>
+/// <param name="session">Session of the client.</param>
+/// <param name="event">Event of the command, released once evaluated.</param>
+void queue_session_command(struct ClientSession *session, struct InboundEvent *event);
+
+/// <summary>
+/// Takes the eldest command queued to a client.
+/// </summary>
+/// <param name="session">Session of the client.</param>
+/// <returns>Event of the command, to be released once evaluated, or NULL if none is queued.</returns>
+struct InboundEvent *take_session_command(struct ClientSession *session);
+
+/// <summary>
+/// Records input from a client, deferring its next heartbeat and eviction.
+/// </summary>
+/// <param name="session">Session of the client.</param>
+/// <param name="now">Current time, from monotonic_milliseconds.</param>
+void touch_client_session(struct ClientSession *session, uint64_t now);
+
+/// <summary>
+/// Tells a client its commands are being shed over its connection's limit, once its reactor starts shedding them,
+/// and counts those shed so far against its profile.
+/// </summary>
+/// <param name="session">Session of the client.</param>
+void shed_client_commands(struct ClientSession *session);
+
+/// <summary>
+/// Admits a command its reactor passed if its profile's bucket holds a token, before it is evaluated.
+/// A client is notified once as it starts being shed, and its profile counts commands admitted and shed.
+/// </summary>
+/// <param name="session">Session of the issuing client.</param>
+/// <param name="now">Current time, from monotonic_milliseconds.</param>
+/// <returns>
+///   <c>true</c> if admitted; <c>false</c> if the command is to be discarded.
+/// </returns>
+bool admit_client_command(struct ClientSession *session, uint64_t now);
+
+/// <summary>
+/// Closes the session of a client socket, discarding anything still queued or in flight.
+/// </summary>
+/// <param name="client_socket">Client socket.</param>
+void close_client_session(int client_socket);
+
+/// <summary>
+/// Defers a command until the commands received with it have been evaluated.
+/// </summary>
+/// <param name="session">Session of the issuing client.</param>
+/// <param name="command">Command to defer, copied.</param>
+/// <returns>
+///   <c>true</c> if deferred; <c>false</c> if the in-flight limit is reached.
+/// </returns>
+bool defer_command(struct ClientSession *session, const struct CommandMessage *command);
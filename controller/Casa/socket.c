@@ -11,16 +11,17 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <limits.h>
 
-#define BUFFER_SIZE 1024
+#ifndef IOV_MAX
+#define IOV_MAX 1024 // the Linux limit, only declared by limits.h under _XOPEN_SOURCE
+#endif
 
-int handle_read_descriptor(char **message, int readfd)
+int handle_read_descriptor(char *buffer, size_t capacity, int readfd)
 {
-	*message = (char *)malloc(BUFFER_SIZE * sizeof(char));
-	memset(*message, 0, BUFFER_SIZE);
-
 	int bytes = 0;
-	bytes = recv(readfd, *message, BUFFER_SIZE, 0);
+	bytes = recv(readfd, buffer, capacity, 0);
 
 	if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
 	{
@@ -30,16 +31,22 @@ int handle_read_descriptor(char **message, int readfd)
 	return bytes;
 }
 
-void handle_write_descriptor(const char *message, int client_socket)
+void handle_write_descriptor(const char *message, size_t length, int client_socket)
+{
+	send(client_socket, message, length, MSG_NOSIGNAL); // a client gone without a word fails the write, rather than raising SIGPIPE
+}
+
+void handle_write_descriptor_vector(const struct iovec *segments, int count, int client_socket)
 {
-	int buffer_length = strlen(message);
-	char buffer[buffer_length];
-	buffer[0] = '\0';
+	for (int i = 0; i < count; i += IOV_MAX) // sendmsg takes at most IOV_MAX segments a call
+	{
+		struct msghdr message = { 0 };
 
-	memset(buffer, 0, sizeof(buffer));
+		message.msg_iov = (struct iovec *)(segments + i);
+		message.msg_iovlen = count - i < IOV_MAX ? count - i : IOV_MAX;
 
-	sprintf(buffer, "%s", message);
-	send(client_socket, &buffer, buffer_length, 0);
+		sendmsg(client_socket, &message, MSG_NOSIGNAL); // as writev, without raising SIGPIPE
+	}
 }
 
 int start_server(int server_port)
@@ -47,6 +54,7 @@ int start_server(int server_port)
 	struct sockaddr_in server_addrin;
 
 	const char *socket_optval = "yes"; 
+	const int reuse_port = 1;
 	int server_socket;
 
 	memset(&server_addrin, 0, sizeof(server_addrin));
@@ -58,6 +66,7 @@ int start_server(int server_port)
 	server_socket = socket(AF_INET, SOCK_STREAM, 0);
 
 	setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, (char *)&socket_optval, sizeof(socket_optval));
+	setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &reuse_port, sizeof(reuse_port)); // every reactor listens on the port, the kernel spreading clients between them
 	fcntl(server_socket, F_SETFL, O_NONBLOCK);
 
 	if (bind(server_socket, (struct sockaddr *)&server_addrin, sizeof(server_addrin)) == -1)
@@ -65,7 +74,7 @@ int start_server(int server_port)
 		perror("bind() failed");
 	}
 
-	listen(server_socket, 1);
+	listen(server_socket, SOMAXCONN); // a burst of reconnecting clients is queued rather than refused
 
 	printf("[!] Listening on port %d\n", ntohs(server_addrin.sin_port));
 
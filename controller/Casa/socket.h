@@ -1,22 +1,35 @@
 #pragma once
 
+#include <stddef.h>
+#include <sys/uio.h>
+
 /// <summary>
 /// Handles the reading of a socket's file descriptor
 /// </summary>
-/// <param name="message">Output eference to a message buffer.</param>
+/// <param name="buffer">Buffer to append the received bytes to.</param>
+/// <param name="capacity">Free space in the buffer.</param>
 /// <param name="readfd">File descriptor.</param>
-/// <returns>Buffer size of message.</returns>
-int handle_read_descriptor(char **message, int readfd);
+/// <returns>Number of bytes received, 0 if the peer closed, negative on error.</returns>
+int handle_read_descriptor(char *buffer, size_t capacity, int readfd);
 
 /// <summary>
 /// Writes a given message to a socket file descriptor
 /// </summary>
 /// <param name="message">Message to write.</param>
+/// <param name="length">Length of the message, which may hold null bytes if binary.</param>
+/// <param name="client_socket">Destination socket.</param>
+void handle_write_descriptor(const char *message, size_t length, int target_socket);
+
+/// <summary>
+/// Writes a message assembled from segments to a socket file descriptor, without copying them together.
+/// </summary>
+/// <param name="segments">Segments of the message, in order.</param>
+/// <param name="count">Number of segments.</param>
 /// <param name="client_socket">Destination socket.</param>
-void handle_write_descriptor(const char *message, int target_socket);
+void handle_write_descriptor_vector(const struct iovec *segments, int count, int client_socket);
 
 /// <summary>
-/// Opens a TCP socket through a given port.
+/// Opens a non-blocking TCP listener through a given port, which other listeners may share.
 /// </summary>
 /// <param name="server_port">Port.</param>
 /// <returns>Server socket identifier.</returns>
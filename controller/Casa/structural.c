@@ -0,0 +1,266 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "structural.h"
+
+/// <summary>
+/// struct of the per-character masks of a block, bit n describing byte n.
+/// </summary>
+struct BlockMasks
+{
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t whitespace;
+	uint64_t operator;
+};
+
+#if defined(__AVX2__)
+
+static void classify_block(const uint8_t *block, struct BlockMasks *masks)
+{
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i case_bit = _mm256_set1_epi8(0x20);
+
+	memset(masks, 0, sizeof(struct BlockMasks));
+
+	for (uint8_t i = 0; i < STRUCTURAL_BLOCK_SIZE; i += 32)
+	{
+		const __m256i bytes = _mm256_loadu_si256((const __m256i *)(block + i));
+		const __m256i folded = _mm256_or_si256(bytes, case_bit); // '[' and ']' fold onto '{' and '}'
+
+		const __m256i operators = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(','))));
+
+		masks->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quote)) << i;
+		masks->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, backslash)) << i;
+		masks->whitespace |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(bytes, space), bytes)) << i;
+		masks->operator |= (uint64_t)(uint32_t)_mm256_movemask_epi8(operators) << i;
+	}
+}
+
+#elif defined(__SSE2__)
+
+static void classify_block(const uint8_t *block, struct BlockMasks *masks)
+{
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i case_bit = _mm_set1_epi8(0x20);
+
+	memset(masks, 0, sizeof(struct BlockMasks));
+
+	for (uint8_t i = 0; i < STRUCTURAL_BLOCK_SIZE; i += 16)
+	{
+		const __m128i bytes = _mm_loadu_si128((const __m128i *)(block + i));
+		const __m128i folded = _mm_or_si128(bytes, case_bit); // '[' and ']' fold onto '{' and '}'
+
+		const __m128i operators = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+			_mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(':')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(','))));
+
+		masks->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quote)) << i;
+		masks->backslash |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, backslash)) << i;
+		masks->whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(bytes, space), bytes)) << i;
+		masks->operator |= (uint64_t)(uint16_t)_mm_movemask_epi8(operators) << i;
+	}
+}
+
+#elif defined(__ARM_NEON)
+
+/// <summary>
+/// Packs the comparison result of 16 bytes into a 16 bit mask, as NEON has no movemask. Pairwise adds keep it ARMv7 compatible.
+/// </summary>
+static uint64_t pack_neon_mask(uint8x16_t comparison)
+{
+	static const uint8_t bit_weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+
+	const uint8x16_t weighted = vandq_u8(comparison, vld1q_u8(bit_weights));
+
+	uint8x8_t sum = vpadd_u8(vget_low_u8(weighted), vget_high_u8(weighted));
+	sum = vpadd_u8(sum, sum);
+	sum = vpadd_u8(sum, sum); // low byte mask in lane 0, high byte mask in lane 1
+
+	return vget_lane_u16(vreinterpret_u16_u8(sum), 0);
+}
+
+static void classify_block(const uint8_t *block, struct BlockMasks *masks)
+{
+	memset(masks, 0, sizeof(struct BlockMasks));
+
+	for (uint8_t i = 0; i < STRUCTURAL_BLOCK_SIZE; i += 16)
+	{
+		const uint8x16_t bytes = vld1q_u8(block + i);
+		const uint8x16_t folded = vorrq_u8(bytes, vdupq_n_u8(0x20)); // '[' and ']' fold onto '{' and '}'
+
+		const uint8x16_t operators = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')), vceqq_u8(folded, vdupq_n_u8('}'))),
+			vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(':')), vceqq_u8(bytes, vdupq_n_u8(','))));
+
+		masks->quote |= pack_neon_mask(vceqq_u8(bytes, vdupq_n_u8('"'))) << i;
+		masks->backslash |= pack_neon_mask(vceqq_u8(bytes, vdupq_n_u8('\\'))) << i;
+		masks->whitespace |= pack_neon_mask(vcleq_u8(bytes, vdupq_n_u8(' '))) << i;
+		masks->operator |= pack_neon_mask(operators) << i;
+	}
+}
+#else
+
+static void classify_block(const uint8_t *block, struct BlockMasks *masks)
+{
+	memset(masks, 0, sizeof(struct BlockMasks));
+
+	for (uint8_t i = 0; i < STRUCTURAL_BLOCK_SIZE; i++)
+	{
+		const uint64_t bit = (uint64_t)1 << i;
+
+		switch (block[i])
+		{
+		case '"': masks->quote |= bit; break;
+		case '\\': masks->backslash |= bit; break;
+		case '{': case '}': case '[': case ']': case ':': case ',': masks->operator |= bit; break;
+		default:
+			if (block[i] <= ' ')
+			{
+				masks->whitespace |= bit;
+			}
+		}
+	}
+}
+
+#endif
+
+/// <summary>
+/// Resolves which characters are escaped, by the parity of the backslash run preceding them.
+/// </summary>
+/// <param name="backslash">Backslash mask of the block.</param>
+/// <param name="escape_carry">Whether the first character of the block is escaped, updated for the next block.</param>
+static uint64_t find_escaped_characters(uint64_t backslash, uint64_t *escape_carry)
+{
+	const uint64_t even_bits = 0x5555555555555555ULL;
+
+	backslash &= ~*escape_carry; // an escaped backslash escapes nothing
+
+	const uint64_t follows_escape = (backslash << 1) | *escape_carry;
+	const uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+
+	uint64_t sequences_starting_on_even_bits;
+	*escape_carry = __builtin_add_overflow(odd_sequence_starts, backslash, &sequences_starting_on_even_bits);
+
+	const uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+
+	return (even_bits ^ invert_mask) & follows_escape;
+}
+
+static uint64_t prefix_xor(uint64_t bits)
+{
+	bits ^= bits << 1;
+	bits ^= bits << 2;
+	bits ^= bits << 4;
+	bits ^= bits << 8;
+	bits ^= bits << 16;
+	bits ^= bits << 32;
+
+	return bits;
+}
+
+/// <summary>
+/// Classifies blocks until the window of positions is full, discarding the positions already passed.
+/// </summary>
+static void index_window(struct StructuralIndex *index)
+{
+	index->count = 0;
+	index->cursor = 0;
+
+	while (index->indexed < index->length && index->count + STRUCTURAL_BLOCK_SIZE <= STRUCTURAL_WINDOW_SIZE)
+	{
+		const size_t offset = index->indexed;
+		const size_t remaining = index->length - offset;
+
+		struct BlockMasks masks;
+
+		if (remaining >= STRUCTURAL_BLOCK_SIZE)
+		{
+			classify_block(index->json + offset, &masks);
+		}
+		else // pad the final block with whitespace
+		{
+			uint8_t block[STRUCTURAL_BLOCK_SIZE];
+
+			memset(block, ' ', sizeof(block));
+			memcpy(block, index->json + offset, remaining);
+
+			classify_block(block, &masks);
+		}
+
+		const uint64_t quote = masks.quote & ~find_escaped_characters(masks.backslash, &index->escape_carry);
+		const uint64_t in_string = prefix_xor(quote) ^ index->string_carry; // opening quote inclusive, closing quote exclusive
+
+		index->string_carry = (uint64_t)((int64_t)in_string >> 63);
+
+		const uint64_t scalar = ~(masks.whitespace | masks.operator | quote);
+		const uint64_t scalar_start = scalar & ~((scalar << 1) | index->scalar_carry);
+
+		index->scalar_carry = scalar >> 63;
+
+		uint64_t structural = ((masks.operator | scalar_start) & ~in_string) | quote;
+
+		if (remaining < STRUCTURAL_BLOCK_SIZE)
+		{
+			structural &= ((uint64_t)1 << remaining) - 1;
+		}
+
+		while (structural != 0)
+		{
+			index->positions[index->count++] = (uint32_t)(offset + __builtin_ctzll(structural));
+			structural &= structural - 1;
+		}
+
+		index->indexed += remaining < STRUCTURAL_BLOCK_SIZE ? remaining : STRUCTURAL_BLOCK_SIZE;
+	}
+}
+
+void init_structural_index(struct StructuralIndex *index, const uint8_t *json, size_t length)
+{
+	index->json = json;
+	index->length = length;
+	index->indexed = 0;
+
+	index->escape_carry = 0;
+	index->string_carry = 0;
+	index->scalar_carry = 0;
+
+	index->count = 0;
+	index->cursor = 0;
+}
+
+size_t next_structural_position(struct StructuralIndex *index, size_t offset)
+{
+	while (true)
+	{
+		while (index->cursor < index->count)
+		{
+			if (index->positions[index->cursor] >= offset)
+			{
+				return index->positions[index->cursor];
+			}
+
+			index->cursor++;
+		}
+
+		if (index->indexed >= index->length)
+		{
+			return index->length;
+		}
+
+		index_window(index);
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define STRUCTURAL_INDEX_THRESHOLD 512 // smaller inputs are parsed byte by byte, indexing would not pay off
+#define STRUCTURAL_BLOCK_SIZE 64 // bytes classified per step, one bit each
+#define STRUCTURAL_WINDOW_SIZE 1024 // positions indexed ahead of the parser
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(__ARM_NEON)
+#define STRUCTURAL_INDEX_VECTORIZED 1
+#else
+#define STRUCTURAL_INDEX_VECTORIZED 0 // scalar classification is slower than parsing byte by byte
+#endif
+
+/// <summary>
+/// struct of the structural index of a JSON text, built a window at a time as a parser moves through it:
+/// unescaped quotes, the characters {}[]:, outside strings, and the first character of every scalar outside strings.
+/// Any other byte outside a string is whitespace (any byte up to 0x20), so a parser standing on whitespace may jump directly to the next indexed position,
+/// and a parser standing on an opening quote may jump directly to the closing one.
+/// </summary>
+struct StructuralIndex
+{
+	const uint8_t *json;
+	size_t length;
+	size_t indexed; // bytes classified so far
+
+	uint64_t escape_carry; // whether the next block starts escaped
+	uint64_t string_carry; // all ones while a string spans the block boundary
+	uint64_t scalar_carry; // whether the previous block ended within a scalar
+
+	uint32_t positions[STRUCTURAL_WINDOW_SIZE];
+	size_t count;
+	size_t cursor;
+};
+
+/// <summary>
+/// Initializes the structural index of a JSON text, classified lazily by <c>next_structural_position</c>.
+/// </summary>
+/// <param name="index">Index to initialize.</param>
+/// <param name="json">The JSON text, of at most UINT32_MAX bytes.</param>
+/// <param name="length">Length of the text.</param>
+void init_structural_index(struct StructuralIndex *index, const uint8_t *json, size_t length);
+
+/// <summary>
+/// Finds the first indexed position at or after an offset. Offsets must not decrease between calls.
+/// Bytes are classified a block at a time with AVX2, SSE2 or NEON where available, and scalar code otherwise.
+/// </summary>
+/// <param name="index">Index to search.</param>
+/// <param name="offset">Offset to search from.</param>
+/// <returns>The position, or the length of the text if there is none.</returns>
+size_t next_structural_position(struct StructuralIndex *index, size_t offset);
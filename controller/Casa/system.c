@@ -9,33 +9,55 @@
 
 #include "system.h"
 
-#include "cJSON.h"
+#include "writer.h"
 
 #include "command.h"
-#include "socket.h"
+#include "outbox.h"
 
-cJSON *generate_system_stat_object(const char *key, int value, int upper_bound, StatSuffix suffix)
+void write_system_stat_object(struct DocumentWriter *writer, const char *key, int value, int upper_bound, StatSuffix suffix)
 {
-	cJSON *stat_object = cJSON_CreateObject();
-
-	cJSON_AddStringToObject(stat_object, "name", key);
-	cJSON_AddNumberToObject(stat_object, "value", value);
-	cJSON_AddNumberToObject(stat_object, "ubound", upper_bound);
-	cJSON_AddNumberToObject(stat_object, "suffix", suffix);
-	
-	return stat_object;
+	begin_document_object(writer);
+
+	write_document_key(writer, "name");
+	write_document_string(writer, key);
+	write_document_key(writer, "value");
+	write_document_integer(writer, value);
+	write_document_key(writer, "ubound");
+	write_document_integer(writer, upper_bound);
+	write_document_key(writer, "suffix");
+	write_document_integer(writer, suffix);
+
+	end_document_object(writer);
 }
 
 int probe_thermal_zone_temperature(void)
 {
-	int temperature;
+	int temperature = 0;
+	FILE *thermal_file = fopen("/sys/class/thermal/thermal_zone0/temp", "r");
 
-	if (fscanf(fopen("/sys/class/thermal/thermal_zone0/temp", "r"), "%d", &temperature) == 0)
+	if (thermal_file == NULL)
 	{
-		return temperature / 1000;
+		return 0;
 	}
-	
-	return 0;
+
+	if (fscanf(thermal_file, "%d", &temperature) != 1)
+	{
+		temperature = 0;
+	}
+
+	fclose(thermal_file);
+
+	return temperature / 1000;
+}
+
+void probe_system_stats(struct SystemStats *stats)
+{
+	struct sysinfo info;
+	sysinfo(&info);
+
+	stats->uptime = info.uptime;
+	stats->temperature = probe_thermal_zone_temperature();
+	stats->usage = ((double)(info.totalram - info.freeram) / (double)info.totalram) * 100;
 }
 
 const char *retrieve_local_machine_address(void)
@@ -64,26 +86,46 @@ const char *retrieve_local_machine_address(void)
 	return buffer;
 }
 
-void emit_system_report_json(int dispatch_socket)
+void emit_system_report_json(int dispatch_socket, int64_t request_id, const struct SystemStats *stats)
 {
-	struct sysinfo info;
-	sysinfo(&info);
+	char reply[REPLY_BUFFER_SIZE];
+	struct DocumentWriter writer;
+
+	init_document_writer(&writer, find_client_encoding(dispatch_socket), reply, sizeof(reply));
+
+	begin_document_object(&writer);
+	write_document_key(&writer, "type");
+	write_document_integer(&writer, CMDREPORT);
 
-	cJSON *root_object = cJSON_CreateObject();
-	cJSON *payload_object = cJSON_CreateObject();
-	cJSON *stat_array = cJSON_AddArrayToObject(payload_object, "value");
+	if (request_id != NO_REQUEST_ID)
+	{
+		write_document_key(&writer, "id");
+		write_document_integer(&writer, request_id);
+	}
+
+	write_document_key(&writer, "payload");
+	begin_document_object(&writer);
+	write_document_key(&writer, "value");
+	begin_document_array(&writer);
 
-	cJSON_AddNumberToObject(root_object, "type", CMDREPORT);
-	cJSON_AddStringToObject(payload_object, "type", "system");
+	write_system_stat_object(&writer, "uptime", stats->uptime, 60, SUFFNONE); // build uptime
+	write_system_stat_object(&writer, "sys_temp", stats->temperature, 85, SUFFTHERMAL); //RPi max operating range is 85
+	write_system_stat_object(&writer, "usage", stats->usage, 60, SUFFPERCENTAGE); // build mem usage
 
-	cJSON_AddItemToArray(stat_array, generate_system_stat_object("uptime", info.uptime, 60, SUFFNONE)); // build uptime
-	cJSON_AddItemToArray(stat_array, generate_system_stat_object("sys_temp", probe_thermal_zone_temperature(), 85, SUFFTHERMAL)); //RPi max operating range is 85
+	end_document_array(&writer);
+	write_document_key(&writer, "type");
+	write_document_string(&writer, "system");
+	end_document_object(&writer);
+	end_document_object(&writer);
 
-	cJSON_AddItemToArray(stat_array, generate_system_stat_object("usage", // build mem usage
-		((double)(info.totalram - info.freeram) / (double)info.totalram) * 100, 60, SUFFPERCENTAGE));
+	size_t document_length;
+	const char *document = finish_document_writer(&writer, &document_length);
 
-	cJSON_AddItemToObject(root_object, "payload", payload_object);
+	if (document != NULL)
+	{
+		queue_outbound_frame(dispatch_socket, PRIORITYBULK, document, document_length);
+		puts("[>] System report");
+	}
 
-	handle_write_descriptor(cJSON_PrintUnformatted(root_object), dispatch_socket);
-	puts("[>] System report");
+	release_document_writer(&writer);
 }
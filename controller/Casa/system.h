@@ -4,7 +4,7 @@
 #include <wiringPi.h>
 #include <ifaddrs.h>
 
-#include "cJSON.h"
+#include "writer.h"
 
 /// <summary>
 /// Suffix classification for an attribute of a status report, interpreted by the client.
@@ -26,14 +26,24 @@ typedef enum
 } StatSuffix;
 
 /// <summary>
-/// Generates a JSON representation of a status report attribute.
+/// struct of the readings a system status report is built from, probed off the event loop.
 /// </summary>
+struct SystemStats
+{
+	long uptime; // seconds
+	int temperature; // degrees of the thermal zone
+	int usage; // percentage of memory in use
+};
+
+/// <summary>
+/// Writes the JSON representation of a status report attribute.
+/// </summary>
+/// <param name="writer">Writer of the report.</param>
 /// <param name="key">Name/key of the object.</param>
 /// <param name="value">Value of the object.</param>
 /// <param name="upper_bound">Maximum possible value for this attribute.</param>
 /// <param name="suffix">Suffix for display of the attribute.</param>
-/// <returns>cJSON object.</returns>
-cJSON *generate_system_stat_object(const char *name, int value, int upper_bound, StatSuffix suffix);
+void write_system_stat_object(struct DocumentWriter *writer, const char *name, int value, int upper_bound, StatSuffix suffix);
 
 /// <summary>
 /// Probes the temperaeture from the controller's own thermal zone.
@@ -41,6 +51,12 @@ cJSON *generate_system_stat_object(const char *name, int value, int upper_bound,
 /// <returns>Thermal zone reading as int (cJSON struggled with the original value).</returns>
 int probe_thermal_zone_temperature(void);
 
+/// <summary>
+/// Probes the uptime, thermal zone and memory consumption of the controller.
+/// </summary>
+/// <param name="stats">Destination for the readings.</param>
+void probe_system_stats(struct SystemStats *stats);
+
 /// <summary>
 /// Retrieves the local machine's address in octet notation (1.1.1.1).
 /// </summary>
@@ -48,7 +64,9 @@ int probe_thermal_zone_temperature(void);
 const char *retrieve_local_machine_address(void);
 
 /// <summary>
-/// Generates a JSON representation of a system status report. Reports uptime, system temperature and memory consumption.
+/// Generates a system status report in the encoding the client negotiated. Reports uptime, system temperature and memory consumption.
 /// </summary>
 /// <param name="dispatch_socket">Destination socket.</param>
-void emit_system_report_json(int dispatch_socket);
\ No newline at end of file
+/// <param name="request_id">ID of the request answered, or NO_REQUEST_ID.</param>
+/// <param name="stats">Readings from probe_system_stats.</param>
+void emit_system_report_json(int dispatch_socket, int64_t request_id, const struct SystemStats *stats);
\ No newline at end of file
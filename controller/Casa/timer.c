@@ -0,0 +1,448 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "timer.h"
+#include "coalesce.h"
+
+#define TIMER_LEVEL_MASK (TIMER_LEVEL_SLOTS - 1)
+#define TIMER_WHEEL_SPAN ((uint64_t)1 << (TIMER_LEVELS * TIMER_LEVEL_BITS)) // ticks, beyond which deadlines park in the outermost level
+
+/// <summary>
+/// struct of a hashed hierarchical timer wheel. A timer links into the innermost level whose slots are coarse enough to reach its deadline,
+/// and moves inwards whenever the slot it waits in comes around.
+/// </summary>
+struct TimerWheel
+{
+	struct Timer *slots[TIMER_LEVELS][TIMER_LEVEL_SLOTS];
+	uint64_t occupied[TIMER_LEVELS]; // bit per non-empty slot
+
+	uint64_t tick; // last tick advanced through
+	uint32_t scheduled_count;
+};
+
+static struct TimerWheel timer_wheel;
+
+static int timer_descriptor = -1;
+static uint64_t armed_deadline = NO_TIMER_DEADLINE;
+
+static uint64_t tick_of(uint64_t milliseconds)
+{
+	return milliseconds / TIMER_TICK;
+}
+
+static uint64_t ticks_of(uint32_t milliseconds)
+{
+	return (milliseconds + TIMER_TICK - 1) / TIMER_TICK;
+}
+
+static uint64_t rotate_occupancy(uint64_t occupied, uint8_t shift)
+{
+	return shift == 0 ? occupied : occupied >> shift | occupied << (TIMER_LEVEL_SLOTS - shift);
+}
+
+/// <summary>
+/// Links a timer into the slot its deadline falls on, at the innermost level spanning it from the wheel's tick.
+/// </summary>
+static void link_timer(struct TimerWheel *wheel, struct Timer *timer)
+{
+	uint64_t delta = timer->deadline - wheel->tick;
+	uint64_t reach = timer->deadline;
+	uint8_t level = 0;
+
+	if (delta >= TIMER_WHEEL_SPAN) // parked as far out as the wheel reaches, and placed again once cascaded
+	{
+		delta = TIMER_WHEEL_SPAN - 1;
+		reach = wheel->tick + delta;
+	}
+
+	while (level < TIMER_LEVELS - 1 && delta >> (TIMER_LEVEL_BITS * (level + 1)) != 0)
+	{
+		level++;
+	}
+
+	const uint8_t slot = reach >> (TIMER_LEVEL_BITS * level) & TIMER_LEVEL_MASK;
+	struct Timer **head = &wheel->slots[level][slot];
+
+	timer->prev = NULL;
+	timer->next = *head;
+
+	if (*head != NULL)
+	{
+		(*head)->prev = timer;
+	}
+
+	*head = timer;
+	wheel->occupied[level] |= (uint64_t)1 << slot;
+
+	timer->level = level;
+	timer->slot = slot;
+	timer->is_scheduled = true;
+	wheel->scheduled_count++;
+}
+
+static void unlink_timer(struct TimerWheel *wheel, struct Timer *timer)
+{
+	if (timer->prev != NULL)
+	{
+		timer->prev->next = timer->next;
+	}
+	else
+	{
+		wheel->slots[timer->level][timer->slot] = timer->next;
+
+		if (timer->next == NULL)
+		{
+			wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+		}
+	}
+
+	if (timer->next != NULL)
+	{
+		timer->next->prev = timer->prev;
+	}
+
+	timer->is_scheduled = false;
+	wheel->scheduled_count--;
+}
+
+static void insert_timer(struct TimerWheel *wheel, struct Timer *timer, uint64_t deadline, uint32_t interval, TimerCallback callback, void *context)
+{
+	if (timer->is_scheduled)
+	{
+		unlink_timer(wheel, timer);
+	}
+
+	timer->deadline = deadline > wheel->tick ? deadline : wheel->tick + 1; // never behind the wheel
+	timer->interval = interval;
+	timer->callback = callback;
+	timer->context = context;
+
+	link_timer(wheel, timer);
+}
+
+/// <summary>
+/// Places every timer of the outer slots coming due at the wheel's tick into inner levels, level by level while each wraps.
+/// </summary>
+static void cascade_timers(struct TimerWheel *wheel)
+{
+	for (uint8_t level = 1; level < TIMER_LEVELS; level++)
+	{
+		const uint8_t slot = wheel->tick >> (TIMER_LEVEL_BITS * level) & TIMER_LEVEL_MASK;
+		struct Timer *timer = wheel->slots[level][slot];
+
+		wheel->slots[level][slot] = NULL;
+		wheel->occupied[level] &= ~((uint64_t)1 << slot);
+
+		while (timer != NULL)
+		{
+			struct Timer *next = timer->next;
+
+			wheel->scheduled_count--;
+			link_timer(wheel, timer);
+
+			timer = next;
+		}
+
+		if (slot != 0) // outer levels only move on once this one wraps
+		{
+			break;
+		}
+	}
+}
+
+static void advance_wheel(struct TimerWheel *wheel, uint64_t target_tick)
+{
+	while (wheel->tick < target_tick)
+	{
+		if (wheel->scheduled_count == 0)
+		{
+			break;
+		}
+
+		if (wheel->occupied[0] == 0) // nothing fires before the next cascade
+		{
+			const uint64_t boundary = (wheel->tick | TIMER_LEVEL_MASK) + 1;
+
+			if (boundary > target_tick)
+			{
+				break;
+			}
+
+			wheel->tick = boundary;
+		}
+		else
+		{
+			wheel->tick++;
+		}
+
+		if ((wheel->tick & TIMER_LEVEL_MASK) == 0)
+		{
+			cascade_timers(wheel);
+		}
+
+		struct Timer **head = &wheel->slots[0][wheel->tick & TIMER_LEVEL_MASK];
+
+		while (*head != NULL) // callbacks may schedule or cancel any timer, never into this slot
+		{
+			struct Timer *timer = *head;
+
+			unlink_timer(wheel, timer);
+
+			if (timer->interval != 0) // due again before its callback runs, which may cancel it
+			{
+				timer->deadline += timer->interval;
+
+				if (timer->deadline <= wheel->tick) // missed firings are skipped, not repeated
+				{
+					timer->deadline = wheel->tick + timer->interval;
+				}
+
+				link_timer(wheel, timer);
+			}
+
+			timer->callback(timer, timer->context);
+		}
+	}
+
+	if (wheel->tick < target_tick) // an empty stretch is skipped at once
+	{
+		wheel->tick = target_tick;
+	}
+}
+
+/// <summary>
+/// Finds the earliest tick at which the wheel fires or cascades, exact for the innermost level.
+/// </summary>
+static uint64_t next_wheel_deadline(const struct TimerWheel *wheel)
+{
+	if (wheel->scheduled_count == 0)
+	{
+		return NO_TIMER_DEADLINE;
+	}
+
+	uint64_t earliest = NO_TIMER_DEADLINE;
+
+	for (uint8_t level = 0; level < TIMER_LEVELS; level++)
+	{
+		if (wheel->occupied[level] == 0)
+		{
+			continue;
+		}
+
+		const uint8_t shift = TIMER_LEVEL_BITS * level;
+		const uint64_t base = (wheel->tick >> shift) + 1; // slot of the current tick is behind every timer of its level
+		const uint64_t distance = __builtin_ctzll(rotate_occupancy(wheel->occupied[level], base & TIMER_LEVEL_MASK));
+		const uint64_t deadline = (base + distance) << shift;
+
+		if (deadline < earliest)
+		{
+			earliest = deadline;
+		}
+	}
+
+	return earliest;
+}
+
+/// <summary>
+/// Brings an idle wheel up to date, so a timer scheduled into it is not placed against a stale tick.
+/// </summary>
+static uint64_t catch_up_timer_wheel(void)
+{
+	const uint64_t now = tick_of(monotonic_milliseconds());
+
+	if (timer_wheel.scheduled_count == 0 && timer_wheel.tick < now)
+	{
+		timer_wheel.tick = now;
+	}
+
+	return now;
+}
+
+void schedule_timer(struct Timer *timer, uint32_t delay, TimerCallback callback, void *context)
+{
+	const uint64_t now = catch_up_timer_wheel();
+
+	insert_timer(&timer_wheel, timer, now + ticks_of(delay), 0, callback, context);
+}
+
+void schedule_periodic_timer(struct Timer *timer, uint32_t interval, TimerCallback callback, void *context)
+{
+	const uint64_t now = catch_up_timer_wheel();
+	const uint64_t interval_ticks = ticks_of(interval) > 0 ? ticks_of(interval) : 1;
+
+	insert_timer(&timer_wheel, timer, now + interval_ticks, (uint32_t)interval_ticks, callback, context);
+}
+
+void cancel_timer(struct Timer *timer)
+{
+	if (timer->is_scheduled)
+	{
+		unlink_timer(&timer_wheel, timer);
+	}
+}
+
+void advance_timers(uint64_t now)
+{
+	advance_wheel(&timer_wheel, tick_of(now));
+}
+
+uint64_t next_timer_deadline(void)
+{
+	const uint64_t deadline = next_wheel_deadline(&timer_wheel);
+
+	return deadline == NO_TIMER_DEADLINE ? NO_TIMER_DEADLINE : deadline * TIMER_TICK;
+}
+
+int fill_timer_descriptor(fd_set *read_fds, int fdmax)
+{
+	if (timer_descriptor == -1)
+	{
+		timer_descriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+		if (timer_descriptor == -1)
+		{
+			perror("[x] Timer descriptor failure");
+			exit(-1); // the event loop would sleep through every deadline
+		}
+	}
+
+	const uint64_t deadline = next_timer_deadline();
+
+	if (deadline != armed_deadline) // rearmed only when the earliest deadline moves
+	{
+		struct itimerspec expiry = { 0 }; // zero disarms
+
+		if (deadline != NO_TIMER_DEADLINE)
+		{
+			expiry.it_value.tv_sec = deadline / 1000;
+			expiry.it_value.tv_nsec = (deadline % 1000) * 1000000;
+		}
+
+		timerfd_settime(timer_descriptor, TFD_TIMER_ABSTIME, &expiry, NULL);
+		armed_deadline = deadline;
+	}
+
+	FD_SET(timer_descriptor, read_fds);
+
+	return timer_descriptor > fdmax ? timer_descriptor : fdmax;
+}
+
+void handle_timer_descriptor(fd_set *read_fds)
+{
+	if (timer_descriptor == -1 || !FD_ISSET(timer_descriptor, read_fds))
+	{
+		return;
+	}
+
+	uint64_t expirations;
+
+	if (read(timer_descriptor, &expirations, sizeof(expirations)) > 0)
+	{
+		armed_deadline = NO_TIMER_DEADLINE; // spent
+	}
+
+	advance_timers(monotonic_milliseconds());
+}
+
+static void count_expiry(struct Timer *timer, void *context)
+{
+	(void)timer;
+
+	(*(unsigned int *)context)++;
+}
+
+static double elapsed_nanoseconds(struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+void benchmark_timer_wheel(unsigned int count)
+{
+	const uint64_t span = tick_of(600000); // ten minutes
+
+	struct TimerWheel *wheel = calloc(1, sizeof(struct TimerWheel));
+	struct Timer *timers = calloc(count, sizeof(struct Timer));
+	uint64_t *deadlines = malloc(count * sizeof(uint64_t));
+
+	if (wheel == NULL || timers == NULL || deadlines == NULL)
+	{
+		free(wheel);
+		free(timers);
+		free(deadlines);
+		return;
+	}
+
+	unsigned int expired_count = 0;
+	struct timespec start;
+
+	srand(count);
+	wheel->tick = tick_of(monotonic_milliseconds());
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		deadlines[i] = wheel->tick + 1 + rand() % span;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		insert_timer(wheel, &timers[i], deadlines[i], 0, count_expiry, &expired_count);
+	}
+
+	const double insert_time = elapsed_nanoseconds(&start) / count;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < count; i += 2)
+	{
+		unlink_timer(wheel, &timers[i]);
+	}
+
+	const double cancel_time = elapsed_nanoseconds(&start) / ((count + 1) / 2);
+
+	for (unsigned int i = 0; i < count; i += 2) // every timer is active again for lookups and expiry
+	{
+		insert_timer(wheel, &timers[i], deadlines[i], 0, count_expiry, &expired_count);
+	}
+
+	volatile uint64_t earliest = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		earliest += next_wheel_deadline(wheel);
+	}
+
+	const double lookup_time = elapsed_nanoseconds(&start) / count;
+
+	uint32_t wake_count = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (wheel->scheduled_count > 0) // woken at each deadline, as the event loop is
+	{
+		advance_wheel(wheel, next_wheel_deadline(wheel));
+		wake_count++;
+	}
+
+	const double expiry_time = elapsed_nanoseconds(&start) / count;
+
+	printf("[~] timer wheel: %u timers over %llu ticks, %.0f ns/insert, %.0f ns/cancel, %.0f ns/next deadline, %.0f ns/expiry (%u of %u expired in %u wakes)\n",
+		count, (unsigned long long)span, insert_time, cancel_time, lookup_time, expiry_time, expired_count, count, wake_count);
+
+	free(deadlines);
+	free(timers);
+	free(wheel);
+}
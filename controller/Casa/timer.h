@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <sys/select.h>
+
+#define TIMER_TICK 10 // milliseconds per slot of the innermost level
+#define TIMER_LEVELS 4 // levels of the wheel, each slot of one spanning a rotation of the level below - 46 hours in all, later deadlines cascade again
+#define TIMER_LEVEL_BITS 6
+#define TIMER_LEVEL_SLOTS (1 << TIMER_LEVEL_BITS) // slots of a level, one bit each in its occupancy mask
+#define NO_TIMER_DEADLINE UINT64_MAX
+
+struct Timer;
+
+/// <summary>
+/// Routine fired once a timer's deadline passes, which may schedule or cancel the timer again.
+/// </summary>
+typedef void (*TimerCallback)(struct Timer *timer, void *context);
+
+/// <summary>
+/// struct of a pending timer, owned by its caller and linked into a slot of the timer wheel while scheduled.
+/// </summary>
+struct Timer
+{
+	uint64_t deadline; // tick at which the timer fires
+	uint32_t interval; // ticks between firings of a periodic timer, 0 if it fires once
+
+	TimerCallback callback;
+	void *context;
+
+	struct Timer *prev;
+	struct Timer *next;
+	uint8_t level; // slot linked into, while scheduled
+	uint8_t slot;
+	bool is_scheduled;
+};
+
+/// <summary>
+/// Schedules a timer to fire once, replacing any deadline it had.
+/// </summary>
+/// <param name="timer">Timer to schedule.</param>
+/// <param name="delay">Milliseconds from now, rounded up to a tick.</param>
+/// <param name="callback">Routine to fire.</param>
+/// <param name="context">Passed to the routine.</param>
+void schedule_timer(struct Timer *timer, uint32_t delay, TimerCallback callback, void *context);
+
+/// <summary>
+/// Schedules a timer to fire every interval until cancelled, replacing any deadline it had.
+/// Deadlines follow from the first, so a late firing does not delay the next.
+/// </summary>
+/// <param name="timer">Timer to schedule.</param>
+/// <param name="interval">Milliseconds between firings, rounded up to a tick.</param>
+/// <param name="callback">Routine to fire.</param>
+/// <param name="context">Passed to the routine.</param>
+void schedule_periodic_timer(struct Timer *timer, uint32_t interval, TimerCallback callback, void *context);
+
+/// <summary>
+/// Cancels a timer if scheduled.
+/// </summary>
+/// <param name="timer">Timer to cancel.</param>
+void cancel_timer(struct Timer *timer);
+
+/// <summary>
+/// Fires every timer whose deadline has passed, tick by tick up to the current one, cascading outer levels inwards as they come due.
+/// </summary>
+/// <param name="now">Current time, from monotonic_milliseconds.</param>
+void advance_timers(uint64_t now);
+
+/// <summary>
+/// Finds when the wheel next needs advancing, for the event loop to wake by then.
+/// </summary>
+/// <returns>Time of the earliest deadline, or of an earlier cascade, or NO_TIMER_DEADLINE if no timer is scheduled.</returns>
+uint64_t next_timer_deadline(void);
+
+/// <summary>
+/// Arms the timer descriptor for the next deadline and adds it to a descriptor set.
+/// </summary>
+/// <param name="read_fds">Descriptor set to populate.</param>
+/// <param name="fdmax">Current highest descriptor.</param>
+/// <returns>Highest descriptor, including the timer descriptor.</returns>
+int fill_timer_descriptor(fd_set *read_fds, int fdmax);
+
+/// <summary>
+/// Fires due timers once the timer descriptor has expired.
+/// </summary>
+/// <param name="read_fds">Descriptor set returned by select().</param>
+void handle_timer_descriptor(fd_set *read_fds);
+
+/// <summary>
+/// Measures insertion, cancellation, deadline lookup and expiry on a wheel of its own, with deadlines spread over ten minutes.
+/// </summary>
+/// <param name="count">Active timers.</param>
+void benchmark_timer_wheel(unsigned int count);
@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <sys/eventfd.h>
+
+#include "workers.h"
+
+/// <summary>
+/// struct of a worker's tasks. The event loop pushes onto the bottom and the worker takes the eldest from the top,
+/// while idle workers steal the newest from the bottom.
+/// </summary>
+struct WorkDeque
+{
+	pthread_mutex_t lock;
+
+	struct WorkTask *tasks[WORK_DEQUE_CAPACITY]; // ring, indexed modulo its capacity
+	uint32_t top; // eldest task
+	uint32_t bottom; // past the newest task
+};
+
+/// <summary>
+/// struct of a worker thread.
+/// </summary>
+struct Worker
+{
+	pthread_t thread;
+	uint8_t index;
+
+	struct WorkDeque deque;
+};
+
+/// <summary>
+/// struct of the pool, and the queue of tasks it has finished for the event loop to complete.
+/// </summary>
+struct WorkerPool
+{
+	struct Worker workers[MAX_WORKER_THREADS];
+	uint8_t worker_count;
+	uint8_t next_worker; // handed the next task
+
+	pthread_mutex_t lock;
+	pthread_cond_t work_available; // idle workers sleep on it
+	uint32_t unclaimed_count; // tasks in deques that no worker has yet set out to take
+
+	pthread_mutex_t completion_lock;
+	struct WorkTask *completed_head;
+	struct WorkTask *completed_tail;
+	int completion_fd; // eventfd, signalled once per task finished
+};
+
+static struct WorkerPool worker_pool =
+{
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.work_available = PTHREAD_COND_INITIALIZER,
+	.completion_lock = PTHREAD_MUTEX_INITIALIZER,
+	.completion_fd = -1
+};
+
+/// <summary>
+/// Pushes a task onto the bottom of a deque.
+/// </summary>
+static bool push_work_task(struct WorkDeque *deque, struct WorkTask *task)
+{
+	pthread_mutex_lock(&deque->lock);
+
+	const bool has_room = deque->bottom - deque->top < WORK_DEQUE_CAPACITY;
+
+	if (has_room)
+	{
+		deque->tasks[deque->bottom++ % WORK_DEQUE_CAPACITY] = task;
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return has_room;
+}
+
+/// <summary>
+/// Takes the eldest task from the top of a worker's own deque.
+/// </summary>
+static struct WorkTask *take_work_task(struct WorkDeque *deque)
+{
+	struct WorkTask *task = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->top != deque->bottom)
+	{
+		task = deque->tasks[deque->top++ % WORK_DEQUE_CAPACITY];
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+/// <summary>
+/// Steals the newest task from the bottom of another worker's deque.
+/// </summary>
+static struct WorkTask *steal_work_task(struct WorkDeque *deque)
+{
+	struct WorkTask *task = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->top != deque->bottom)
+	{
+		task = deque->tasks[--deque->bottom % WORK_DEQUE_CAPACITY];
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+/// <summary>
+/// Queues a finished task for the event loop to complete, and signals it.
+/// </summary>
+static void finish_work_task(struct WorkTask *task)
+{
+	const uint64_t signal = 1;
+
+	task->next = NULL;
+
+	pthread_mutex_lock(&worker_pool.completion_lock);
+
+	if (worker_pool.completed_tail != NULL)
+	{
+		worker_pool.completed_tail->next = task;
+	}
+	else
+	{
+		worker_pool.completed_head = task;
+	}
+
+	worker_pool.completed_tail = task;
+
+	pthread_mutex_unlock(&worker_pool.completion_lock);
+
+	write(worker_pool.completion_fd, &signal, sizeof(signal));
+}
+
+/// <summary>
+/// Runs tasks from the worker's own deque, stealing from the others' once it is empty, and sleeps while none are queued.
+/// </summary>
+static void *run_worker(void *argument)
+{
+	struct Worker *worker = argument;
+
+	while (true)
+	{
+		pthread_mutex_lock(&worker_pool.lock);
+
+		while (worker_pool.unclaimed_count == 0)
+		{
+			pthread_cond_wait(&worker_pool.work_available, &worker_pool.lock);
+		}
+
+		worker_pool.unclaimed_count--; // a task is left for this worker, though possibly in another's deque
+
+		pthread_mutex_unlock(&worker_pool.lock);
+
+		struct WorkTask *task = NULL;
+
+		while (task == NULL) // every claim is backed by a queued task, so one is found once other claimants stop moving them
+		{
+			task = take_work_task(&worker->deque);
+
+			for (uint8_t i = 1; task == NULL && i < worker_pool.worker_count; i++)
+			{
+				task = steal_work_task(&worker_pool.workers[(worker->index + i) % worker_pool.worker_count].deque);
+			}
+		}
+
+		task->run(task);
+		finish_work_task(task);
+	}
+
+	return NULL;
+}
+
+void start_workers(uint8_t count)
+{
+	if (count > MAX_WORKER_THREADS)
+	{
+		count = MAX_WORKER_THREADS;
+	}
+
+	if (count > 0 && (worker_pool.completion_fd = eventfd(0, EFD_NONBLOCK)) == -1)
+	{
+		perror("[x] Worker completion queue failure");
+		return;
+	}
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		struct Worker *worker = &worker_pool.workers[i];
+
+		worker->index = i;
+		worker->deque.top = worker->deque.bottom = 0;
+		pthread_mutex_init(&worker->deque.lock, NULL);
+
+		if (pthread_create(&worker->thread, NULL, run_worker, worker) != 0)
+		{
+			break;
+		}
+
+		pthread_detach(worker->thread);
+		worker_pool.worker_count++;
+	}
+}
+
+uint8_t default_worker_count(void)
+{
+	long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return core_count < 1 ? 1 : core_count > MAX_WORKER_THREADS ? MAX_WORKER_THREADS : core_count;
+}
+
+void submit_work_task(struct WorkTask *task)
+{
+	bool is_pushed = false;
+
+	for (uint8_t i = 0; !is_pushed && i < worker_pool.worker_count; i++) // the next worker in turn, unless its deque is full
+	{
+		is_pushed = push_work_task(&worker_pool.workers[worker_pool.next_worker].deque, task);
+		worker_pool.next_worker = (worker_pool.next_worker + 1) % worker_pool.worker_count;
+	}
+
+	if (!is_pushed) // no workers, or every deque is full - run inline, holding the loop back as the work would have
+	{
+		task->run(task);
+		task->complete(task);
+
+		return;
+	}
+
+	pthread_mutex_lock(&worker_pool.lock);
+	worker_pool.unclaimed_count++;
+	pthread_cond_signal(&worker_pool.work_available);
+	pthread_mutex_unlock(&worker_pool.lock);
+}
+
+int fill_worker_descriptor(fd_set *read_fds, int fdmax)
+{
+	if (worker_pool.completion_fd == -1)
+	{
+		return fdmax;
+	}
+
+	FD_SET(worker_pool.completion_fd, read_fds);
+
+	return worker_pool.completion_fd > fdmax ? worker_pool.completion_fd : fdmax;
+}
+
+void handle_worker_descriptor(fd_set *read_fds)
+{
+	uint64_t finished_count;
+
+	if (worker_pool.completion_fd == -1 || !FD_ISSET(worker_pool.completion_fd, read_fds))
+	{
+		return;
+	}
+
+	read(worker_pool.completion_fd, &finished_count, sizeof(finished_count)); // resets the count, every task queued by now is taken below
+
+	pthread_mutex_lock(&worker_pool.completion_lock);
+
+	struct WorkTask *task = worker_pool.completed_head;
+	worker_pool.completed_head = worker_pool.completed_tail = NULL;
+
+	pthread_mutex_unlock(&worker_pool.completion_lock);
+
+	while (task != NULL)
+	{
+		struct WorkTask *next = task->next;
+
+		task->complete(task); // frees the task
+
+		task = next;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <sys/select.h>
+
+#define MAX_WORKER_THREADS 8
+#define WORK_DEQUE_CAPACITY 256 // tasks a worker may hold, further tasks go to the next worker with room
+
+struct WorkTask;
+
+/// <summary>
+/// Routine of a task, either its work on a worker thread or its completion on the event loop.
+/// </summary>
+typedef void (*WorkRoutine)(struct WorkTask *task);
+
+/// <summary>
+/// struct of a task handed off the event loop, embedded first in a struct of the task's own state.
+/// Its work may only read state the event loop does not change, or copies made when it was submitted;
+/// its completion runs on the event loop and may write to clients, then frees the task.
+/// </summary>
+struct WorkTask
+{
+	WorkRoutine run; // on a worker thread
+	WorkRoutine complete; // on the event loop, once run
+
+	struct WorkTask *next; // in the completion queue
+};
+
+/// <summary>
+/// Starts the worker pool, each worker with a deque of its own.
+/// </summary>
+/// <param name="count">Workers, up to MAX_WORKER_THREADS, 0 running tasks inline on the event loop.</param>
+void start_workers(uint8_t count);
+
+/// <summary>
+/// Determines how many workers suit this machine, one per online core.
+/// </summary>
+/// <returns>Online cores, up to MAX_WORKER_THREADS.</returns>
+uint8_t default_worker_count(void);
+
+/// <summary>
+/// Hands a task to the next worker in turn, or runs and completes it at once if there are no workers.
+/// </summary>
+/// <param name="task">Task, owned by the pool until completed.</param>
+void submit_work_task(struct WorkTask *task);
+
+/// <summary>
+/// Adds the completion descriptor to a descriptor set.
+/// </summary>
+/// <param name="read_fds">Descriptor set to populate.</param>
+/// <param name="fdmax">Current highest descriptor.</param>
+/// <returns>Highest descriptor, including the completion descriptor.</returns>
+int fill_worker_descriptor(fd_set *read_fds, int fdmax);
+
+/// <summary>
+/// Completes every task the workers have finished, in the order they finished.
+/// </summary>
+/// <param name="read_fds">Descriptor set returned by select().</param>
+void handle_worker_descriptor(fd_set *read_fds);
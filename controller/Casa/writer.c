@@ -0,0 +1,565 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <stdint.h>
+
+#include "writer.h"
+#include "numeric.h"
+
+/// <summary>
+/// Ensures room for a number of further bytes and the terminator, moving onto the heap once the buffer is outgrown.
+/// </summary>
+static bool reserve_document_writer(struct DocumentWriter *writer, size_t bytes)
+{
+	if (writer->failed)
+	{
+		return false;
+	}
+
+	if (writer->length + bytes < writer->capacity)
+	{
+		return true;
+	}
+
+	size_t capacity = writer->capacity * 2;
+
+	while (writer->length + bytes >= capacity)
+	{
+		capacity *= 2;
+	}
+
+	char *buffer = writer->owns_buffer ? realloc(writer->buffer, capacity) : malloc(capacity);
+
+	if (buffer == NULL)
+	{
+		writer->failed = true;
+		return false;
+	}
+
+	if (!writer->owns_buffer)
+	{
+		memcpy(buffer, writer->buffer, writer->length + 1);
+	}
+
+	writer->buffer = buffer;
+	writer->capacity = capacity;
+	writer->owns_buffer = true;
+
+	return true;
+}
+
+static void append_bytes(struct DocumentWriter *writer, const char *bytes, size_t length)
+{
+	if (!reserve_document_writer(writer, length))
+	{
+		return;
+	}
+
+	memcpy(writer->buffer + writer->length, bytes, length);
+
+	writer->length += length;
+	writer->buffer[writer->length] = '\0';
+}
+
+/// <summary>
+/// Appends a big endian integer of a number of bytes, as MessagePack stores lengths and values.
+/// </summary>
+static void append_big_endian(struct DocumentWriter *writer, uint64_t value, uint8_t bytes)
+{
+	char encoded[8];
+
+	for (uint8_t i = 0; i < bytes; i++)
+	{
+		encoded[i] = (char)(value >> (8 * (bytes - 1 - i)));
+	}
+
+	append_bytes(writer, encoded, bytes);
+}
+
+/// <summary>
+/// Appends a MessagePack type byte followed by its big endian argument.
+/// </summary>
+static void append_packed(struct DocumentWriter *writer, uint8_t type, uint64_t value, uint8_t bytes)
+{
+	const char type_byte = (char)type;
+
+	append_bytes(writer, &type_byte, 1);
+	append_big_endian(writer, value, bytes);
+}
+
+/// <summary>
+/// Separates a value from its predecessor within the enclosing object or array, and counts it as a member.
+/// </summary>
+static void begin_document_value(struct DocumentWriter *writer)
+{
+	if (writer->awaiting_value) // follows its key
+	{
+		writer->awaiting_value = false;
+		return;
+	}
+
+	if (writer->depth == 0)
+	{
+		if (writer->length > 0) // a single root value
+		{
+			writer->failed = true;
+		}
+
+		return;
+	}
+
+	if (writer->encoding == ENCODINGJSON && writer->member_counts[writer->depth - 1] > 0)
+	{
+		append_bytes(writer, ",", 1);
+	}
+
+	writer->member_counts[writer->depth - 1]++;
+}
+
+/// <summary>
+/// Sizes the MessagePack header of a level by its member count, shrinking it to the smallest form that fits.
+/// </summary>
+static void size_packed_level(struct DocumentWriter *writer, uint8_t level)
+{
+	if (writer->failed)
+	{
+		return;
+	}
+
+	const size_t offset = writer->header_offsets[level];
+	const uint32_t count = writer->member_counts[level];
+	const bool is_object = (uint8_t)writer->buffer[offset] == 0xdf; // map 32, as opened
+
+	uint8_t header[5];
+	uint8_t header_length;
+
+	if (count < 16) // fixmap or fixarray
+	{
+		header[0] = (is_object ? 0x80 : 0x90) | count;
+		header_length = 1;
+	}
+	else if (count <= UINT16_MAX)
+	{
+		header[0] = is_object ? 0xde : 0xdc;
+		header[1] = (uint8_t)(count >> 8);
+		header[2] = (uint8_t)count;
+		header_length = 3;
+	}
+	else
+	{
+		header[0] = is_object ? 0xdf : 0xdd;
+		header[1] = (uint8_t)(count >> 24);
+		header[2] = (uint8_t)(count >> 16);
+		header[3] = (uint8_t)(count >> 8);
+		header[4] = (uint8_t)count;
+		header_length = 5;
+	}
+
+	memmove(writer->buffer + offset + header_length, writer->buffer + offset + 5, writer->length - offset - 5);
+	memcpy(writer->buffer + offset, header, header_length);
+
+	writer->length -= 5 - header_length;
+	writer->buffer[writer->length] = '\0';
+}
+
+static void open_document_level(struct DocumentWriter *writer, bool is_object)
+{
+	begin_document_value(writer);
+
+	if (writer->depth == MAX_DOCUMENT_DEPTH)
+	{
+		writer->failed = true;
+		return;
+	}
+
+	writer->header_offsets[writer->depth] = writer->length;
+	writer->member_counts[writer->depth] = 0;
+
+	if (writer->encoding == ENCODINGJSON)
+	{
+		append_bytes(writer, is_object ? "{" : "[", 1);
+	}
+	else // the widest header, sized once the members are known
+	{
+		append_packed(writer, is_object ? 0xdf : 0xdd, 0, 4);
+	}
+
+	writer->depth++;
+}
+
+static void close_document_level(struct DocumentWriter *writer, bool is_object)
+{
+	if (writer->depth == 0 || writer->awaiting_value)
+	{
+		writer->failed = true;
+		return;
+	}
+
+	writer->depth--;
+
+	if (writer->encoding == ENCODINGJSON)
+	{
+		append_bytes(writer, is_object ? "}" : "]", 1);
+	}
+	else
+	{
+		size_packed_level(writer, writer->depth);
+	}
+}
+
+/// <summary>
+/// Appends a quoted string, escaped as cJSON prints it.
+/// </summary>
+static void append_json_string(struct DocumentWriter *writer, const char *value)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+
+	append_bytes(writer, "\"", 1);
+
+	const char *run = value; // unescaped characters are appended a run at a time
+
+	for (const char *character = value; *character != '\0'; character++)
+	{
+		const unsigned char byte = (unsigned char)*character;
+
+		if (byte >= 0x20 && byte != '"' && byte != '\\')
+		{
+			continue;
+		}
+
+		append_bytes(writer, run, character - run);
+		run = character + 1;
+
+		char escape[6] = { '\\', (char)byte };
+		size_t escape_length = 2;
+
+		switch (byte)
+		{
+		case '"': case '\\': break;
+		case '\b': escape[1] = 'b'; break;
+		case '\f': escape[1] = 'f'; break;
+		case '\n': escape[1] = 'n'; break;
+		case '\r': escape[1] = 'r'; break;
+		case '\t': escape[1] = 't'; break;
+		default: // other control characters
+			escape[1] = 'u';
+			escape[2] = '0';
+			escape[3] = '0';
+			escape[4] = hex_digits[byte >> 4];
+			escape[5] = hex_digits[byte & 0xF];
+			escape_length = 6;
+		}
+
+		append_bytes(writer, escape, escape_length);
+	}
+
+	append_bytes(writer, run, strlen(run));
+	append_bytes(writer, "\"", 1);
+}
+
+static void append_packed_string(struct DocumentWriter *writer, const char *value)
+{
+	const size_t length = strlen(value);
+
+	if (length < 32) // fixstr
+	{
+		append_packed(writer, 0xa0 | length, 0, 0);
+	}
+	else if (length <= UINT8_MAX)
+	{
+		append_packed(writer, 0xd9, length, 1);
+	}
+	else if (length <= UINT16_MAX)
+	{
+		append_packed(writer, 0xda, length, 2);
+	}
+	else
+	{
+		append_packed(writer, 0xdb, length, 4);
+	}
+
+	append_bytes(writer, value, length);
+}
+
+static void append_packed_integer(struct DocumentWriter *writer, long long value)
+{
+	if (value >= 0)
+	{
+		if (value <= 0x7f) // positive fixint
+		{
+			append_packed(writer, (uint8_t)value, 0, 0);
+		}
+		else if (value <= UINT8_MAX)
+		{
+			append_packed(writer, 0xcc, value, 1);
+		}
+		else if (value <= UINT16_MAX)
+		{
+			append_packed(writer, 0xcd, value, 2);
+		}
+		else if (value <= UINT32_MAX)
+		{
+			append_packed(writer, 0xce, value, 4);
+		}
+		else
+		{
+			append_packed(writer, 0xcf, value, 8);
+		}
+	}
+	else if (value >= -32) // negative fixint
+	{
+		append_packed(writer, (uint8_t)value, 0, 0);
+	}
+	else if (value >= INT8_MIN)
+	{
+		append_packed(writer, 0xd0, (uint64_t)value, 1);
+	}
+	else if (value >= INT16_MIN)
+	{
+		append_packed(writer, 0xd1, (uint64_t)value, 2);
+	}
+	else if (value >= INT32_MIN)
+	{
+		append_packed(writer, 0xd2, (uint64_t)value, 4);
+	}
+	else
+	{
+		append_packed(writer, 0xd3, (uint64_t)value, 8);
+	}
+}
+
+static void append_packed_number(struct DocumentWriter *writer, double value)
+{
+	if (!isfinite(value)) // nil, as JSON writes null
+	{
+		append_packed(writer, 0xc0, 0, 0);
+	}
+	else if (value == floor(value) && fabs(value) < 9223372036854775808.0) // integral, within 2^63
+	{
+		append_packed_integer(writer, (long long)value);
+	}
+	else if ((double)(float)value == value)
+	{
+		union { float number; uint32_t bits; } single = { (float)value };
+
+		append_packed(writer, 0xca, single.bits, 4);
+	}
+	else
+	{
+		union { double number; uint64_t bits; } wide = { value };
+
+		append_packed(writer, 0xcb, wide.bits, 8);
+	}
+}
+
+void init_document_writer(struct DocumentWriter *writer, WireEncoding encoding, char *buffer, size_t capacity)
+{
+	writer->encoding = encoding;
+
+	writer->buffer = buffer;
+	writer->length = 0;
+	writer->capacity = capacity;
+	writer->buffer[0] = '\0';
+
+	writer->owns_buffer = false;
+	writer->failed = false;
+
+	writer->depth = 0;
+	writer->awaiting_value = false;
+}
+
+void release_document_writer(struct DocumentWriter *writer)
+{
+	if (writer->owns_buffer)
+	{
+		free(writer->buffer);
+	}
+
+	writer->buffer = NULL;
+	writer->owns_buffer = false;
+}
+
+void begin_document_object(struct DocumentWriter *writer)
+{
+	open_document_level(writer, true);
+}
+
+void end_document_object(struct DocumentWriter *writer)
+{
+	close_document_level(writer, true);
+}
+
+void begin_document_array(struct DocumentWriter *writer)
+{
+	open_document_level(writer, false);
+}
+
+void end_document_array(struct DocumentWriter *writer)
+{
+	close_document_level(writer, false);
+}
+
+void write_document_key(struct DocumentWriter *writer, const char *key)
+{
+	if (writer->depth == 0 || writer->awaiting_value)
+	{
+		writer->failed = true;
+		return;
+	}
+
+	begin_document_value(writer);
+
+	if (writer->encoding == ENCODINGJSON)
+	{
+		append_json_string(writer, key);
+		append_bytes(writer, ":", 1);
+	}
+	else
+	{
+		append_packed_string(writer, key);
+	}
+
+	writer->awaiting_value = true;
+}
+
+void write_document_string(struct DocumentWriter *writer, const char *value)
+{
+	begin_document_value(writer);
+
+	if (writer->encoding == ENCODINGJSON)
+	{
+		append_json_string(writer, value);
+	}
+	else
+	{
+		append_packed_string(writer, value);
+	}
+}
+
+void write_document_integer(struct DocumentWriter *writer, long long value)
+{
+	begin_document_value(writer);
+
+	if (writer->encoding == ENCODINGMSGPACK)
+	{
+		append_packed_integer(writer, value);
+		return;
+	}
+
+	char digits[24];
+	size_t position = sizeof(digits); // filled from the end
+
+	unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+
+	do
+	{
+		digits[--position] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	if (value < 0)
+	{
+		digits[--position] = '-';
+	}
+
+	append_bytes(writer, digits + position, sizeof(digits) - position);
+}
+
+void write_document_number(struct DocumentWriter *writer, double value)
+{
+	begin_document_value(writer);
+
+	if (writer->encoding == ENCODINGMSGPACK)
+	{
+		append_packed_number(writer, value);
+	}
+	else if (isfinite(value))
+	{
+		char digits[MAX_NUMBER_LENGTH + 1];
+
+		append_bytes(writer, digits, format_number(value, digits));
+	}
+	else
+	{
+		append_bytes(writer, "null", 4);
+	}
+}
+
+void write_document_bool(struct DocumentWriter *writer, bool value)
+{
+	begin_document_value(writer);
+
+	if (writer->encoding == ENCODINGMSGPACK)
+	{
+		append_packed(writer, value ? 0xc3 : 0xc2, 0, 0);
+	}
+	else if (value)
+	{
+		append_bytes(writer, "true", 4);
+	}
+	else
+	{
+		append_bytes(writer, "false", 5);
+	}
+}
+
+void count_document_values(struct DocumentWriter *writer, uint32_t count)
+{
+	if (writer->depth == 0 || writer->awaiting_value)
+	{
+		writer->failed = true;
+		return;
+	}
+
+	writer->member_counts[writer->depth - 1] += count;
+}
+
+const char *finish_document_writer(struct DocumentWriter *writer, size_t *length)
+{
+	if (writer->failed || writer->depth != 0 || writer->awaiting_value || writer->length == 0)
+	{
+		return NULL;
+	}
+
+	*length = writer->length;
+
+	return writer->buffer;
+}
+
+char *detach_document_writer(struct DocumentWriter *writer, size_t *length)
+{
+	if (writer->encoding == ENCODINGMSGPACK)
+	{
+		for (uint8_t level = writer->depth; level > 0; level--) // innermost first, as sizing shifts what follows a header
+		{
+			size_packed_level(writer, level - 1);
+		}
+	}
+
+	if (writer->failed)
+	{
+		return NULL;
+	}
+
+	char *fragment = writer->buffer;
+
+	if (writer->owns_buffer) // already on the heap, handed over as is
+	{
+		writer->owns_buffer = false;
+	}
+	else if ((fragment = malloc(writer->length + 1)) != NULL)
+	{
+		memcpy(fragment, writer->buffer, writer->length + 1);
+	}
+	else
+	{
+		return NULL;
+	}
+
+	writer->buffer = NULL;
+	*length = writer->length;
+
+	return fragment;
+}
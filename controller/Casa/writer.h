@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "codec.h"
+
+#define MAX_DOCUMENT_DEPTH 32 // nesting tracked
+#define REPLY_BUFFER_SIZE 2048 // inline buffer of an emitted reply, spilled to the heap beyond
+
+/// <summary>
+/// struct of a document written front to back into a buffer, without an intermediate tree, as JSON text or MessagePack.
+/// </summary>
+struct DocumentWriter
+{
+	WireEncoding encoding;
+
+	char *buffer; // null terminated at every step
+	size_t length;
+	size_t capacity;
+
+	bool owns_buffer; // grown onto the heap, freed on release
+	bool failed; // out of memory or misnested, the document is incomplete
+
+	uint8_t depth;
+	uint32_t member_counts[MAX_DOCUMENT_DEPTH]; // members of each open level, keys counting for objects
+	size_t header_offsets[MAX_DOCUMENT_DEPTH]; // MessagePack headers of each open level, sized once the level closes
+	bool awaiting_value; // a key was written
+};
+
+/// <summary>
+/// Initializes a writer over a caller supplied buffer, typically on the stack, which is outgrown onto the heap if needed.
+/// </summary>
+/// <param name="writer">Writer to initialize.</param>
+/// <param name="encoding">Encoding to write.</param>
+/// <param name="buffer">Initial buffer.</param>
+/// <param name="capacity">Capacity of the initial buffer, at least 1.</param>
+void init_document_writer(struct DocumentWriter *writer, WireEncoding encoding, char *buffer, size_t capacity);
+
+/// <summary>
+/// Releases a writer's heap buffer, if it outgrew the initial one.
+/// </summary>
+/// <param name="writer">Writer to release.</param>
+void release_document_writer(struct DocumentWriter *writer);
+
+/// <summary>
+/// Opens an object as a value.
+/// </summary>
+/// <param name="writer">Writer.</param>
+void begin_document_object(struct DocumentWriter *writer);
+
+/// <summary>
+/// Closes the innermost object.
+/// </summary>
+/// <param name="writer">Writer.</param>
+void end_document_object(struct DocumentWriter *writer);
+
+/// <summary>
+/// Opens an array as a value.
+/// </summary>
+/// <param name="writer">Writer.</param>
+void begin_document_array(struct DocumentWriter *writer);
+
+/// <summary>
+/// Closes the innermost array.
+/// </summary>
+/// <param name="writer">Writer.</param>
+void end_document_array(struct DocumentWriter *writer);
+
+/// <summary>
+/// Writes the key of the next member of the innermost object.
+/// </summary>
+/// <param name="writer">Writer.</param>
+/// <param name="key">Key, escaped as needed.</param>
+void write_document_key(struct DocumentWriter *writer, const char *key);
+
+/// <summary>
+/// Writes a string value, escaping quotes, backslashes and control characters in JSON.
+/// </summary>
+/// <param name="writer">Writer.</param>
+/// <param name="value">Null terminated UTF-8 value.</param>
+void write_document_string(struct DocumentWriter *writer, const char *value);
+
+/// <summary>
+/// Writes an integer value.
+/// </summary>
+/// <param name="writer">Writer.</param>
+/// <param name="value">The value.</param>
+void write_document_integer(struct DocumentWriter *writer, long long value);
+
+/// <summary>
+/// Writes a number value in its shortest round trip form, or null if it is not finite.
+/// MessagePack writes integral numbers as integers, and others as floats of 32 bits where exact.
+/// </summary>
+/// <param name="writer">Writer.</param>
+/// <param name="value">The value.</param>
+void write_document_number(struct DocumentWriter *writer, double value);
+
+/// <summary>
+/// Writes a boolean value.
+/// </summary>
+/// <param name="writer">Writer.</param>
+/// <param name="value">The value.</param>
+void write_document_bool(struct DocumentWriter *writer, bool value);
+
+/// <summary>
+/// Accounts for values of the innermost array that are sent separately, after the bytes written so far.
+/// </summary>
+/// <param name="writer">Writer.</param>
+/// <param name="count">Number of values.</param>
+void count_document_values(struct DocumentWriter *writer, uint32_t count);
+
+/// <summary>
+/// Completes a document.
+/// </summary>
+/// <param name="writer">Writer.</param>
+/// <param name="length">Output reference to the length of the document, which may hold null bytes if binary.</param>
+/// <returns>The document, or NULL if it is incomplete.</returns>
+const char *finish_document_writer(struct DocumentWriter *writer, size_t *length);
+
+/// <summary>
+/// Detaches the bytes written so far, complete or not, as a fragment to be cached and later sent within a larger document.
+/// Open levels are sized by the members written so far, a pending key counting as a member.
+/// </summary>
+/// <param name="writer">Writer, to be released as usual.</param>
+/// <param name="length">Output reference to the length of the fragment.</param>
+/// <returns>The fragment on the heap, or NULL if writing failed.</returns>
+char *detach_document_writer(struct DocumentWriter *writer, size_t *length);